@@ -3,6 +3,9 @@
 rm -f error*
 rm -f core
 
+# futex backend (make SYNC=futex) semaphore sets
+rm -f /dev/shm/soccergame.*
+
 #unsafe
 key=$(ipcs | grep " 120 " | cut -d\  -f1)
 
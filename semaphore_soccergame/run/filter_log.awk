@@ -1,23 +1,24 @@
 BEGIN {
      FS = " ";
-     f=1
-     #players
-     for(i=0;i<10;i++) {
-        FieldSize[f++] = 4;
-     }
-     #goalies
-     FieldSize[f++]=5;
-     for(i=0;i<2;i++) {
-        FieldSize[f++] = 4;
+     nf = 0;
+}
+
+# column header line: players, goalies and referees, as many as there are
+nf == 0 && $1 ~ /^P[0-9]+$/ {
+     nf = NF;
+     for(i=1; i<=NF; i++) {
+        # one extra space before the first goalie and the first referee
+        if(i > 1 && substr($i,1,1) != substr($(i-1),1,1)) {
+           FieldSize[i] = 5;
+        }
+        else FieldSize[i] = 4;
      }
-     #referee
-     FieldSize[f++]=5;
 }
 
 /.*/ {
-    if(NF==14) {
+    if(nf > 0 && NF==nf) {
 #        print  "NOTFILTE " $0
-        for(i=1; i<=14; i++) {
+        for(i=1; i<=nf; i++) {
                if($i==prev[i]) {
                  printf("%*s ",FieldSize[i],".")
                }
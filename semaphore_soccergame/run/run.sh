@@ -1,12 +1,13 @@
 #!/bin/bash
 
+# any arguments after the number of runs are passed on to the generator (e.g. -V, for virtual time sweeps)
 case $# in
     0) n=1000;;
-    1) n=$1;;
-    *) echo "USAGE: $0 «number-of-runs»"; exit;;
+    *) n=$1; shift;;
 esac
 
 if ! [ $n -gt 0 ] 2>/dev/null; then
+    echo "USAGE: $0 «number-of-runs» [generator options]"
     echo "Wrong argument value (\"$n\"). Aborting."
     exit 1
 fi
@@ -14,5 +15,5 @@ fi
 for i in $(seq 1 $n)
 do
      echo -e "\n\e[34;1mRun n.º $i\e[0m"
-     ./probSemSharedMemSoccerGame
+     ./probSemSharedMemSoccerGame "$@"
 done
@@ -0,0 +1,70 @@
+/**
+ *  \file entities.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Life cycles of the intervening entities, for the in-process engine.
+ *
+ *  The entity sources are compiled a second time with SOCCERGAME_ENGINE defined, which leaves out their main
+ *  program, so that the generator process may run every entity as a thread of its own.
+ *  Operations defined for each kind of entity:
+ *     \li binding to the shared data, the semaphore set and the logging file (once, before any life cycle starts)
+ *     \li life cycle of the entity with a given id.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#ifndef ENTITIES_H_
+#define ENTITIES_H_
+
+#include "sharedDataSync.h"
+
+/**
+ *  \brief Binding of the players to the simulation.
+ *
+ *  \param shared pointer to the shared data
+ *  \param semSet semaphore set access identifier
+ *  \param logFile logging file name
+ */
+extern void playerBind (SHARED_DATA *shared, int semSet, char *logFile);
+
+/**
+ *  \brief Life cycle of a player.
+ *
+ *  \param id player id
+ */
+extern void playerLife (int id);
+
+/**
+ *  \brief Binding of the goalies to the simulation.
+ *
+ *  \param shared pointer to the shared data
+ *  \param semSet semaphore set access identifier
+ *  \param logFile logging file name
+ */
+extern void goalieBind (SHARED_DATA *shared, int semSet, char *logFile);
+
+/**
+ *  \brief Life cycle of a goalie.
+ *
+ *  \param id goalie id
+ */
+extern void goalieLife (int id);
+
+/**
+ *  \brief Binding of the referees to the simulation.
+ *
+ *  \param shared pointer to the shared data
+ *  \param semSet semaphore set access identifier
+ *  \param logFile logging file name
+ */
+extern void refereeBind (SHARED_DATA *shared, int semSet, char *logFile);
+
+/**
+ *  \brief Life cycle of a referee.
+ *
+ *  \param id referee id
+ */
+extern void refereeLife (int id);
+
+#endif /* ENTITIES_H_ */
@@ -0,0 +1,72 @@
+/**
+ *  \file entityPool.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Pool of entity processes kept alive from one round of matches to the next (server run).
+ *
+ *  Defined operations:
+ *     \li waiting for the next round, and telling which one it is (entities)
+ *     \li releasing the steps of a round (main process).
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "probDataStruct.h"
+#include "sharedDataSync.h"
+#include "semaphore.h"
+#include "entityPool.h"
+
+/** \brief number of rounds started by this process */
+static int roundsStarted = 0;
+
+bool poolNextRound (int semgid, SHARED_DATA *sh)
+{
+    if (sh->pool.nRounds == 0) {
+        return (roundsStarted++ == 0);
+    }
+    if (roundsStarted > 0) {
+        atomic_fetch_add (&sh->pool.done, 1);
+    }
+    if (roundsStarted == sh->pool.nRounds) {
+        return false;
+    }
+
+    if (semDown (semgid, sh->poolStart) == -1) {
+        perror ("error on the down operation for semaphore access (pool)");
+        exit (EXIT_FAILURE);
+    }
+    atomic_fetch_add (&sh->pool.ready, 1);
+    if (semDown (semgid, sh->poolGo) == -1) {
+        perror ("error on the down operation for semaphore access (pool)");
+        exit (EXIT_FAILURE);
+    }
+    roundsStarted++;
+    return true;
+}
+
+unsigned int poolRound (SHARED_DATA *sh)
+{
+    return ((sh->pool.nRounds == 0) || (roundsStarted == 0)) ? 0 : (unsigned int) (roundsStarted - 1);
+}
+
+void poolStartRound (int semgid, SHARED_DATA *sh)
+{
+    if (semUpN (semgid, sh->poolStart, NUM_COLS(&sh->fSt)) == -1) {
+        perror ("error on the up operation for semaphore access (pool)");
+        exit (EXIT_FAILURE);
+    }
+}
+
+void poolGoRound (int semgid, SHARED_DATA *sh)
+{
+    if (semUpN (semgid, sh->poolGo, NUM_COLS(&sh->fSt)) == -1) {
+        perror ("error on the up operation for semaphore access (pool)");
+        exit (EXIT_FAILURE);
+    }
+}
@@ -0,0 +1,68 @@
+/**
+ *  \file entityPool.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Pool of entity processes kept alive from one round of matches to the next (server run).
+ *
+ *  The main process creates the processes and the IPC resources once; between rounds, it resets the full state
+ *  and releases the next round, so that repeated rounds do not pay for process creation, program loading and IPC
+ *  setup. A round is released in two steps, so that no entity may start it twice:
+ *     \li the main process ups the start semaphore once per entity and waits for every entity to get ready;
+ *     \li then it ups the go semaphore once per entity and waits for every entity to finish the round.
+ *  An entity only waits on the go semaphore once it took a unit of the start one, and only waits on the start
+ *  semaphore again once it finished the round; the main process waits on the pool counters, so it keeps draining
+ *  the ring buffer meanwhile.
+ *  Defined operations:
+ *     \li waiting for the next round, and telling which one it is (entities)
+ *     \li releasing the steps of a round (main process).
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#ifndef ENTITYPOOL_H_
+#define ENTITYPOOL_H_
+
+#include <stdbool.h>
+
+#include "sharedDataSync.h"
+
+/**
+ *  \brief Waiting for the next round.
+ *
+ *  If the run is not a server run, the entity carries out a single life cycle. Otherwise the end of the previous
+ *  round, if any, is recorded and the entity waits for the next one to be released.
+ *
+ *  \param semgid semaphore set access identifier
+ *  \param sh pointer to the shared region
+ *
+ *  \return true if the entity is to carry out its life cycle once more, false if it is to exit
+ */
+extern bool poolNextRound (int semgid, SHARED_DATA *sh);
+
+/**
+ *  \brief Round being carried out by this process.
+ *
+ *  \param sh pointer to the shared region
+ *
+ *  \return round of a server run (0, 1, ...), or 0 if the run is not a server run
+ */
+extern unsigned int poolRound (SHARED_DATA *sh);
+
+/**
+ *  \brief Releasing the start of a round: every entity may get ready.
+ *
+ *  \param semgid semaphore set access identifier
+ *  \param sh pointer to the shared region
+ */
+extern void poolStartRound (int semgid, SHARED_DATA *sh);
+
+/**
+ *  \brief Releasing a round, once every entity got ready.
+ *
+ *  \param semgid semaphore set access identifier
+ *  \param sh pointer to the shared region
+ */
+extern void poolGoRound (int semgid, SHARED_DATA *sh);
+
+#endif /* ENTITYPOOL_H_ */
@@ -0,0 +1,70 @@
+/**
+ *  \file entityRandom.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Pseudo-random generator of the delays of the entities.
+ *
+ *  Defined operations:
+ *     \li seeding the generator of an entity
+ *     \li drawing a 64-bit number
+ *     \li drawing a number uniformly distributed in [0, 1).
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#include <stdint.h>
+
+#include "entityRandom.h"
+
+/* internal functions */
+
+/* next number of a SplitMix64 sequence, used to spread the key of an entity over the generator state */
+static uint64_t splitMix (uint64_t *x)
+{
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ull);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t rotl (uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+/* external functions */
+
+void rngSeed (ENTITY_RNG *rng, uint64_t seed, unsigned int col, unsigned int round)
+{
+    uint64_t x = seed ^ ((((uint64_t) round << 32) | col) * 0xd1b54a32d192ed03ull);             /* one key per entity */
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        rng->s[i] = splitMix (&x);
+    }
+    if ((rng->s[0] | rng->s[1] | rng->s[2] | rng->s[3]) == 0) {
+        rng->s[0] = 1;
+    }
+}
+
+uint64_t rngNext (ENTITY_RNG *rng)
+{
+    uint64_t *s = rng->s;
+    uint64_t r = rotl (s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl (s[3], 45);
+    return r;
+}
+
+double rngUniform (ENTITY_RNG *rng)
+{
+    return (double) (rngNext (rng) >> 11) * 0x1.0p-53;
+}
@@ -0,0 +1,62 @@
+/**
+ *  \file entityRandom.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Pseudo-random generator of the delays of the entities.
+ *
+ *  Each entity draws from a xoshiro256** generator of its own, whose state is derived (by SplitMix64) from the seed
+ *  of the run, the log column of the entity and the round of a server run. The delays of an entity thus depend
+ *  neither on the process or thread it runs in nor on the draws of the others, and a run is repeated, delay by
+ *  delay, by giving its seed to the main process (option -x).
+ *
+ *  Defined operations:
+ *     \li seeding the generator of an entity
+ *     \li drawing a 64-bit number
+ *     \li drawing a number uniformly distributed in [0, 1).
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#ifndef ENTITYRANDOM_H_
+#define ENTITYRANDOM_H_
+
+#include <stdint.h>
+
+/**
+ *  \brief Definition of <em>entity generator</em> data type.
+ */
+typedef struct {
+    /** \brief xoshiro256** state (never all zeros) */
+    uint64_t s[4];
+} ENTITY_RNG;
+
+/**
+ *  \brief Seeding the generator of an entity.
+ *
+ *  \param rng pointer to the generator
+ *  \param seed seed of the run
+ *  \param col log column of the entity
+ *  \param round round of a server run (0, otherwise)
+ */
+extern void rngSeed (ENTITY_RNG *rng, uint64_t seed, unsigned int col, unsigned int round);
+
+/**
+ *  \brief Drawing a 64-bit number.
+ *
+ *  \param rng pointer to the generator
+ *
+ *  \return next number of the sequence
+ */
+extern uint64_t rngNext (ENTITY_RNG *rng);
+
+/**
+ *  \brief Drawing a number uniformly distributed in [0, 1).
+ *
+ *  \param rng pointer to the generator
+ *
+ *  \return multiple of 2^-53
+ */
+extern double rngUniform (ENTITY_RNG *rng);
+
+#endif /* ENTITYRANDOM_H_ */
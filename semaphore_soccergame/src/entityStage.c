@@ -0,0 +1,132 @@
+/**
+ *  \file entityStage.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Stages of the life cycles of the entities.
+ *
+ *  Defined operations:
+ *     \li binding of a kind of entity to the simulation
+ *     \li installing the function called upon a failure
+ *     \li entering and leaving the critical region
+ *     \li down and up operations on a semaphore, with the time limit of the run
+ *     \li operation on several semaphores at once
+ *     \li changing the own state of an entity, on its own or while joining a team
+ *     \li report of a failed operation.
+ *
+ *  The stages themselves are carried out inline (see stageRun).
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "sharedDataSync.h"
+#include "semaphore.h"
+#include "logging.h"
+#include "statSeqlock.h"
+#include "schedule.h"
+#include "entityStage.h"
+
+/* function called upon a failure, instead of exiting (NULL, if none) */
+
+static void (*failHook) (void) = NULL;
+
+/* external functions */
+
+void stageFail (STAGE_ROLE *role, const char *op)
+{
+    fprintf (stderr, "error on the %s operation for semaphore access (%s): %s\n", op, role->tag, strerror (errno));
+    if (failHook != NULL) {
+        failHook ();
+    }
+    exit (EXIT_FAILURE);
+}
+
+void stageFailHook (void (*hook) (void))
+{
+    failHook = hook;
+}
+
+void stageBind (STAGE_ROLE *role, SHARED_DATA *sh, int semgid, char *nFic, const char *tag)
+{
+    role->sh = sh;
+    role->semgid = semgid;
+    role->nFic = nFic;
+    role->tag = tag;
+}
+
+void stageEnter (STAGE_ROLE *role, unsigned int col)
+{
+    schedTurn (role->sh, col);
+    if (semDownTimed (role->semgid, role->sh->mutex, 1, role->sh->fSt.waitLimit) == -1) {
+        stageFail (role, "down");
+    }
+    schedTaken (role->sh, col);
+    statWriteBegin (&role->sh->fSt);
+}
+
+void stageLeave (STAGE_ROLE *role)
+{
+    statWriteEnd (&role->sh->fSt);
+    if (semUp (role->semgid, role->sh->mutex) == -1) {
+        stageFail (role, "up");
+    }
+}
+
+void stageDown (STAGE_ROLE *role, unsigned int sem, unsigned int n)
+{
+    if (semDownTimed (role->semgid, sem, n, role->sh->fSt.waitLimit) == -1) {
+        stageFail (role, "down");
+    }
+}
+
+void stageUp (STAGE_ROLE *role, unsigned int sem, unsigned int n)
+{
+    if (semUpN (role->semgid, sem, n) == -1) {
+        stageFail (role, "up");
+    }
+}
+
+void stageOps (STAGE_ROLE *role, SEM_OP ops[], unsigned int nops)
+{
+    if (semMultiOp (role->semgid, ops, nops) == -1) {
+        stageFail (role, "multiple");
+    }
+}
+
+void stageState (STAGE_ROLE *role, unsigned int col, char state)
+{
+    LOG_SNAP snap;                                                                                   /* state change */
+
+    if (OWN_STATE_FREE(role->sh)) {
+        /* only its own state changes: out of the critical region */
+        statWriteOwn (&role->sh->fSt, col, state);
+        snapOwnStateChange (&role->sh->fSt, col, &snap);
+    }
+    else {
+        stageEnter (role, col);
+        role->sh->fSt.st[col] = state;
+        snapStateChange (role->nFic, &role->sh->fSt, col, &snap);
+        stageLeave (role);
+    }
+    commitStateChange (&snap);
+}
+
+void stageSnap (STAGE_ROLE *role, unsigned int col, char state, LOG_SNAP *snap)
+{
+    if (role->sh->fSt.lockFree) {
+        /* out of the critical region: the counters, changed by the others meanwhile, are not sampled */
+        statWriteOwn (&role->sh->fSt, col, state);
+        snapOwnStateChange (&role->sh->fSt, col, snap);
+    }
+    else {
+        role->sh->fSt.st[col] = state;
+        snapStateChange (role->nFic, &role->sh->fSt, col, snap);
+    }
+}
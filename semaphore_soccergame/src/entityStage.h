@@ -0,0 +1,266 @@
+/**
+ *  \file entityStage.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Stages of the life cycles of the entities.
+ *
+ *  Most of the life cycle of an entity is made of stages of the same shape: the entity changes its own state (the
+ *  one of probConst.h for its kind and, for a team member, its team), then it waits on or signals a semaphore of
+ *  its match. Each such stage is described once, by a helper that hands a constant stage to the same function,
+ *  so that a new stage, or a new kind of entity going through the existing ones, needs no copy of the critical region
+ *  and error handling code. The helpers and that function are inline, so that the operation of the stage is known,
+ *  and folded, at each call site. The operations the stages are made of are also available on their own, for the steps
+ *  of their own shape (forming the teams, claiming a match).
+ *
+ *  Defined operations:
+ *     \li binding of a kind of entity to the simulation
+ *     \li installing the function called upon a failure
+ *     \li entering and leaving the critical region
+ *     \li down and up operations on a semaphore, with the time limit of the run
+ *     \li operation on several semaphores at once
+ *     \li changing the own state of an entity, on its own or while joining a team
+ *     \li report of a failed operation
+ *     \li carrying out a stage, and the stages of the players, goalies and referees.
+ *
+ *  A failed operation is reported, naming the kind of entity, and the entity exits with a failure status.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#ifndef ENTITYSTAGE_H_
+#define ENTITYSTAGE_H_
+
+#include "sharedDataSync.h"
+#include "semaphore.h"
+
+/** \brief number of units of the semaphore of a stage that stands for every member of the two teams of a match */
+#define  STAGE_MEMBERS       -1
+
+/**
+ *  \brief Definition of <em>entity kind binding</em> data type.
+ *
+ *  The shared data, semaphore set and logging file every entity of one kind uses.
+ */
+typedef struct {
+    /** \brief pointer to the shared data */
+    SHARED_DATA *sh;
+    /** \brief semaphore set access identifier */
+    int semgid;
+    /** \brief logging file name */
+    char *nFic;
+    /** \brief tag of the kind of entity, in the error messages (e.g. "PL") */
+    const char *tag;
+} STAGE_ROLE;
+
+/**
+ *  \brief Definition of <em>operation at the end of a stage</em> data type.
+ */
+typedef enum {
+    /** \brief none */
+    STAGE_NONE,
+    /** \brief down operation on the semaphore of the stage */
+    STAGE_DOWN,
+    /** \brief up operation on the semaphore of the stage */
+    STAGE_UP
+} STAGE_OP;
+
+/**
+ *  \brief Definition of <em>stage</em> data type.
+ */
+typedef struct {
+    /** \brief state entered, by a member of the first and of the second team of the match (the same twice, for an
+               entity that is not a team member) */
+    char state[2];
+    /** \brief operation carried out once the state is entered */
+    STAGE_OP op;
+    /** \brief identification of the semaphore of match 0 the operation is carried out on */
+    unsigned int sem;
+    /** \brief number of units of the operation (or STAGE_MEMBERS) */
+    int n;
+} STAGE;
+
+/**
+ *  \brief Binding of a kind of entity to the simulation.
+ *
+ *  \param role pointer to the binding
+ *  \param sh pointer to the shared data
+ *  \param semgid semaphore set access identifier
+ *  \param nFic logging file name
+ *  \param tag tag of the kind of entity, in the error messages
+ */
+extern void stageBind (STAGE_ROLE *role, SHARED_DATA *sh, int semgid, char *nFic, const char *tag);
+
+/**
+ *  \brief Installing the function called when a semaphore operation of a stage fails.
+ *
+ *  By default the entity reports the failure and exits; the in-process engine, whose entities share the process,
+ *  installs a function that does not return instead.
+ *
+ *  \param hook function called once the failure is reported (NULL, to exit)
+ */
+extern void stageFailHook (void (*hook) (void));
+
+/**
+ *  \brief Failure of a semaphore operation.
+ *
+ *  It is reported, as perror would, naming the kind of entity, and the entity exits (see stageFailHook).
+ *
+ *  \param role pointer to the binding of the kind of entity
+ *  \param op name of the operation
+ */
+extern void stageFail (STAGE_ROLE *role, const char *op);
+
+/**
+ *  \brief Entering the critical region.
+ *
+ *  The order of entry is recorded or replayed (see schedule.h) and the change of the full state is marked (see
+ *  statSeqlock.h).
+ *
+ *  \param role pointer to the binding of the kind of entity
+ *  \param col log column of the entity
+ */
+extern void stageEnter (STAGE_ROLE *role, unsigned int col);
+
+/**
+ *  \brief Leaving the critical region.
+ *
+ *  \param role pointer to the binding of the kind of entity
+ */
+extern void stageLeave (STAGE_ROLE *role);
+
+/**
+ *  \brief Down operation on a semaphore, with the time limit of the run.
+ *
+ *  \param role pointer to the binding of the kind of entity
+ *  \param sem semaphore identification
+ *  \param n number of units
+ */
+extern void stageDown (STAGE_ROLE *role, unsigned int sem, unsigned int n);
+
+/**
+ *  \brief Up operation on a semaphore.
+ *
+ *  \param role pointer to the binding of the kind of entity
+ *  \param sem semaphore identification
+ *  \param n number of units
+ */
+extern void stageUp (STAGE_ROLE *role, unsigned int sem, unsigned int n);
+
+/**
+ *  \brief Operation on several semaphores at once.
+ *
+ *  Either all the operations are carried out or none (see semMultiOp); the entity exits if it fails.
+ *
+ *  \param role pointer to the binding of the kind of entity
+ *  \param ops operations to be performed
+ *  \param nops number of operations
+ */
+extern void stageOps (STAGE_ROLE *role, SEM_OP ops[], unsigned int nops);
+
+/**
+ *  \brief Changing the own state of an entity.
+ *
+ *  The change is made in the critical region or, with the ring buffer in use, out of it (see OWN_STATE_FREE), and
+ *  saved.
+ *
+ *  \param role pointer to the binding of the kind of entity
+ *  \param col log column of the entity
+ *  \param state new state
+ */
+extern void stageState (STAGE_ROLE *role, unsigned int col, char state);
+
+/**
+ *  \brief Changing the own state of an entity that joins a team.
+ *
+ *  The caller is in the critical region or, with the lock-free matcher, out of it: the counters of the full state,
+ *  which the other entities may be changing at the same time, are then not sampled (see snapOwnStateChange). The
+ *  change is saved by <tt>commitStateChange</tt>.
+ *
+ *  \param role pointer to the binding of the kind of entity
+ *  \param col log column of the entity
+ *  \param state new state
+ *  \param snap pointer to the location where the snapshot is stored
+ */
+extern void stageSnap (STAGE_ROLE *role, unsigned int col, char state, LOG_SNAP *snap);
+
+/**
+ *  \brief Carrying out a stage.
+ *
+ *  The entity enters the state of the stage (see stageState), then carries out its operation on the semaphore of
+ *  the match.
+ *
+ *  \param role pointer to the binding of the kind of entity
+ *  \param col log column of the entity
+ *  \param stage pointer to the stage
+ *  \param side 0 for a member of the first team of the match (or an entity that is not a team member), 1 for the
+ *              second
+ *  \param match match id
+ */
+static inline void stageRun (STAGE_ROLE *role, unsigned int col, const STAGE *stage, unsigned int side, int match)
+{
+    unsigned int n = (stage->n == STAGE_MEMBERS) ?
+                     (unsigned int) (2 * (role->sh->fSt.nTeamPlayers + role->sh->fSt.nTeamGoalies)) :
+                     (unsigned int) stage->n;
+
+    stageState (role, col, stage->state[side]);
+    switch (stage->op) {
+        case STAGE_DOWN:
+            stageDown (role, MATCH_SEM(stage->sem, match), n);
+            break;
+        case STAGE_UP:
+            stageUp (role, MATCH_SEM(stage->sem, match), n);
+            break;
+        case STAGE_NONE:
+            break;
+    }
+}
+
+/* stages: the entity, its log column (col), the side of its match (side: see stageRun) and the match (match) */
+
+/** \brief player or goalie arrives */
+static inline void stageMemberArrive (STAGE_ROLE *role, unsigned int col)
+{
+    stageRun (role, col, &(const STAGE) { { ARRIVING, ARRIVING }, STAGE_NONE, 0, 0 }, 0, 0);
+}
+
+/** \brief player or goalie waits for its match to start */
+static inline void stageMemberWaitStart (STAGE_ROLE *role, unsigned int col, unsigned int side, int match)
+{
+    stageRun (role, col, &(const STAGE) { { WAITING_START_1, WAITING_START_2 }, STAGE_DOWN, PLAYERSWAITREFEREE, 1 },
+              side, match);
+}
+
+/** \brief player or goalie plays until its match ends */
+static inline void stageMemberPlay (STAGE_ROLE *role, unsigned int col, unsigned int side, int match)
+{
+    stageRun (role, col, &(const STAGE) { { PLAYING_1, PLAYING_2 }, STAGE_DOWN, PLAYERSWAITEND, 1 }, side, match);
+}
+
+/** \brief referee arrives */
+static inline void stageRefereeArrive (STAGE_ROLE *role, unsigned int col)
+{
+    stageRun (role, col, &(const STAGE) { { ARRIVINGR, ARRIVINGR }, STAGE_NONE, 0, 0 }, 0, 0);
+}
+
+/** \brief referee starts its match, releasing the members of both teams */
+static inline void stageRefereeStart (STAGE_ROLE *role, unsigned int col, int match)
+{
+    stageRun (role, col, &(const STAGE) { { STARTING_GAME, STARTING_GAME }, STAGE_UP, PLAYERSWAITREFEREE,
+                                          STAGE_MEMBERS }, 0, match);
+}
+
+/** \brief referee referees its match */
+static inline void stageRefereePlay (STAGE_ROLE *role, unsigned int col)
+{
+    stageRun (role, col, &(const STAGE) { { REFEREEING, REFEREEING }, STAGE_NONE, 0, 0 }, 0, 0);
+}
+
+/** \brief referee ends its match, releasing the members of both teams */
+static inline void stageRefereeEnd (STAGE_ROLE *role, unsigned int col, int match)
+{
+    stageRun (role, col, &(const STAGE) { { ENDING_GAME, ENDING_GAME }, STAGE_UP, PLAYERSWAITEND, STAGE_MEMBERS },
+              0, match);
+}
+
+#endif /* ENTITYSTAGE_H_ */
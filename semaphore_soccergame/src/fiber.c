@@ -0,0 +1,431 @@
+/**
+ *  \file fiber.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  User level threads (fibers) run by a small pool of kernel threads.
+ *
+ *  Defined operations:
+ *     \li initialization of the runtime
+ *     \li creation of a fiber
+ *     \li start of the workers and waiting for the termination of every fiber
+ *     \li sleeping, in real or in virtual time
+ *     \li blocking on a 32-bit word and waking up the fibers blocked on it (the semaphore wait hooks).
+ *
+ *  Fibers are switched with <tt>swapcontext</tt>. The ready queue, the wait queues (hashed on the address of the
+ *  word) and the timer queue (a binary heap ordered by wake up time) are all protected by a single lock. A fiber
+ *  parks itself by switching back to its worker with the lock held, and the worker releases it afterwards, so a
+ *  fiber cannot be resumed by another worker before its context is saved.
+ *
+ *  In virtual time, the timer queue is the event calendar of a discrete event simulation: nothing really sleeps,
+ *  and the clock jumps to the earliest wake up time whenever no fiber is ready or running.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <time.h>
+#include <pthread.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+
+#include "fiber.h"
+
+/** \brief stack size of each fiber (in bytes) */
+#define  FIBER_STACK    (64 * 1024)
+
+/** \brief number of wait queues */
+#define  WAIT_BUCKETS   1024
+
+/** \brief wait queue of the word at <tt>addr</tt> */
+#define  BUCKET(addr)   (&waitQueue[((uintptr_t) (addr) >> 2) % WAIT_BUCKETS])
+
+struct worker;
+
+/**
+ *  \brief Definition of <em>fiber</em> data type.
+ */
+typedef struct fiber {
+    /** \brief saved context */
+    ucontext_t ctx;
+    /** \brief function the fiber runs */
+    void (*fn) (void *arg);
+    /** \brief argument of that function */
+    void *arg;
+    /** \brief worker running the fiber */
+    struct worker *worker;
+    /** \brief word the fiber is blocked on */
+    void *waitAddr;
+    /** \brief wake up time of a sleeping fiber (in ns) */
+    uint64_t wakeTime;
+    /** \brief next fiber in the ready queue or in a wait queue */
+    struct fiber *next;
+    /** \brief true once the function has returned */
+    bool done;
+} FIBER;
+
+/**
+ *  \brief Definition of <em>worker</em> data type.
+ */
+typedef struct worker {
+    /** \brief context of the scheduling loop */
+    ucontext_t sched;
+    /** \brief fiber being run */
+    FIBER *current;
+    /** \brief kernel thread */
+    pthread_t thread;
+} WORKER;
+
+/**
+ *  \brief Definition of <em>fiber queue</em> data type.
+ */
+typedef struct {
+    FIBER *head;
+    FIBER *tail;
+} FIBER_QUEUE;
+
+/** \brief lock of the runtime */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** \brief condition the idle workers wait on */
+static pthread_cond_t idle;
+
+/** \brief fibers */
+static FIBER *fibers = NULL;
+
+/** \brief stacks of the fibers */
+static char *stacks = NULL;
+
+/** \brief maximum and actual number of fibers, and number of those that have not finished */
+static unsigned int maxFib, nFib, nLive;
+
+/** \brief ready queue */
+static FIBER_QUEUE ready;
+
+/** \brief wait queues */
+static FIBER_QUEUE waitQueue[WAIT_BUCKETS];
+
+/** \brief timer queue (binary heap) */
+static FIBER **timers = NULL;
+
+/** \brief number of sleeping fibers */
+static unsigned int nTimers;
+
+/** \brief workers */
+static WORKER *workers = NULL;
+
+/** \brief number of workers */
+static unsigned int nWork;
+
+/** \brief number of workers running a fiber */
+static unsigned int nRunning;
+
+/** \brief true if the clock is virtual */
+static bool virtualTime = false;
+
+/** \brief virtual clock (in ns) */
+static uint64_t vClock;
+
+/** \brief worker run by this kernel thread (NULL, if none) */
+static __thread WORKER *self = NULL;
+
+/* internal functions */
+
+/* in virtual time, the lock must be held */
+static uint64_t now (void)
+{
+    struct timespec ts;
+
+    if (virtualTime) {
+        return vClock;
+    }
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+static void enqueue (FIBER_QUEUE *q, FIBER *f)
+{
+    f->next = NULL;
+    if (q->tail == NULL) {
+        q->head = f;
+    }
+    else q->tail->next = f;
+    q->tail = f;
+}
+
+static FIBER *dequeue (FIBER_QUEUE *q)
+{
+    FIBER *f = q->head;
+
+    if (f != NULL) {
+        if ((q->head = f->next) == NULL) {
+            q->tail = NULL;
+        }
+    }
+    return f;
+}
+
+/* the lock must be held */
+static void makeReady (FIBER *f)
+{
+    enqueue (&ready, f);
+    pthread_cond_signal (&idle);
+}
+
+static void timerPush (FIBER *f)
+{
+    unsigned int i = nTimers++;
+
+    while ((i > 0) && (timers[(i - 1) / 2]->wakeTime > f->wakeTime)) {
+        timers[i] = timers[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    timers[i] = f;
+}
+
+static FIBER *timerPop (void)
+{
+    FIBER *top = timers[0], *last = timers[--nTimers];
+    unsigned int i = 0, c;
+
+    while ((c = 2 * i + 1) < nTimers) {
+        if ((c + 1 < nTimers) && (timers[c + 1]->wakeTime < timers[c]->wakeTime)) {
+            c++;
+        }
+        if (last->wakeTime <= timers[c]->wakeTime) {
+            break;
+        }
+        timers[i] = timers[c];
+        i = c;
+    }
+    timers[i] = last;
+    return top;
+}
+
+/* the lock must be held; it is released when the fiber is resumed */
+static void park (FIBER *f)
+{
+    swapcontext (&f->ctx, &f->worker->sched);
+}
+
+static void fiberMain (int idx)
+{
+    FIBER *f = &fibers[idx];
+
+    f->fn (f->arg);
+    pthread_mutex_lock (&lock);
+    f->done = true;
+    if (--nLive == 0) {
+        pthread_cond_broadcast (&idle);
+    }
+    setcontext (&f->worker->sched);
+}
+
+static void *workerRun (void *arg)
+{
+    WORKER *w = (WORKER *) arg;
+    FIBER *f;
+    uint64_t t;
+    struct timespec ts;
+
+    self = w;
+    pthread_mutex_lock (&lock);
+    while (true) {
+        for (t = now (); (nTimers > 0) && (timers[0]->wakeTime <= t); ) {
+            makeReady (timerPop ());
+        }
+        if ((f = dequeue (&ready)) != NULL) {
+            f->worker = w;
+            w->current = f;
+            nRunning++;
+            pthread_mutex_unlock (&lock);
+            swapcontext (&w->sched, &f->ctx);
+            nRunning--;
+            w->current = NULL;                                                /* the fiber is back, with the lock held */
+            if (f->done) {
+                madvise (f->ctx.uc_stack.ss_sp, FIBER_STACK, MADV_DONTNEED);
+            }
+            continue;
+        }
+        if (nLive == 0) {
+            break;
+        }
+        if (virtualTime && (nRunning == 0) && (nTimers > 0)) {
+            vClock = timers[0]->wakeTime;                                               /* jump to the next event */
+            continue;
+        }
+        if ((nTimers > 0) && !virtualTime) {
+            ts.tv_sec = (time_t) (timers[0]->wakeTime / 1000000000ull);
+            ts.tv_nsec = (long) (timers[0]->wakeTime % 1000000000ull);
+            pthread_cond_timedwait (&idle, &lock, &ts);
+        }
+        else pthread_cond_wait (&idle, &lock);
+    }
+    pthread_mutex_unlock (&lock);
+    return NULL;
+}
+
+/* external functions */
+
+int fiberInit (unsigned int maxFibers, bool virtualClock)
+{
+    pthread_condattr_t attr;
+
+    if ((fibers = calloc (maxFibers, sizeof (FIBER))) == NULL) {
+        return -1;
+    }
+    if ((timers = malloc (maxFibers * sizeof (FIBER *))) == NULL) {
+        return -1;
+    }
+    stacks = mmap (NULL, (size_t) maxFibers * FIBER_STACK, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if (stacks == MAP_FAILED) {
+        return -1;
+    }
+    pthread_condattr_init (&attr);
+    pthread_condattr_setclock (&attr, CLOCK_MONOTONIC);
+    pthread_cond_init (&idle, &attr);
+    pthread_condattr_destroy (&attr);
+    maxFib = maxFibers;
+    nFib = nLive = nTimers = nRunning = 0;
+    virtualTime = virtualClock;
+    vClock = 0;
+    return 0;
+}
+
+int fiberSpawn (void (*fn) (void *arg), void *arg)
+{
+    FIBER *f;
+
+    if (nFib == maxFib) {
+        errno = EAGAIN;
+        return -1;
+    }
+    f = &fibers[nFib];
+    if (getcontext (&f->ctx) == -1) {
+        return -1;
+    }
+    f->ctx.uc_stack.ss_sp = stacks + (size_t) nFib * FIBER_STACK;
+    f->ctx.uc_stack.ss_size = FIBER_STACK;
+    f->ctx.uc_link = NULL;
+    makecontext (&f->ctx, (void (*) (void)) fiberMain, 1, (int) nFib);
+    f->fn = fn;
+    f->arg = arg;
+    nFib++;
+
+    pthread_mutex_lock (&lock);
+    nLive++;
+    makeReady (f);
+    pthread_mutex_unlock (&lock);
+    return 0;
+}
+
+int fiberStart (unsigned int nWorkers)
+{
+    unsigned int w;
+    int err;
+
+    if ((workers = calloc (nWorkers, sizeof (WORKER))) == NULL) {
+        return -1;
+    }
+    for (w = 0; w < nWorkers; w++) {
+        if ((err = pthread_create (&workers[w].thread, NULL, workerRun, &workers[w])) != 0) {
+            errno = err;
+            return -1;
+        }
+        nWork = w + 1;
+    }
+    return 0;
+}
+
+void fiberJoin (void)
+{
+    unsigned int w;
+
+    for (w = 0; w < nWork; w++) {
+        pthread_join (workers[w].thread, NULL);
+    }
+    munmap (stacks, (size_t) maxFib * FIBER_STACK);
+    free (workers);
+    free (timers);
+    free (fibers);
+    workers = NULL;
+    timers = NULL;
+    fibers = NULL;
+    nWork = 0;
+}
+
+uint64_t fiberTime (void)
+{
+    uint64_t t;
+
+    pthread_mutex_lock (&lock);
+    t = now ();
+    pthread_mutex_unlock (&lock);
+    return t;
+}
+
+void fiberSleep (unsigned int us)
+{
+    FIBER *f;
+
+    if (self == NULL) {
+        usleep (us);
+        return;
+    }
+    f = self->current;
+    pthread_mutex_lock (&lock);
+    f->wakeTime = now () + 1000ull * us;
+    timerPush (f);
+    park (f);
+}
+
+void fiberWait (void *addr, unsigned int val)
+{
+    FIBER *f;
+
+    if (self == NULL) {
+        sched_yield ();
+        return;
+    }
+    f = self->current;
+    pthread_mutex_lock (&lock);
+    if (atomic_load ((_Atomic uint32_t *) addr) != val) {                        /* woken up before it could be parked */
+        pthread_mutex_unlock (&lock);
+        return;
+    }
+    f->waitAddr = addr;
+    enqueue (BUCKET(addr), f);
+    park (f);
+}
+
+void fiberWake (void *addr, int n)
+{
+    FIBER_QUEUE *q = BUCKET(addr), keep = { NULL, NULL };
+    FIBER *f;
+
+    pthread_mutex_lock (&lock);
+    while ((n > 0) && ((f = dequeue (q)) != NULL)) {
+        if (f->waitAddr == addr) {
+            f->waitAddr = NULL;
+            makeReady (f);
+            n--;
+        }
+        else enqueue (&keep, f);
+    }
+    if (keep.head != NULL) {                                          /* fibers blocked on other words go back first */
+        keep.tail->next = q->head;
+        if (q->head == NULL) {
+            q->tail = keep.tail;
+        }
+        q->head = keep.head;
+    }
+    pthread_mutex_unlock (&lock);
+}
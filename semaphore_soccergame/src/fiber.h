@@ -0,0 +1,104 @@
+/**
+ *  \file fiber.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  User level threads (fibers) run by a small pool of kernel threads.
+ *
+ *  Each fiber has a stack of its own and is switched to and from the kernel threads of the pool (the workers),
+ *  so a simulation may hold many more entities than kernel threads. A fiber that has to wait on a semaphore, or
+ *  to sleep, is parked and its worker runs another one.
+ *  Defined operations:
+ *     \li initialization of the runtime
+ *     \li creation of a fiber
+ *     \li start of the workers and waiting for the termination of every fiber
+ *     \li reading the clock and sleeping, in real or in virtual time
+ *     \li blocking on a 32-bit word and waking up the fibers blocked on it (the semaphore wait hooks).
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#ifndef FIBER_H_
+#define FIBER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ *  \brief Initialization of the runtime.
+ *
+ *  The stacks of all fibers are reserved in a single mapping, whose pages are only committed as they are used.
+ *  With a virtual clock, sleeping takes no real time: the clock moves forward to the earliest wake up time when
+ *  every fiber is either sleeping or blocked, so the order of the events is kept.
+ *
+ *  \param maxFibers maximum number of fibers
+ *  \param virtualClock true for a virtual clock, false for the real one
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+extern int fiberInit (unsigned int maxFibers, bool virtualClock);
+
+/**
+ *  \brief Creation of a fiber.
+ *
+ *  The fiber is ready to run, but it only runs once the workers are started.
+ *
+ *  \param fn function the fiber runs
+ *  \param arg argument of <tt>fn</tt>
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+extern int fiberSpawn (void (*fn) (void *arg), void *arg);
+
+/**
+ *  \brief Start of the workers.
+ *
+ *  \param nWorkers number of kernel threads running the fibers
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+extern int fiberStart (unsigned int nWorkers);
+
+/**
+ *  \brief Waiting for the termination of every fiber; the workers are terminated and the stacks are released.
+ */
+extern void fiberJoin (void);
+
+/**
+ *  \brief Reading the clock of the runtime.
+ *
+ *  \return virtual time since the initialization, or CLOCK_MONOTONIC time (in ns)
+ */
+extern uint64_t fiberTime (void);
+
+/**
+ *  \brief Sleeping.
+ *
+ *  A fiber is parked on the timer queue; any other caller sleeps with <tt>usleep</tt>.
+ *
+ *  \param us sleeping time (in us)
+ */
+extern void fiberSleep (unsigned int us);
+
+/**
+ *  \brief Blocking of the calling fiber while the 32-bit word at <tt>addr</tt> holds <tt>val</tt>.
+ *
+ *  Any other caller just yields the processor and returns.
+ *
+ *  \param addr address of the word
+ *  \param val expected value
+ */
+extern void fiberWait (void *addr, unsigned int val);
+
+/**
+ *  \brief Waking up of up to <tt>n</tt> fibers blocked on the word at <tt>addr</tt>.
+ *
+ *  \param addr address of the word
+ *  \param n maximum number of fibers to wake up
+ */
+extern void fiberWake (void *addr, int n);
+
+#endif /* FIBER_H_ */
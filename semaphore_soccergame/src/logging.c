@@ -7,7 +7,16 @@
  *
  *  Defined operations:
  *     \li file initialization
- *     \li writing the present full state as a single line at the end of the file.
+ *     \li writing the present full state as a single line at the end of the file
+ *     \li writing the present full state at the start of a new round of a server run
+ *     \li recording a state change, either directly in the file or in a shared ring buffer
+ *     \li taking a snapshot of a state change inside a critical region and writing it into the ring out of it
+ *     \li taking a snapshot of a change of the own state of an entity made out of the critical region
+ *     \li draining the ring buffer into the file, as text lines or as binary trace records
+ *     \li recording every full state drained in a state history as well
+ *     \li checking the invariants of the run on every state change drained
+ *     \li printing the present full state, for diagnostics
+ *     \li closing the file.
  *
  *  \author Nuno Lau - December 2024
  */
@@ -16,72 +25,255 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <errno.h>
 
 #include <sys/types.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <sched.h>
+#include <time.h>
 
 
 #include "probConst.h"
 #include "probDataStruct.h"
+#include "logging.h"
+#include "stateHistory.h"
+#include "stateCheck.h"
+
+/** \brief ring buffer used by this process (NULL if none) */
+static LOG_RING *logRing = NULL;
+
+/** \brief counter of the bytes written to the logging file (in the ring block), if any */
+static _Atomic uint64_t *written = NULL;
+
+/** \brief drainer copy of the full state, rebuilt from the ring records */
+static FULL_STAT *drainSt = NULL;
+
+/** \brief true if the drainer writes binary trace records */
+static bool traceMode = false;
+
+/** \brief time of trace creation (CLOCK_MONOTONIC, in ns) */
+static uint64_t traceT0;
+
+/** \brief true if the full states drained are recorded in a state history */
+static bool histMode = false;
+
+/** \brief true if the state changes drained are checked against the invariants of the run */
+static bool checkMode = false;
+
+/** \brief function called upon a violation of the invariants */
+static void (*checkFail) (void) = NULL;
+
+/** \brief number of state changes drained so far (sequence number of the state history records) */
+static uint64_t drainSeq = 0;
+
+/** \brief size of the buffered log lines past which they are written to the file (in bytes) */
+#define  SINK_SIZE        (64 * 1024)
+
+/** \brief time past which the buffered log lines are written to the file (in ns) */
+#define  SINK_PERIOD      (100 * 1000000u)
+
+/** \brief length of a log line with <tt>nCol</tt> state columns (in bytes) */
+#define  STATE_LINE(nCol)        (4 * (size_t) (nCol) + 3)
+
+/** \brief maximum length of the header line with <tt>nCol</tt> columns (in bytes) */
+#define  HEADER_LINE(nCol)       (12 * (size_t) (nCol) + 4)
+
+/** \brief descriptor of the log file, open from the first write on (-1, if not open) */
+static int logFd = -1;
+
+/** \brief true if the log lines are buffered (drainer of the ring buffer) instead of written one at a time */
+static bool sinkBuffered = false;
+
+/** \brief log lines not yet written to the file (threads of the in-process engine have their own) */
+static _Thread_local char *sinkBuf = NULL;
+
+/** \brief size of the log buffer (in bytes) */
+static _Thread_local size_t sinkCap = 0;
+
+/** \brief length of the log lines in the buffer (in bytes) */
+static _Thread_local size_t sinkLen = 0;
+
+/** \brief time of the last write of the log buffer to the file (CLOCK_MONOTONIC, in ns) */
+static _Thread_local uint64_t sinkT = 0;
 
 /* internal functions */
 
-static FILE *openLog(char nFic[], char mode[])
+static uint64_t now(void)
 {
-    FILE *fic;
-    char *fName;                                                                                      /* log file name */
+    struct timespec ts;
 
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+static void flushLog(void)
+{
+    size_t off = 0;
+    ssize_t n;
+
+    while (off < sinkLen) {
+        if ((n = write (logFd, sinkBuf + off, sinkLen - off)) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror ("error on writing to log file");
+            exit (EXIT_FAILURE);
+        }
+        off += (size_t) n;
+    }
+    if (written != NULL) {
+        atomic_fetch_add_explicit (written, off, memory_order_relaxed);
+    }
+    sinkLen = 0;
+    sinkT = now ();
+}
+
+static void closeLog(void)
+{
+    if (sinkLen > 0) {
+        flushLog ();
+    }
+    if ((logFd == -1) || (logFd == STDOUT_FILENO)) {
+        logFd = -1;
+        return;
+    }
+
+    if (((fsync (logFd) == -1) && (errno != EINVAL)) || (close (logFd) == -1)) {
+        perror ("error on closing of log file");
+        exit (EXIT_FAILURE);
+    }
+    logFd = -1;
+}
+
+/* the log file is opened once per process and kept open: O_APPEND makes each write land at the end of the file,
+   whoever else appends to it; O_CLOEXEC keeps it off the entity processes launched afterwards */
+static void openLog(char nFic[], bool create)
+{
     if ((nFic == NULL) || (strlen (nFic) == 0)) {
-        return stdout;
+        logFd = STDOUT_FILENO;
+        return;
     }
-    else  {
-        fName = nFic;
+    if (logFd != -1) {
+        if (!create) {
+            return;
+        }
+        closeLog ();
     }
 
-    fprintf(stderr,"%d opening log %s %s\n",getpid(),nFic,mode);
+    fprintf(stderr,"%d opening log %s %s\n",getpid(),nFic,create ? "w" : "a");
 
-    if ((fic = fopen (fName, mode)) == NULL) {
+    if ((logFd = open (nFic, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | (create ? O_TRUNC : 0), 0666)) == -1) {
         perror ("error on opening log file");
         exit (EXIT_FAILURE);
     }
-    return fic;
 }
 
-static void closeLog(FILE *fic)
+/* room for n more bytes at the end of the buffer, flushing it or making it larger first if need be */
+static char *logRoom(size_t n)
+{
+    if (sinkLen + n > sinkCap) {
+        if (sinkLen > 0) {
+            flushLog ();
+        }
+        if (n > sinkCap) {
+            free (sinkBuf);
+            sinkCap = n + SINK_SIZE;
+            if ((sinkBuf = malloc (sinkCap)) == NULL) {
+                perror ("error on allocating the log buffer");
+                exit (EXIT_FAILURE);
+            }
+        }
+    }
+    return sinkBuf + sinkLen;
+}
+
+/* n bytes written in the room: they go to the file at once, unless the buffer is in use and not yet full */
+static void logCommit(size_t n)
 {
-    if(fic==stderr || fic == stdout) {
-         fflush(fic);
-         return;
+    sinkLen += n;
+    if (!sinkBuffered || (sinkLen >= SINK_SIZE)) {
+        flushLog ();
     }
+}
 
-    if (fclose (fic) == EOF) {
-        perror ("error on closing of log file");
+static void appendHistory(FULL_STAT *p_fSt, uint64_t tstamp)
+{
+    if (histAppend (p_fSt, drainSeq, tstamp) == -1) {
+        perror ("error on writing to the state history file");
         exit (EXIT_FAILURE);
     }
 }
 
-static void printHeader(FILE *fic, FULL_STAT *p_fSt)
+/* a violation of the invariants: checking stops, so that the handler may close the file */
+static void checkViolated(void)
 {
+    checkMode = false;
+    checkFail ();
+}
+
+static size_t printHeader(char *buf, FULL_STAT *p_fSt)
+{
+    char *q = buf;
     
     int p;
     for(p=0; p < p_fSt->nPlayers; p++) {
-        fprintf(fic, " %s%02d", "P", p);
+        q += sprintf(q, " %s%02d", "P", p);
     }
 
-    fprintf(fic," ");
+    *q++ = ' ';
 
     int g;
     for(g=0; g < p_fSt->nGoalies; g++) {
-        fprintf(fic, " %s%02d", "G", g);
+        q += sprintf(q, " %s%02d", "G", g);
+    }
+
+    *q++ = ' ';
+
+    int r;
+    for(r=0; r < p_fSt->nReferees; r++) {
+        q += sprintf(q, " %s%02d", "R", r+1);
     }
 
-    fprintf(fic," ");
+    *q++ = ' ';
 
-    fprintf(fic," %s%02d","R",1);
+    *q++ = '\n';
+    return (size_t) (q - buf);
+}
 
-    fprintf(fic," ");
+/* state column of a log line: the state, right aligned in four characters */
+static inline char *putState(char *q, char state)
+{
+    q[0] = q[1] = q[2] = ' ';
+    q[3] = state;
+    return q + 4;
+}
 
-    fprintf(fic,"\n");
+static size_t printState(char *buf, FULL_STAT *p_fSt)
+{
+    char *q = buf;
+
+    int p;
+    for(p=0; p < p_fSt->nPlayers; p++) {
+        q = putState(q, PLAYER_STAT(p_fSt,p));
+    }
+
+    *q++ = ' ';
+
+    int g;
+    for(g=0; g < p_fSt->nGoalies; g++) {
+        q = putState(q, GOALIE_STAT(p_fSt,g));
+    }
+
+    *q++ = ' ';
+
+    int r;
+    for(r=0; r < p_fSt->nReferees; r++) {
+        q = putState(q, REFEREE_STAT(p_fSt,r));
+    }
+
+    *q++ = '\n';
+    return (size_t) (q - buf);
 }
 
 /* external functions */
@@ -91,6 +283,8 @@ static void printHeader(FILE *fic, FULL_STAT *p_fSt)
  *
  *  The function creates the logging file and writes its header.
  *  If <tt>nFic</tt> is a null pointer or a null string, stdout is used.
+ *  The file is kept open by each process from its first write on: a line written directly takes a single
+ *  <tt>write</tt> (and it is appended at the end of the file, whichever the process).
  *
  *  The file header consists of
  *       \li a title line
@@ -100,16 +294,56 @@ static void printHeader(FILE *fic, FULL_STAT *p_fSt)
  */
 void createLog (char nFic[], FULL_STAT *p_fSt)
 {
-    FILE *fic;                                                                                      /* file descriptor */
+    char *buf;                                                                                  /* header being built */
+    size_t n;
 
-    fic = openLog(nFic,"w");
+    openLog(nFic,true);
 
     /* title line + blank line */
 
-    fprintf (fic, "%21cSoccerGame - Description of the internal state\n\n", ' ');
-    printHeader(fic, p_fSt);
+    buf = logRoom (80 + HEADER_LINE(NUM_COLS(p_fSt)));
+    n = (size_t) sprintf (buf, "%21cSoccerGame - Description of the internal state\n\n", ' ');
+    n += printHeader(buf + n, p_fSt);
 
-    closeLog(fic);
+    logCommit(n);
+}
+
+/**
+ *  \brief Binary trace initialization.
+ *
+ *  The function creates the trace file and writes its header and the initial state of all entities.
+ *  From then on, <tt>logRingDrain</tt> appends binary trace records instead of text lines.
+ *
+ *  \param nFic name of the trace file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ */
+void createTrace (char nFic[], FULL_STAT *p_fSt)
+{
+    char *buf;                                                                          /* header and initial states */
+    TRACE_HDR hdr;                                                                                     /* file header */
+    unsigned int c, nCol;
+
+    openLog(nFic,true);
+
+    traceMode = true;
+    traceT0 = now ();
+
+    hdr.magic = TRACE_MAGIC;
+    hdr.version = TRACE_VERSION;
+    hdr.nPlayers = p_fSt->nPlayers;
+    hdr.nGoalies = p_fSt->nGoalies;
+    hdr.nReferees = p_fSt->nReferees;
+    hdr.reserved = 0;
+    hdr.t0 = traceT0;
+    hdr.seed = p_fSt->seed;
+    nCol = NUM_COLS(p_fSt);
+    buf = logRoom (sizeof (hdr) + nCol);
+    memcpy (buf, &hdr, sizeof (hdr));
+    for (c = 0; c < nCol; c++) {
+        buf[sizeof (hdr) + c] = (char) p_fSt->st[c];
+    }
+
+    logCommit(sizeof (hdr) + nCol);
 }
 
 /**
@@ -127,28 +361,352 @@ void createLog (char nFic[], FULL_STAT *p_fSt)
  */
 void saveState (char nFic[], FULL_STAT *p_fSt)
 {
-    FILE *fic;                                                                                      /* file descriptor */
+    openLog(nFic,false);
+    logCommit(printState(logRoom (STATE_LINE(NUM_COLS(p_fSt))), p_fSt));
+}
 
-    fic = openLog(nFic,"a");
+/**
+ *  \brief Writing the present full state at the start of a new round of a server run.
+ *
+ *  In a binary trace, the records of the log columns whose state changed are written with the present time.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ */
+void saveRoundStart (char nFic[], FULL_STAT *p_fSt)
+{
+    TRACE_REC trec, *buf;                                                                     /* binary trace records */
+    uint64_t t = now ();
+    unsigned int c, n = 0, nCol = NUM_COLS(p_fSt);
 
-    int p;
-    for(p=0; p < p_fSt->nPlayers; p++) {
-        fprintf(fic,"%4c",p_fSt->st.playerStat[p]);
+    if (!traceMode) {
+        saveState (nFic, p_fSt);
+    }
+    else {
+        openLog (nFic, false);
+        buf = (TRACE_REC *) logRoom (nCol * sizeof (trec));
+        trec.tstamp = (t > traceT0) ? (t - traceT0) / 1000 : 0;
+        trec.reserved = 0;
+        for (c = 0; c < nCol; c++) {
+            if ((drainSt == NULL) || (drainSt->st[c] != p_fSt->st[c])) {
+                trec.colState = (c << 8) | (p_fSt->st[c] & 0xff);
+                memcpy (&buf[n++], &trec, sizeof (trec));
+            }
+        }
+        logCommit (n * sizeof (trec));
+    }
+    if (drainSt != NULL) {
+        memcpy (drainSt, p_fSt, FULL_STAT_SIZE(nCol));
+    }
+    if (histMode) {
+        appendHistory (p_fSt, t);
+    }
+    if (checkMode) {
+        if (!checkEnd ()) {                                                          /* end of the round just drained */
+            checkViolated ();
+        }
+        checkInit (p_fSt);
+    }
+}
+
+/**
+ *  \brief Recording the change of state of one entity.
+ *
+ *  If a ring buffer is in use, a fixed-size record is appended to it and nothing else is done.
+ *  Otherwise the present full state is written as a single line at the end of the file.
+ *  It is the same as a snapshot immediately written (see snapStateChange and commitStateChange).
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *  \param col log column of the entity whose state changed
+ */
+void saveStateChange (char nFic[], FULL_STAT *p_fSt, unsigned int col)
+{
+    LOG_SNAP snap;                                                                               /* state change */
+
+    snapStateChange (nFic, p_fSt, col, &snap);
+    commitStateChange (&snap);
+}
+
+/**
+ *  \brief Taking a snapshot of the change of state of one entity.
+ *
+ *  To be called inside the critical region where the state was changed: if a ring buffer is in use, only the ring
+ *  position and the change itself are recorded, in constant time, and the record is written by
+ *  <tt>commitStateChange</tt> once the critical region is left.
+ *  Otherwise the present full state is written as a single line at the end of the file, as it must be consistent.
+ *
+ *  Claiming the position inside the critical region keeps the records in the order of the changes.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *  \param col log column of the entity whose state changed
+ *  \param snap pointer to the location where the snapshot is stored
+ */
+void snapStateChange (char nFic[], FULL_STAT *p_fSt, unsigned int col, LOG_SNAP *snap)
+{
+    if ((logRing == NULL) || !logRing->enabled) {
+        snap->pending = false;
+        saveState (nFic, p_fSt);
+        return;
     }
 
-    fprintf(fic," ");
+    snap->pending = true;
+    snap->pos = atomic_fetch_add_explicit (&logRing->head, 1, memory_order_relaxed);
+    snap->rec.tstamp = now ();
+    snap->rec.col = col;
+    snap->rec.state = p_fSt->st[col];
+    snap->rec.playersFree = atomic_load_explicit (&p_fSt->playersFree, memory_order_relaxed);
+    snap->rec.goaliesFree = atomic_load_explicit (&p_fSt->goaliesFree, memory_order_relaxed);
+    snap->rec.teamId = atomic_load_explicit (&p_fSt->teamId, memory_order_relaxed);
+}
 
-    int g;
-    for(g=0; g < p_fSt->nGoalies; g++) {
-        fprintf(fic,"%4c",p_fSt->st.goalieStat[g]);
+/**
+ *  \brief Taking a snapshot of the change of the own state of one entity, made out of the critical region.
+ *
+ *  The ring buffer must be in use (see OWN_STATE_FREE). The counters of the full state, which other entities may be
+ *  changing at the same time, are not sampled: the record takes, when drained, those of the record before it in the
+ *  order of the changes, so that the full states rebuilt from the records (log lines and history) stay consistent.
+ *
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *  \param col log column of the entity whose state changed
+ *  \param snap pointer to the location where the snapshot is stored
+ */
+void snapOwnStateChange (FULL_STAT *p_fSt, unsigned int col, LOG_SNAP *snap)
+{
+    snap->pending = true;
+    snap->pos = atomic_fetch_add_explicit (&logRing->head, 1, memory_order_relaxed);
+    snap->rec.tstamp = now ();
+    snap->rec.col = col;
+    snap->rec.state = (p_fSt->st[col] & 0xffu) | LOGREC_OWN;
+    snap->rec.playersFree = snap->rec.goaliesFree = snap->rec.teamId = 0;
+}
+
+/**
+ *  \brief Writing a snapshot taken by <tt>snapStateChange</tt> into the ring buffer.
+ *
+ *  To be called after the critical region is left and before the caller blocks on any semaphore.
+ *
+ *  The producer waits for the claimed slot to be freed by the consumer (only when the ring is full), fills it in
+ *  and publishes it by updating its sequence number.
+ *
+ *  \param snap pointer to the snapshot
+ */
+void commitStateChange (LOG_SNAP *snap)
+{
+    LOG_SLOT *slot;                                                                               /* claimed slot */
+
+    if (!snap->pending) {
+        return;
+    }
+
+    slot = &logRing->slot[snap->pos & (LOGRING_SIZE - 1)];
+    while (atomic_load_explicit (&slot->seq, memory_order_acquire) != snap->pos) {
+        sched_yield ();                                                          /* ring is full, let the drainer run */
+    }
+    slot->rec = snap->rec;
+    atomic_store_explicit (&slot->seq, snap->pos + 1, memory_order_release);
+    snap->pending = false;
+}
+
+/**
+ *  \brief Ring buffer initialization.
+ *
+ *  To be called by the drainer, before any producer is launched.
+ *  The present state of the entities is taken as the starting point of the log lines. If the ring is enabled, the
+ *  log lines of the drainer are buffered from then on (see logRingDrain). The bytes written to the logging file are
+ *  counted in the ring from then on, by every process that uses it.
+ *
+ *  \param ring pointer to the ring buffer
+ *  \param enabled true if state changes are to be recorded in the ring
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ */
+void logRingInit (LOG_RING *ring, bool enabled, FULL_STAT *p_fSt)
+{
+    uint32_t i;
+
+    ring->enabled = enabled;
+    sinkBuffered = enabled;
+    atomic_init (&ring->head, 0);
+    ring->tail = 0;
+    atomic_init (&ring->written, 0);
+    written = &ring->written;
+    for (i = 0; i < LOGRING_SIZE; i++) {
+        atomic_init (&ring->slot[i].seq, i);
+    }
+    free (drainSt);
+    if ((drainSt = aligned_alloc (CACHE_LINE, FULL_STAT_SIZE(NUM_COLS(p_fSt)))) == NULL) {
+        perror ("error on allocating the drainer state");
+        exit (EXIT_FAILURE);
+    }
+    memcpy (drainSt, p_fSt, FULL_STAT_SIZE(NUM_COLS(p_fSt)));
+}
+
+/**
+ *  \brief Selection of the ring buffer to be used by <tt>saveStateChange</tt> in this process.
+ *
+ *  The bytes this process writes to the logging file are counted in the ring.
+ *
+ *  \param ring pointer to the ring buffer
+ */
+void logUseRing (LOG_RING *ring)
+{
+    logRing = ring;
+    written = &ring->written;
+}
+
+/**
+ *  \brief State history initialization.
+ *
+ *  To be called by the drainer, after the ring buffer initialization. The present state of the entities is the first
+ *  record; from then on, every full state drained from the ring (and the start of each round of a server run) is
+ *  appended to the history as well.
+ *
+ *  \param nHist name of the state history file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ */
+void createHistory (char nHist[], FULL_STAT *p_fSt)
+{
+    uint64_t t = now ();
+
+    if (histCreate (nHist, p_fSt, traceMode ? traceT0 : t) == -1) {
+        perror ("error on creating the state history file");
+        exit (EXIT_FAILURE);
     }
+    histMode = true;
+    drainSeq = 0;
+    appendHistory (p_fSt, t);
+}
 
-    fprintf(fic," ");
+/**
+ *  \brief Checker of the invariants initialization.
+ *
+ *  To be called by the drainer, after the ring buffer initialization. From then on, every state change drained from
+ *  the ring is checked, and so is the end of each round of a server run and of the run (see stateCheck.h); upon a
+ *  violation, <tt>onViolation</tt> is called (it should not return), once the offending state is in the file.
+ *
+ *  A null <tt>onViolation</tt> stops the checking (before the run is aborted for another reason).
+ *
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *  \param onViolation function called upon a violation
+ */
+void logCheck (FULL_STAT *p_fSt, void (*onViolation) (void))
+{
+    if (onViolation != NULL) {
+        checkInit (p_fSt);
+    }
+    checkFail = onViolation;
+    checkMode = (onViolation != NULL);
+}
 
-    fprintf(fic,"%4c",p_fSt->st.refereeStat);
+/**
+ *  \brief Draining the ring buffer.
+ *
+ *  All records available are written to the file, one line (or binary trace record) per record. The lines are
+ *  gathered in a buffer, which goes to the file in a single write once it holds SINK_SIZE bytes or SINK_PERIOD
+ *  after its last write (or when the file is closed, see logClose).
+ *
+ *  \param nFic name of the logging file
+ *  \param ring pointer to the ring buffer
+ *
+ *  \return number of records drained
+ */
+unsigned int logRingDrain (char nFic[], LOG_RING *ring)
+{
+    LOG_SLOT *slot;                                                                                   /* slot to read */
+    TRACE_REC trec;                                                                            /* binary trace record */
+    unsigned int n = 0;                                                                    /* number of records drained */
+    unsigned int col;                                                             /* log column of the record drained */
+
+    while (true) {
+        slot = &ring->slot[ring->tail & (LOGRING_SIZE - 1)];
+        if (atomic_load_explicit (&slot->seq, memory_order_acquire) != ring->tail + 1) {
+            break;
+        }
+        col = slot->rec.col;
+        drainSt->st[col] = (uint8_t) (slot->rec.state & 0xff);
+        if ((slot->rec.state & LOGREC_OWN) == 0) {
+            atomic_store_explicit (&drainSt->playersFree, slot->rec.playersFree, memory_order_relaxed);
+            atomic_store_explicit (&drainSt->goaliesFree, slot->rec.goaliesFree, memory_order_relaxed);
+            atomic_store_explicit (&drainSt->teamId, slot->rec.teamId, memory_order_relaxed);
+        }
+        drainSeq++;
+        if (histMode) {
+            appendHistory (drainSt, slot->rec.tstamp);
+        }
+        trec.tstamp = (slot->rec.tstamp > traceT0) ? (slot->rec.tstamp - traceT0) / 1000 : 0;
+        trec.colState = (slot->rec.col << 8) | (slot->rec.state & 0xff);
+        trec.reserved = 0;
+        atomic_store_explicit (&slot->seq, ring->tail + LOGRING_SIZE, memory_order_release);
+        ring->tail++;
+
+        if (n == 0) {
+            openLog (nFic, false);
+        }
+        if (traceMode) {
+            memcpy (logRoom (sizeof (trec)), &trec, sizeof (trec));
+            logCommit (sizeof (trec));
+        }
+        else logCommit (printState (logRoom (STATE_LINE(NUM_COLS(drainSt))), drainSt));
+        n++;
+        if (checkMode && !checkChange (col, (char) drainSt->st[col])) {
+            checkViolated ();
+        }
+    }
 
-    fprintf(fic,"\n");
+    if ((sinkLen > 0) && (now () - sinkT >= SINK_PERIOD)) {
+        flushLog ();
+    }
+    return n;
+}
+
+/**
+ *  \brief Printing the present full state, for diagnostics.
+ *
+ *  The header and a state line, as in the log, are followed by the counters of the full state. It is read as it is,
+ *  with no regard for its sequence number (the run may be stuck in the middle of a change). Nothing is written to the
+ *  logging file.
+ *
+ *  \param fic stream where the full state is printed
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ */
+void logDump (FILE *fic, FULL_STAT *p_fSt)
+{
+    char *buf;                                                                                   /* lines being built */
+    size_t n;
+    unsigned int seq = atomic_load (&p_fSt->seq);
 
-    closeLog(fic);
+    if ((buf = malloc (HEADER_LINE(NUM_COLS(p_fSt)) + STATE_LINE(NUM_COLS(p_fSt)))) == NULL) {
+        perror ("error on allocating the full state dump");
+        return;
+    }
+    n = printHeader (buf, p_fSt);
+    n += printState (buf + n, p_fSt);
+    fwrite (buf, 1, n, fic);
+    free (buf);
+    fprintf (fic, "sequence number %u%s; players arrived %d, free %d; goalies arrived %d, free %d; next team %d; "
+             "matches claimed %d\n", seq, (seq % 2 == 1) ? " (in a change)" : "", atomic_load (&p_fSt->playersArrived),
+             atomic_load (&p_fSt->playersFree), atomic_load (&p_fSt->goaliesArrived),
+             atomic_load (&p_fSt->goaliesFree), atomic_load (&p_fSt->teamId), p_fSt->matchesClaimed);
 }
 
+/**
+ *  \brief Closing the logging file.
+ *
+ *  The log lines still in the buffer are written, the file is synchronized with the storage device and closed.
+ *  So is the state history, if any. If the invariants are being checked, the end of the run is checked first.
+ *  To be called by the main process at the end of the run.
+ */
+void logClose (void)
+{
+    if (checkMode && !checkEnd ()) {
+        checkViolated ();
+    }
+    checkMode = false;
+    closeLog ();
+    if (histMode && (histClose () == -1)) {
+        perror ("error on closing the state history file");
+        exit (EXIT_FAILURE);
+    }
+    histMode = false;
+}
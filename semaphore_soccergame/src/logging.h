@@ -7,7 +7,15 @@
  *
  *  Defined operations:
  *     \li file initialization
- *     \li writing the present full state as a single line at the end of the file.
+ *     \li writing the present full state as a single line at the end of the file
+ *     \li writing the present full state at the start of a new round of a server run
+ *     \li recording a state change, either directly in the file or in a shared ring buffer
+ *     \li taking a snapshot of a state change inside a critical region and writing it into the ring out of it
+ *     \li taking a snapshot of a change of the own state of an entity made out of the critical region
+ *     \li draining the ring buffer into the file, as text lines or as binary trace records
+ *     \li recording every full state drained in a state history as well
+ *     \li printing the present full state, for diagnostics
+ *     \li closing the file.
  *
  *  \author Nuno Lau - December 2024
  */
@@ -15,8 +23,133 @@
 #ifndef LOGGING_H_
 #define LOGGING_H_
 
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
 #include "probDataStruct.h"
 
+/** \brief number of records in the state log ring (must be a power of 2) */
+#define  LOGRING_SIZE     1024
+
+/** \brief flag of the state of a ring record, for a change of the own state only made out of the critical region
+           (see snapOwnStateChange) */
+#define  LOGREC_OWN       0x100u
+
+/** \brief binary trace magic number ("SGTR") */
+#define  TRACE_MAGIC      0x52544753u
+/** \brief binary trace format version */
+#define  TRACE_VERSION    3
+
+/** \brief log column of a binary trace record */
+#define  TRACE_COL(p_rec)        ((p_rec)->colState >> 8)
+/** \brief new state of a binary trace record */
+#define  TRACE_STATE(p_rec)      ((char) ((p_rec)->colState & 0xff))
+
+/**
+ *  \brief Definition of <em>binary trace header</em> data type.
+ *
+ *  It is followed in the file by the initial state of every log column (one byte each) and then by the
+ *  trace records.
+ */
+typedef struct {
+    /** \brief magic number, TRACE_MAGIC */
+    uint32_t magic;
+    /** \brief format version, TRACE_VERSION */
+    uint32_t version;
+    /** \brief total number of players */
+    uint32_t nPlayers;
+    /** \brief total number of goalies */
+    uint32_t nGoalies;
+    /** \brief total number of referees */
+    uint32_t nReferees;
+    /** \brief reserved, 0 */
+    uint32_t reserved;
+    /** \brief time of trace creation (CLOCK_MONOTONIC, in ns) */
+    uint64_t t0;
+    /** \brief seed of the run (generator option -x) */
+    uint64_t seed;
+} TRACE_HDR;
+
+/**
+ *  \brief Definition of <em>binary trace record</em> data type.
+ *
+ *  One record per state change, in the order of the changes. The time takes 64 bits, so that it does not wrap
+ *  around however long the run (a 32-bit one, as in version 2, did after 71 minutes).
+ */
+typedef struct {
+    /** \brief time of the change since trace creation (in us) */
+    uint64_t tstamp;
+    /** \brief log column (upper 24 bits) and new state (lower 8 bits) */
+    uint32_t colState;
+    /** \brief reserved, 0 */
+    uint32_t reserved;
+} TRACE_REC;
+
+/**
+ *  \brief Definition of <em>state change record</em> data type.
+ */
+typedef struct {
+    /** \brief time of the change (CLOCK_MONOTONIC, in ns) */
+    uint64_t tstamp;
+    /** \brief log column of the entity whose state changed */
+    uint32_t col;
+    /** \brief new state of the entity, with LOGREC_OWN if the counters were not sampled (the ones of the previous
+               record stand) */
+    uint32_t state;
+    /** \brief number of free players at the time of the change */
+    int32_t playersFree;
+    /** \brief number of free goalies at the time of the change */
+    int32_t goaliesFree;
+    /** \brief id of team to be formed next at the time of the change */
+    int32_t teamId;
+} LOG_REC;
+
+/**
+ *  \brief Definition of <em>state change snapshot</em> data type.
+ *
+ *  Taken inside the critical region (see snapStateChange) and written out of it (see commitStateChange).
+ */
+typedef struct {
+    /** \brief true if the record is still to be written into the ring */
+    bool pending;
+    /** \brief claimed ring position, which orders the changes as they were made */
+    uint32_t pos;
+    /** \brief state change record */
+    LOG_REC rec;
+} LOG_SNAP;
+
+/**
+ *  \brief Definition of <em>ring slot</em> data type.
+ *
+ *  <tt>seq</tt> equals the slot position when the slot is free and the position plus one when it holds a record.
+ */
+typedef struct {
+    /** \brief slot sequence number */
+    _Atomic uint32_t seq;
+    /** \brief state change record */
+    LOG_REC rec;
+} LOG_SLOT;
+
+/**
+ *  \brief Definition of <em>state log ring</em> data type.
+ *
+ *  Multiple producers, single consumer, lock-free. It is placed in shared memory, starting a cache line.
+ */
+typedef struct {
+    /** \brief true when state changes are to be recorded in the ring */
+    bool enabled;
+    /** \brief next position to be claimed by a producer (on a cache line of its own, as every producer writes it) */
+    _Alignas(CACHE_LINE) _Atomic uint32_t head;
+    /** \brief next position to be read by the consumer (on a cache line of its own, as only the consumer writes it) */
+    _Alignas(CACHE_LINE) uint32_t tail;
+    /** \brief number of bytes written to the logging file since the ring initialization, by any process (on a cache
+               line of its own, as every writer adds to it) */
+    _Alignas(CACHE_LINE) _Atomic uint64_t written;
+    /** \brief record slots */
+    _Alignas(CACHE_LINE) LOG_SLOT slot[LOGRING_SIZE];
+} LOG_RING;
+
 /**
  *  \brief File initialization.
  *
@@ -31,6 +164,17 @@
  */
 extern void createLog (char nFic[], FULL_STAT *p_fSt);
 
+/**
+ *  \brief Binary trace initialization.
+ *
+ *  The function creates the trace file and writes its header and the initial state of all entities.
+ *  From then on, <tt>logRingDrain</tt> appends binary trace records instead of text lines.
+ *
+ *  \param nFic name of the trace file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ */
+extern void createTrace (char nFic[], FULL_STAT *p_fSt);
+
 /**
  *  \brief write a log record (complete line) that includes the state of all entities and more info.
  *
@@ -41,4 +185,148 @@ extern void createLog (char nFic[], FULL_STAT *p_fSt);
  */
 extern void saveState (char nFic[], FULL_STAT *p_fSt);
 
+/**
+ *  \brief Writing the present full state at the start of a new round of a server run.
+ *
+ *  To be called by the drainer, with the ring buffer empty and no producer running: the state is written as a
+ *  single line or, in a binary trace, as one record per log column whose state changed, and it is taken as the
+ *  starting point of the lines drained afterwards.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ */
+extern void saveRoundStart (char nFic[], FULL_STAT *p_fSt);
+
+/**
+ *  \brief Recording the change of state of one entity.
+ *
+ *  If a ring buffer is in use, a fixed-size record is appended to it and nothing else is done.
+ *  Otherwise the present full state is written as a single line at the end of the file.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *  \param col log column of the entity whose state changed
+ */
+extern void saveStateChange (char nFic[], FULL_STAT *p_fSt, unsigned int col);
+
+/**
+ *  \brief Taking a snapshot of the change of state of one entity.
+ *
+ *  To be called inside the critical region where the state was changed: if a ring buffer is in use, only the ring
+ *  position and the change itself are recorded, in constant time, and the record is written by
+ *  <tt>commitStateChange</tt> once the critical region is left.
+ *  Otherwise the present full state is written as a single line at the end of the file, as it must be consistent.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *  \param col log column of the entity whose state changed
+ *  \param snap pointer to the location where the snapshot is stored
+ */
+extern void snapStateChange (char nFic[], FULL_STAT *p_fSt, unsigned int col, LOG_SNAP *snap);
+
+/**
+ *  \brief Taking a snapshot of the change of the own state of one entity, made out of the critical region.
+ *
+ *  The ring buffer must be in use (see OWN_STATE_FREE). The counters of the full state, which other entities may be
+ *  changing at the same time, are not sampled: the record takes, when drained, those of the record before it in the
+ *  order of the changes, so that the full states rebuilt from the records (log lines and history) stay consistent.
+ *
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *  \param col log column of the entity whose state changed
+ *  \param snap pointer to the location where the snapshot is stored
+ */
+extern void snapOwnStateChange (FULL_STAT *p_fSt, unsigned int col, LOG_SNAP *snap);
+
+/**
+ *  \brief Writing a snapshot taken by <tt>snapStateChange</tt> into the ring buffer.
+ *
+ *  To be called after the critical region is left and before the caller blocks on any semaphore.
+ *
+ *  \param snap pointer to the snapshot
+ */
+extern void commitStateChange (LOG_SNAP *snap);
+
+/**
+ *  \brief Ring buffer initialization.
+ *
+ *  To be called by the drainer, before any producer is launched.
+ *  The present state of the entities is taken as the starting point of the log lines. If the ring is enabled, the
+ *  log lines of the drainer are buffered from then on (see logRingDrain). The bytes written to the logging file are
+ *  counted in the ring from then on, by every process that uses it.
+ *
+ *  \param ring pointer to the ring buffer
+ *  \param enabled true if state changes are to be recorded in the ring
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ */
+extern void logRingInit (LOG_RING *ring, bool enabled, FULL_STAT *p_fSt);
+
+/**
+ *  \brief Selection of the ring buffer to be used by <tt>saveStateChange</tt> in this process.
+ *
+ *  The bytes this process writes to the logging file are counted in the ring.
+ *
+ *  \param ring pointer to the ring buffer
+ */
+extern void logUseRing (LOG_RING *ring);
+
+/**
+ *  \brief Draining the ring buffer.
+ *
+ *  All records available are written to the file, one line (or binary trace record) per record. The lines are
+ *  gathered in a buffer, which goes to the file in a single write once it is large enough or some time after its
+ *  last write (or when the file is closed, see logClose).
+ *
+ *  \param nFic name of the logging file
+ *  \param ring pointer to the ring buffer
+ *
+ *  \return number of records drained
+ */
+extern unsigned int logRingDrain (char nFic[], LOG_RING *ring);
+
+/**
+ *  \brief State history initialization.
+ *
+ *  To be called by the drainer, after the ring buffer initialization. The present state of the entities is the first
+ *  record; from then on, every full state drained from the ring (and the start of each round of a server run) is
+ *  appended to the history as well (see stateHistory.h).
+ *
+ *  \param nHist name of the state history file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ */
+extern void createHistory (char nHist[], FULL_STAT *p_fSt);
+
+/**
+ *  \brief Checker of the invariants initialization.
+ *
+ *  To be called by the drainer, after the ring buffer initialization. From then on, every state change drained from
+ *  the ring is checked, and so is the end of each round of a server run and of the run (see stateCheck.h); upon a
+ *  violation, <tt>onViolation</tt> is called (it should not return), once the offending state is in the file.
+ *
+ *  A null <tt>onViolation</tt> stops the checking (before the run is aborted for another reason).
+ *
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *  \param onViolation function called upon a violation
+ */
+extern void logCheck (FULL_STAT *p_fSt, void (*onViolation) (void));
+
+/**
+ *  \brief Printing the present full state, for diagnostics.
+ *
+ *  The header and a state line, as in the log, are followed by the counters of the full state, read as they are
+ *  (the run may be stuck in the middle of a change). Nothing is written to the logging file.
+ *
+ *  \param fic stream where the full state is printed
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ */
+extern void logDump (FILE *fic, FULL_STAT *p_fSt);
+
+/**
+ *  \brief Closing the logging file.
+ *
+ *  The log lines still in the buffer are written, the file is synchronized with the storage device and closed.
+ *  So is the state history, if any. If the invariants are being checked, the end of the run is checked first.
+ *  To be called by the main process at the end of the run.
+ */
+extern void logClose (void);
+
 #endif /* LOGGING_H_ */
@@ -0,0 +1,200 @@
+/**
+ *  \file member.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Life cycle of the team members, players and goalies alike.
+ *
+ *  Definition of the operations carried out by the team members:
+ *     \li arrive
+ *     \li constituteTeam
+ *     \li waitReferee
+ *     \li playUntilEnd.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "logging.h"
+#include "sharedDataSync.h"
+#include "semaphore.h"
+#include "entityPool.h"
+#include "fiber.h"
+#include "entityRandom.h"
+#include "entityStage.h"
+#include "member.h"
+
+/* internal functions */
+
+/**
+ *  \brief member takes some time to arrive
+ *
+ *  Member updates state and takes some time to arrive
+ *  With the ring buffer in use, the critical region is not entered (see stageState).
+ *  The internal state should be saved.
+ *
+ *  \param kind pointer to the kind of the member
+ *  \param col  log column of the member
+ *  \param rng  pointer to the generator of the delays of the member
+ */
+static void arrive (MEMBER_KIND *kind, unsigned int col, ENTITY_RNG *rng)
+{
+    stageMemberArrive (&kind->role, col);
+    fiberSleep (200.0 * rngUniform (rng) + kind->delay);
+}
+
+/**
+ *  \brief member joins its team
+ *
+ *  Teams are filled in order of arrival: the k-th member of a kind to arrive takes seat k % perTeam (after those of
+ *  the kinds before it) of team 1 + k / perTeam, or is late if there is no such team.
+ *  The player or goalie that makes its team full forms it: it calls exactly its teammates, which wait on the
+ *  semaphore of their own team, and notifies the referee of the match, in a single operation (see semMultiOp).
+ *  Only atomic operations are used and nothing is waited on, so it may be called either inside the critical region
+ *  or out of it (lock-free matcher), where its state change does not sample the counters (see stageSnap).
+ *  The internal state should be saved.
+ *
+ *  \param kind pointer to the kind of the member
+ *  \param col  log column of the member
+ *  \param snap pointer to the location where the snapshot of the state change is stored
+ *
+ *  \return id of member team (0 for late members)
+ */
+static int joinTeam (MEMBER_KIND *kind, unsigned int col, LOG_SNAP *snap)
+{
+    SHARED_DATA *sh = kind->role.sh;
+    int seat = atomic_fetch_add (kind->arrived, 1);
+    int size = sh->fSt.nTeamPlayers + sh->fSt.nTeamGoalies;
+    int team;
+    TEAM_SLOT *slot;
+    SEM_OP calls[2];                                                         /* teammates called and referee notified */
+
+    if (seat >= kind->perTeam * 2 * sh->fSt.nMatches) {
+        stageSnap (&kind->role, col, LATE, snap);
+        atomic_fetch_add_explicit (kind->late, 1, memory_order_relaxed);
+        return 0;
+    }
+
+    team = 1 + seat / kind->perTeam;
+    slot = TEAM_SLOT(sh, team);
+    slot->roster[kind->seat0 + seat % kind->perTeam] = (int) col;
+    atomic_fetch_add (kind->free, 1);                                               /* counted as free before joining */
+    if (atomic_fetch_add (&slot->joined, 1) + 1 < size) {
+        stageSnap (&kind->role, col, WAITING_TEAM, snap);
+        return team;
+    }
+
+    //último a chegar à equipa: forma-a
+    atomic_fetch_sub (&sh->fSt.playersFree, sh->fSt.nTeamPlayers);
+    atomic_fetch_sub (&sh->fSt.goaliesFree, sh->fSt.nTeamGoalies);
+    stageSnap (&kind->role, col, FORMING_TEAM, snap);
+    atomic_fetch_add (&sh->fSt.teamId, 1);
+    atomic_fetch_add_explicit (&sh->metrics.teamsFormed, 1, memory_order_relaxed);
+
+    //chamar os colegas e avisar o árbitro numa só operação
+    calls[0].sindex = TEAM_SEM(sh->teamWait, team);
+    calls[0].delta = size - 1;
+    calls[1].sindex = MATCH_SEM(sh->refereeWaitTeams, TEAM_MATCH(team));
+    calls[1].delta = 1;
+    stageOps (&kind->role, calls, 2);
+    return team;
+}
+
+/**
+ *  \brief member constitutes team
+ *
+ *  If member is late, it updates state and leaves.
+ *  Otherwise it joins its team (see joinTeam). If it formed the team, after leaving the critical region, it waits
+ *  for the teammates to acknowledge registration; if not, it waits on the semaphore of its team for the forming
+ *  teammate to "call" him, and acknowledges registration.
+ *  No semaphore other than the mutex is waited on inside the critical region.
+ *  With the lock-free matcher, the critical region is not entered.
+ *  The internal state should be saved.
+ *
+ *  \param kind pointer to the kind of the member
+ *  \param col  log column of the member
+ *
+ *  \return id of member team (0 for late members; 1, 3, ... for the first team of a match; 2, 4, ... for the second)
+ */
+static int constituteTeam (MEMBER_KIND *kind, unsigned int col)
+{
+    SHARED_DATA *sh = kind->role.sh;
+    int ret;
+    LOG_SNAP snap;
+
+    if (sh->fSt.lockFree) {
+        ret = joinTeam (kind, col, &snap);
+    }
+    else {
+        stageEnter (&kind->role, col);                                                       /* enter critical region */
+        ret = joinTeam (kind, col, &snap);
+        stageLeave (&kind->role);                                                             /* exit critical region */
+    }
+    commitStateChange (&snap);
+
+    if (sh->fSt.st[col] == FORMING_TEAM) {
+        //esperar pelo registo de todos os colegas, incluindo os guarda-redes, já fora da região crítica
+        stageDown (&kind->role, TEAM_SEM(sh->teamRegistered, ret),
+                   (unsigned int) (sh->fSt.nTeamPlayers + sh->fSt.nTeamGoalies - 1));
+    }
+    else if (sh->fSt.st[col] == WAITING_TEAM) {
+        stageDown (&kind->role, TEAM_SEM(sh->teamWait, ret), 1);
+        stageUp (&kind->role, TEAM_SEM(sh->teamRegistered, ret), 1);
+    }
+
+    return ret;
+}
+
+/**
+ *  \brief member waits for referee to start match
+ *
+ *  The member updates its state and waits for referee to start match.
+ *  With the ring buffer in use, the critical region is not entered (see stageState).
+ *  The internal state should be saved.
+ *
+ *  \param kind pointer to the kind of the member
+ *  \param col  log column of the member
+ *  \param team member team
+ */
+static void waitReferee (MEMBER_KIND *kind, unsigned int col, int team)
+{
+    stageMemberWaitStart (&kind->role, col, (unsigned int) (team - 1) % 2, TEAM_MATCH(team));
+}
+
+/**
+ *  \brief member waits for referee to end match
+ *
+ *  The member updates its state and waits for referee to end match.
+ *  With the ring buffer in use, the critical region is not entered (see stageState).
+ *  The internal state should be saved.
+ *
+ *  \param kind pointer to the kind of the member
+ *  \param col  log column of the member
+ *  \param team member team
+ */
+static void playUntilEnd (MEMBER_KIND *kind, unsigned int col, int team)
+{
+    stageMemberPlay (&kind->role, col, (unsigned int) (team - 1) % 2, TEAM_MATCH(team));
+}
+
+/* external functions */
+
+void memberLife (MEMBER_KIND *kind, int id)
+{
+    unsigned int col = kind->col0 + (unsigned int) id;                                    /* log column of the member */
+    ENTITY_RNG rng;                                                                        /* generator of the delays */
+    int team;
+
+    rngSeed (&rng, kind->role.sh->fSt.seed, col, poolRound (kind->role.sh));
+    arrive (kind, col, &rng);
+    if ((team = constituteTeam (kind, col)) != 0) {
+        waitReferee (kind, col, team);
+        playUntilEnd (kind, col, team);
+    }
+}
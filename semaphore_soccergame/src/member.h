@@ -0,0 +1,61 @@
+/**
+ *  \file member.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Life cycle of the team members, players and goalies alike.
+ *
+ *  Players and goalies go through the same life cycle: they arrive, join a team (or are late), the one that makes
+ *  its team full forms it, and then they wait for the referee to start their match and to end it. They only differ
+ *  in what their kind binds (see MEMBER_KIND): their log columns, their arrival and free counters, their share of
+ *  the seats of a team and the delay of their arrival. The programs of the players and of the goalies just bind
+ *  their kind and run this life cycle.
+ *
+ *  Defined operations:
+ *     \li life cycle of a team member.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#ifndef MEMBER_H_
+#define MEMBER_H_
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "sharedDataSync.h"
+#include "entityStage.h"
+
+/**
+ *  \brief Definition of <em>kind of team member</em> data type.
+ *
+ *  Filled in by the program of the kind, once the shared data is mapped.
+ */
+typedef struct {
+    /** \brief binding of the kind to the stages of its life cycle */
+    STAGE_ROLE role;
+    /** \brief log column of the member of id 0 (those of the others follow it) */
+    unsigned int col0;
+    /** \brief number of members of the kind that arrived, which is the seat the next one takes */
+    _Atomic int *arrived;
+    /** \brief number of members of the kind that joined a team not yet formed */
+    _Atomic int *free;
+    /** \brief number of members of the kind that were late */
+    _Atomic uint64_t *late;
+    /** \brief number of members of the kind in a team */
+    int perTeam;
+    /** \brief place of the first member of the kind in the roster of a team */
+    int seat0;
+    /** \brief shortest arrival delay, in us (the actual one adds up to 200 us to it) */
+    double delay;
+} MEMBER_KIND;
+
+/**
+ *  \brief Life cycle of a team member.
+ *
+ *  \param kind pointer to the kind of the member
+ *  \param id id of the member, within its kind
+ */
+extern void memberLife (MEMBER_KIND *kind, int id);
+
+#endif /* MEMBER_H_ */
@@ -11,7 +11,7 @@
 #ifndef PROBCONST_H_
 #define PROBCONST_H_
 
-/* Generic parameters */
+/* Generic parameters (defaults; the actual values are set at launch time and kept in FULL_STAT) */
  
 /** \brief total number of players */
 #define  NUMPLAYERS       10
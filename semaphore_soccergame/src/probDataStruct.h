@@ -14,31 +14,28 @@
 #define PROBDATASTRUCT_H_
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
 
 #include "probConst.h"
 
-/**
- *  \brief Definition of <em>state of the intervening entities</em> data type.
- */
-typedef struct {
-    /** \brief players state */
-    unsigned int playerStat[NUMPLAYERS];
-    /** \brief goalies state */
-    unsigned int goalieStat[NUMGOALIES];
-    /** \brief referees state */
-    unsigned int refereeStat;
-
-} STAT;
-
+/** \brief size of a cache line (in bytes) */
+#define  CACHE_LINE       64
 
 /**
  *  \brief Definition of <em>full state of the problem</em> data type.
+ *
+ *  The state of the intervening entities is kept in a trailing array, sized at launch time, with one entry
+ *  per log column: players first, then goalies, then the referees. It should be accessed through the
+ *  <tt>PLAYER_STAT</tt>, <tt>GOALIE_STAT</tt> and <tt>REFEREE_STAT</tt> macros.
+ *
+ *  The fields are laid out in cache lines of their own, by how they are used: the configuration, set at launch
+ *  time and only read afterwards; the counters changed in the critical region, with the sequence number; and the
+ *  states, one byte each, so that 64 entities share a line.
  */
 typedef struct
-{   /** \brief state of all intervening entities */
-    STAT st;
-
-    /** \brief total number of players */
+{   /** \brief total number of players */
     int nPlayers;
 
     /** \brief total number of goalies */
@@ -47,19 +44,77 @@ typedef struct
     /** \brief total number of referees */
     int nReferees;
 
-    /** \brief number of players that already arrived */
-    int playersArrived;
-    /** \brief number of goalies that already arrived */
-    int goaliesArrived;
+    /** \brief number of players in each team */
+    int nTeamPlayers;
+
+    /** \brief number of goalies in each team */
+    int nTeamGoalies;
+
+    /** \brief number of matches to be played */
+    int nMatches;
+
+    /** \brief true if the teams are formed out of the critical region (lock-free matcher) */
+    bool lockFree;
+
+    /** \brief seed of the run: each entity draws its delays from a generator of its own, keyed by the seed, its log
+               column and the round (see entityRandom.h) */
+    uint64_t seed;
+
+    /** \brief time limit of the semaphore waits of the entities, in milliseconds (none, for 0): an entity that gives
+               up reports the stalled wait and exits with failure */
+    unsigned int waitLimit;
+
+    /** \brief number of players that already arrived (first counter, on a cache line apart from the configuration);
+               the k-th player to arrive takes seat k % nTeamPlayers of team 1 + k / nTeamPlayers */
+    _Alignas(CACHE_LINE) _Atomic int playersArrived;
+    /** \brief number of goalies that already arrived; the k-th goalie to arrive takes seat k % nTeamGoalies (after
+               those of the players) of team 1 + k / nTeamGoalies */
+    _Atomic int goaliesArrived;
     /** \brief number of players that arrived and are free (no team) */
-    int playersFree;
+    _Atomic int playersFree;
     /** \brief number of goalies that arrived and are free (no team) */
-    int goaliesFree;
+    _Atomic int goaliesFree;
 
     /** \brief id of team that will be formed next - initial value=1 */
-    int teamId;
+    _Atomic int teamId;
+
+    /** \brief number of matches already claimed by a referee */
+    int matchesClaimed;
+
+    /** \brief sequence number, odd while the full state is being changed (see statSeqlock.h) */
+    _Atomic unsigned int seq;
+
+    /** \brief state of all intervening entities (from a cache line of its own) */
+    _Alignas(CACHE_LINE) uint8_t st[];
 
 } FULL_STAT;
 
+/** \brief size of the full state of the problem with <tt>nCol</tt> intervening entities (whole cache lines) */
+#define  FULL_STAT_SIZE(nCol)    (sizeof (FULL_STAT) + ((size_t) (nCol) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE)
+
+/** \brief log column of player <tt>id</tt> */
+#define  PLAYER_COL(p_fSt,id)    ((unsigned int) (id))
+/** \brief log column of goalie <tt>id</tt> */
+#define  GOALIE_COL(p_fSt,id)    ((unsigned int) ((p_fSt)->nPlayers + (id)))
+/** \brief log column of referee <tt>id</tt> */
+#define  REFEREE_COL(p_fSt,id)   ((unsigned int) ((p_fSt)->nPlayers + (p_fSt)->nGoalies + (id)))
+/** \brief number of log columns */
+#define  NUM_COLS(p_fSt)         ((unsigned int) ((p_fSt)->nPlayers + (p_fSt)->nGoalies + (p_fSt)->nReferees))
+
+/** \brief state of player <tt>id</tt> */
+#define  PLAYER_STAT(p_fSt,id)   ((p_fSt)->st[PLAYER_COL(p_fSt,id)])
+/** \brief state of goalie <tt>id</tt> */
+#define  GOALIE_STAT(p_fSt,id)   ((p_fSt)->st[GOALIE_COL(p_fSt,id)])
+/** \brief state of referee <tt>id</tt> */
+#define  REFEREE_STAT(p_fSt,id)  ((p_fSt)->st[REFEREE_COL(p_fSt,id)])
+
+
+/* layout checks: the three groups of fields must not share cache lines */
+_Static_assert (offsetof (FULL_STAT, playersArrived) / CACHE_LINE > offsetof (FULL_STAT, lockFree) / CACHE_LINE,
+                "the counters share a cache line with the configuration");
+_Static_assert (offsetof (FULL_STAT, seq) / CACHE_LINE == offsetof (FULL_STAT, playersArrived) / CACHE_LINE,
+                "the counters do not fit in a single cache line");
+_Static_assert (offsetof (FULL_STAT, st) % CACHE_LINE == 0, "the states do not start a cache line");
+_Static_assert (sizeof (FULL_STAT) % CACHE_LINE == 0, "the full state does not end on a cache line boundary");
 
 #endif /* PROBDATASTRUCT_H_ */
@@ -8,9 +8,48 @@
  *
  *  Generator process of the intervening entities.
  *
- *  Upon execution, one parameter is requested:
+ *  Upon execution, the following parameters are accepted:
+ *    \li -r: state changes are recorded in a shared ring buffer and written to the log by this process
+ *    \li -b: as -r, but the log is a binary trace (to be read with traceDecode)
+ *    \li -p n: total number of players (default NUMPLAYERS)
+ *    \li -g n: total number of goalies (default NUMGOALIES)
+ *    \li -P n: number of players in each team (default NUMTEAMPLAYERS)
+ *    \li -G n: number of goalies in each team (default NUMTEAMGOALIES)
+ *    \li -R n: number of referees (default NUMREFEREES)
+ *    \li -M n: number of matches (default 1); with more than one match, the match throughput is reported
+ *    \li -T: the entities are run as threads of this process, instead of as processes of their own
+ *    \li -F n: the entities are run as fibers of this process, by n kernel threads (futex semaphores only)
+ *    \li -s: the semaphore operations are counted, and the counters are printed at the end (they may also be
+ *        read meanwhile with semInspect, or exported by soccerMetrics)
+ *    \li -V: as -F 1 (unless -F is given), but in virtual time: the entities do not really sleep
+ *    \li -L: the teams are formed out of the critical region, by the lock-free matcher (requires -r or -b)
+ *    \li -H file: every full state drained from the ring buffer is also recorded in a state history file, of
+ *        fixed-size records to be memory mapped by analysis tools (requires -r or -b; see stateHistory.h)
+ *    \li -C: the invariants of the run are checked on every state change drained from the ring buffer, and at the
+ *        end of the run (and of each round of a server run); upon a violation, the last state changes are printed
+ *        and the run is aborted, with a failure status (requires -r or -b; see stateCheck.h)
+ *    \li -x seed: seed of the run, from which every entity draws its delays (see entityRandom.h); by default, one
+ *        is taken from the clock and recorded in the binary trace and in the schedule, if any
+ *    \li -X file: the order in which the entities enter the critical region is recorded in a schedule file, with the
+ *        seed of the run (not with -L or -S; see schedule.h)
+ *    \li -Y file: the order recorded in a schedule file is replayed, with its seed (unless -x is given), so that the
+ *        run is repeated exactly (not with -L or -S)
+ *    \li -W s: watchdog: when the run makes no progress (no state change, no entity done) for s seconds, the full
+ *        state, its counters and the semaphores with blocked callers are printed, and the run is aborted, with a
+ *        failure status; the semaphore waits of the entities are limited to 2s seconds, so that they give up even if
+ *        this process is gone (not the waits of the fibers)
+ *    \li -S n: server run, of n rounds of the matches: the entity processes and the IPC resources are kept from
+ *        one round to the next, the full state being reset in between
+ *    \li -e prefix: prefix of the names of the error files of the entity processes (e.g. a directory), so that
+ *        runs at the same time in one directory keep them apart (default none)
+ *    \li -m options: mapping options of the shared region, a comma separated list of <tt>huge</tt> (huge pages),
+ *        <tt>populate</tt> (pages faulted in at once) and <tt>node=n</tt> (pages bound to NUMA node n)
  *    \li name of the logging file.
  *
+ *  With POSIX shared memory (<tt>make SHM=posix</tt>), each run has a key of its own, passed on to the entities in
+ *  the environment (see shmemKey), and many runs may take place at the same time in one directory, with log files
+ *  of their own.
+ *
  *  \author Nuno Lau - December 2024
  */
 
@@ -19,10 +58,16 @@
 #include <stdbool.h>
 #include <unistd.h>
 #include <sys/wait.h>
+#include <signal.h>
+#include <spawn.h>
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <string.h>
+#include <errno.h>
 #include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 #include "probConst.h"
 #include "probDataStruct.h"
@@ -30,6 +75,12 @@
 #include "sharedDataSync.h"
 #include "semaphore.h"
 #include "sharedMemory.h"
+#include "entities.h"
+#include "fiber.h"
+#include "statSeqlock.h"
+#include "entityStage.h"
+#include "entityPool.h"
+#include "schedule.h"
 
 /** \brief name of player program */
 #define   PLAYER               "./player"
@@ -40,23 +91,386 @@
 /** \brief name of referee program */
 #define   REFEREE              "./referee"
 
-void launch_processes(char *bin, char *prefix, int nProc, char *logFilename, int *pids)
+/** \brief time to wait for new ring records when there are none (in us) */
+#define   DRAIN_PERIOD         200
+
+/** \brief time limit of the semaphore waits of the entities, in watchdog periods */
+#define   WAIT_PERIODS         2
+
+/** \brief stack size of the entity threads (in bytes) */
+#define   ENGINE_STACK         (256 * 1024)
+
+/** \brief command line usage */
+#define   USAGE                "Usage: %s [-r|-b] [-T|-F workers] [-V] [-s] [-L] [-C] [-W seconds] [-S rounds]" \
+                               " [-x seed] [-X|-Y schedule]" \
+                               " [-H history] [-e prefix] [-m huge,populate,node=n] [-p players] [-g goalies]" \
+                               " [-P team players] [-G team goalies] [-R referees] [-M matches] [logfile]\n"
+
+/** \brief environment of this process, passed on to the entity processes */
+extern char **environ;
+
+/** \brief entity run by a thread of the in-process engine */
+typedef struct {
+    void (*life) (int id);                                                                 /* life cycle of the entity */
+    int id;                                                                                               /* entity id */
+    pthread_t thread;                                                                     /* thread running the entity */
+} ENTITY;
+
+/** \brief number of entity threads that have finished their life cycle */
+static atomic_uint threadsDone;
+
+/** \brief number of entity threads that have failed (they are left parked, for the run to be aborted) */
+static atomic_uint threadsFailed;
+
+/** \brief resources of the run, released when it is aborted */
+static struct {
+    bool threads;                                                                   /* the entities are run as threads */
+    int shmid, semgid;                                                  /* shared memory and semaphore set identifiers */
+    SHARED_DATA *sh;                                                                       /* pointer to shared region */
+    int *pids[3], nPids[3];                                /* process identifiers of the players, goalies and referees */
+    bool stats;                                                                /* the semaphore operations are counted */
+    unsigned int watchdog;                                          /* time without progress before an abort (0, none) */
+    unsigned int lastSeq, lastDone;                             /* sequence number and entities done at the last check */
+    struct timespec lastProgress;                                                         /* time of the last progress */
+} run;
+
+/**
+ *  \brief Conversion of a numerical command line parameter.
+ *
+ *  The program is terminated if the parameter is not an integer not less than <tt>min</tt>.
+ *
+ *  \param arg parameter
+ *  \param min minimum value
+ *
+ *  \return parameter value
+ */
+static int getCount(char *arg, int min)
 {
-    char idstr[3];
-    char errorFilename[128];
-    int p;
-    for (p = 0; p < nProc; p++) {           
-        if ((pids[p] = fork ()) < 0) {
-            perror ("error on the fork operation");
-            exit (EXIT_FAILURE);
+    char *tinp;                                                                  /* numerical parameters test flag */
+    long val = strtol (arg, &tinp, 0);
+
+    if ((*tinp != '\0') || (val < min) || (val > 1000000)) {
+        fprintf (stderr, "Wrong numerical parameter (\"%s\")\n", arg);
+        exit (EXIT_FAILURE);
+    }
+    return (int) val;
+}
+
+/**
+ *  \brief Conversion of the seed of the run.
+ *
+ *  The program is terminated if the parameter is not an unsigned 64-bit integer.
+ *
+ *  \param arg parameter
+ *
+ *  \return seed
+ */
+static uint64_t getSeed(char *arg)
+{
+    char *tinp;                                                                  /* numerical parameters test flag */
+    unsigned long long val;
+
+    errno = 0;
+    val = strtoull (arg, &tinp, 0);
+    if ((*tinp != '\0') || (*arg == '\0') || (*arg == '-') || (errno != 0)) {
+        fprintf (stderr, "Wrong numerical parameter (\"%s\")\n", arg);
+        exit (EXIT_FAILURE);
+    }
+    return (uint64_t) val;
+}
+
+/**
+ *  \brief Conversion of the mapping options command line parameter.
+ *
+ *  The program is terminated if the parameter is not a comma separated list of <tt>huge</tt>, <tt>populate</tt>
+ *  and <tt>node=n</tt>.
+ *
+ *  \param arg parameter
+ *  \param flags pointer to the location where the mapping options are stored
+ *  \param node pointer to the location where the NUMA node is stored
+ */
+static void getMapOptions(char *arg, unsigned int *flags, int *node)
+{
+    char *const tokens[] = { "huge", "populate", "node", NULL };
+    char *value;
+
+    while (*arg != '\0') {
+        switch (getsubopt (&arg, tokens, &value)) {
+            case 0:  *flags |= SHMEM_HUGE;
+                     break;
+            case 1:  *flags |= SHMEM_POPULATE;
+                     break;
+            case 2:  if (value == NULL) {
+                         fprintf (stderr, "The node mapping option requires a value (node=n)\n");
+                         exit (EXIT_FAILURE);
+                     }
+                     *node = getCount (value, 0);
+                     break;
+            default: fprintf (stderr, "Wrong mapping option (\"%s\")\n", value);
+                     exit (EXIT_FAILURE);
         }
-        sprintf(idstr,"%d", p);
-        sprintf(errorFilename,"error_%s%02d", prefix, p); 
-        if (pids[p] == 0)
-            if (execl (bin, bin, idstr, logFilename, errorFilename, NULL) < 0) { 
-                perror ("error on the generation of the process");
+    }
+}
+
+/**
+ *  \brief Setting the full state to the start of a round: every entity arriving and no team formed.
+ *
+ *  \param sh pointer to the shared region
+ */
+static void resetState(SHARED_DATA *sh)
+{
+    int p, g, r, t;
+
+    for (p = 0; p < sh->fSt.nPlayers; p++) {
+        PLAYER_STAT(&sh->fSt, p)        = ARRIVING;                            /* the players are arriving */
+    }
+    for (g = 0; g < sh->fSt.nGoalies; g++) {
+        GOALIE_STAT(&sh->fSt, g)        = ARRIVING;                            /* the goalies are arriving */
+    }
+    for (r = 0; r < sh->fSt.nReferees; r++) {
+        REFEREE_STAT(&sh->fSt, r)       = ARRIVINGR;                           /* the referees are arriving */
+    }
+    sh->fSt.matchesClaimed   = 0;
+    sh->fSt.playersArrived   = 0;
+    sh->fSt.goaliesArrived   = 0;
+    sh->fSt.playersFree      = 0;
+    sh->fSt.goaliesFree      = 0;
+    sh->fSt.teamId           = 1;
+    for (t = 1; t <= 2 * sh->fSt.nMatches; t++) {
+        atomic_init (&TEAM_SLOT(sh, t)->joined, 0);                                        /* the teams are empty */
+    }
+}
+
+/**
+ *  \brief Printing the state of a run that makes no progress.
+ *
+ *  The full state and its counters are printed, then the value of the mutex and of every semaphore with blocked
+ *  callers, and the semaphore counters, if any.
+ */
+static void dumpRun(void)
+{
+    const char *semNames[] = SEM_NAMES;
+    unsigned int s, m, nWait;
+    int val;
+
+    logDump (stderr, &run.sh->fSt);
+    for (s = 1; s <= SEM_NU(run.sh->fSt.nMatches); s++) {
+        if ((val = semValue (run.semgid, s, &nWait)) == -1) {
+            perror ("error on reading a semaphore");
+            break;
+        }
+        if ((nWait == 0) && (s != MUTEX)) {
+            continue;
+        }
+        if (s < REFEREEWAITTEAMS) {
+            fprintf (stderr, "    %s: value %d, %u blocked\n", semNames[s], val, nWait);
+        }
+        else {
+            m = (s - REFEREEWAITTEAMS) / MATCH_SEM_NU;
+            fprintf (stderr, "    %s of match %u: value %d, %u blocked\n", semNames[s - MATCH_SEM_NU * m], m, val,
+                     nWait);
+        }
+    }
+    if (run.stats) {
+        semStatsPrint (stderr, &run.sh->semStats, semNames);
+    }
+}
+
+/**
+ *  \brief Aborting the run, upon a violation of its invariants.
+ *
+ *  The entity processes are killed and waited for, the log file is closed and the IPC resources are released.
+ *  The entity threads are left blocked: the process exits as soon as the log file is closed and the semaphore set
+ *  is released.
+ */
+static void abortRun(void)
+{
+    int k, p;
+
+    fprintf (stderr, "The run is aborted\n");
+    if (run.threads) {
+        logClose ();
+        semDestroy (run.semgid);
+        _exit (EXIT_FAILURE);
+    }
+    for (k = 0; k < 3; k++) {
+        for (p = 0; p < run.nPids[k]; p++) {
+            kill ((pid_t) run.pids[k][p], SIGKILL);
+        }
+    }
+    while ((wait (NULL) != -1) || (errno == EINTR)) {
+    }
+    logClose ();
+    semDestroy (run.semgid);
+    shmemDettach (run.sh);
+    shmemDestroy (run.shmid);
+    exit (EXIT_FAILURE);
+}
+
+/**
+ *  \brief Watchdog of the run.
+ *
+ *  To be called periodically while waiting for the entities. The run makes progress whenever the full state changes
+ *  (its sequence number moves on) or <tt>done</tt> does; once it makes none for the watchdog time, its state is
+ *  printed and it is aborted (the end of the run is not checked then). Nothing is done without a watchdog.
+ *
+ *  \param done number of entities that are done (or any other count of their progress)
+ */
+static void watchdogCheck(unsigned int done)
+{
+    struct timespec now;
+    unsigned int seq;
+
+    if (run.watchdog == 0) {
+        return;
+    }
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    seq = atomic_load (&run.sh->fSt.seq);
+    if ((seq != run.lastSeq) || (done != run.lastDone)) {
+        run.lastSeq = seq;
+        run.lastDone = done;
+        run.lastProgress = now;
+    }
+    else if ((now.tv_sec - run.lastProgress.tv_sec) + (now.tv_nsec - run.lastProgress.tv_nsec) / 1e9 >=
+             run.watchdog) {
+        fprintf (stderr, "No progress of the run for %u s\n", run.watchdog);
+        dumpRun ();
+        logCheck (&run.sh->fSt, NULL);
+        abortRun ();
+    }
+}
+
+/**
+ *  \brief Waiting for a pool counter to reach <tt>target</tt>, draining the ring meanwhile.
+ *
+ *  The program is terminated if an entity process exits before.
+ *
+ *  \param nFic name of the logging file
+ *  \param sh pointer to the shared region
+ *  \param count pool counter
+ *  \param target value to be reached
+ */
+static void waitPool(char *nFic, SHARED_DATA *sh, _Atomic int *count, int target)
+{
+    int status;
+
+    while (atomic_load (count) < target) {
+        if ((logRingDrain (nFic, &sh->logRing) == 0) && (atomic_load (count) < target)) {
+            if (waitpid (-1, &status, WNOHANG) > 0) {
+                fprintf (stderr, "An entity process exited before the end of the server run\n");
+                exit (EXIT_FAILURE);
+            }
+            watchdogCheck ((unsigned int) atomic_load (count));
+            usleep (DRAIN_PERIOD);
+        }
+    }
+}
+
+/**
+ *  \brief Thread of the in-process engine.
+ *
+ *  \param arg entity to be run
+ */
+static void *entityThread (void *arg)
+{
+    ENTITY *ent = (ENTITY *) arg;
+
+    ent->life (ent->id);
+    atomic_fetch_add (&threadsDone, 1);
+    return NULL;
+}
+
+/**
+ *  \brief Failure of an entity of the in-process engine.
+ *
+ *  The failure is counted and the entity is parked for good: a fiber blocks on a word nobody changes, a thread
+ *  (for which fiberWait just yields) waits for a signal. The main thread then aborts the run.
+ */
+static void entityFailed (void)
+{
+    static _Atomic uint32_t parked = 0;
+
+    atomic_fetch_add (&threadsFailed, 1);
+    while (true) {
+        fiberWait (&parked, 0);
+        pause ();
+    }
+}
+
+/**
+ *  \brief Fiber of the in-process engine.
+ *
+ *  \param arg entity to be run
+ */
+static void entityFiber (void *arg)
+{
+    entityThread (arg);
+}
+
+/**
+ *  \brief Generation of the entity threads, or fibers, of the in-process engine.
+ *
+ *  \param life life cycle of the entities
+ *  \param nThr number of entities
+ *  \param ents entities to be run
+ *  \param fibers true if the entities are run as fibers
+ */
+static void launch_threads(void (*life) (int id), int nThr, ENTITY *ents, bool fibers)
+{
+    pthread_attr_t attr;
+    int t, err;
+
+    pthread_attr_init (&attr);
+    pthread_attr_setstacksize (&attr, ENGINE_STACK);
+    for (t = 0; t < nThr; t++) {
+        ents[t].life = life;
+        ents[t].id = t;
+        if (fibers) {
+            if (fiberSpawn (entityFiber, &ents[t]) == -1) {
+                perror ("error on the generation of the fiber");
                 exit (EXIT_FAILURE);
             }
+        }
+        else if ((err = pthread_create (&ents[t].thread, &attr, entityThread, &ents[t])) != 0) {
+            errno = err;
+            perror ("error on the generation of the thread");
+            exit (EXIT_FAILURE);
+        }
+    }
+    pthread_attr_destroy (&attr);
+}
+
+/**
+ *  \brief Launching <tt>nProc</tt> entity processes running <tt>bin</tt>.
+ *
+ *  The processes are started with <tt>posix_spawn</tt>, which does not copy the address space of this process
+ *  (the new process shares it until it calls exec) and reports a failed exec back here. The argument vector is
+ *  built once and only its id and error file name are rewritten from one process to the next.
+ *
+ *  \param bin executable file of the entity
+ *  \param prefix entity tag in the name of the error files (PL, GL, RF)
+ *  \param nProc number of processes
+ *  \param logFilename name of the logging file
+ *  \param errPrefix prefix of the names of the error files
+ *  \param pids array where the process identifiers are stored
+ */
+void launch_processes(char *bin, char *prefix, int nProc, char *logFilename, char *errPrefix, int *pids)
+{
+    char idstr[12];
+    char errorFilename[256];
+    char *args[] = { bin, idstr, logFilename, errorFilename, NULL };                               /* argument vector */
+    pid_t pid;
+    int p, err;
+
+    for (p = 0; p < nProc; p++) {
+        sprintf(idstr,"%d", p);
+        snprintf(errorFilename, sizeof (errorFilename), "%serror_%s%02d", errPrefix, prefix, p);
+        if ((err = posix_spawn (&pid, bin, NULL, NULL, args, environ)) != 0) {
+            errno = err;
+            perror ("error on the generation of the process");
+            exit (EXIT_FAILURE);
+        }
+        pids[p] = (int) pid;
     }
 }
 
@@ -75,122 +489,445 @@ int main (int argc, char *argv[])
         semgid;                                                                     /* semaphore set access identifier */
     unsigned int  m;                                                                             /* counting variables */
     SHARED_DATA *sh;                                                                /* pointer to shared memory region */
-    int pidPL[NUMPLAYERS],                                                         /* players process identifier array */
-        pidGL[NUMGOALIES],                                                         /* goalies process identifier array */
-        pidRF;                                                                           /* referee process identifier */
+    int *pidPL,                                                                    /* players process identifier array */
+        *pidGL,                                                                    /* goalies process identifier array */
+        *pidRF;                                                                   /* referees process identifier array */
+    ENTITY *ents = NULL;                                                      /* entities run by the in-process engine */
+    int nPlayers = NUMPLAYERS,                                                              /* total number of players */
+        nGoalies = NUMGOALIES,                                                              /* total number of goalies */
+        nTeamPlayers = NUMTEAMPLAYERS,                                                   /* number of players per team */
+        nTeamGoalies = NUMTEAMGOALIES,                                                   /* number of goalies per team */
+        nReferees = NUMREFEREES,                                                           /* total number of referees */
+        nMatches = 1,                                                                    /* number of matches to play */
+        nRounds = 0,                                                        /* rounds of a server run (0, if not one) */
+        nCol;                                                                /* total number of intervening entities */
+    size_t shSize;                                                                      /* size of the shared region */
     int key;                                                           /*access key to shared memory and semaphore set */
     int status,                                                                                    /* execution status */
-        info;                                                                                               /* info id */
+        info,                                                                                               /* info id */
+        failed = 0;                                                             /* number of failed entity processes */
+    bool useRing = false;                                                       /* state changes go through the ring */
+    bool useTrace = false;                                                        /* log file is a binary trace */
+    bool useThreads = false;                                                            /* entities are run as threads */
+    int nWorkers = 0;                                                 /* kernel threads running the fibers (0 if none) */
+    bool useVirtual = false;                                                         /* the fibers run in virtual time */
+    bool useStats = false;                                                     /* the semaphore operations are counted */
+    bool useLockFree = false;                                               /* the teams are formed by the matcher */
+    bool useCheck = false;                                                    /* the invariants of the run are checked */
+    unsigned int watchdog = 0;                                                     /* watchdog time, in s (0, if none) */
+    unsigned int mapFlags = 0;                                                 /* mapping options of the shared region */
+    char *errPrefix = "";                                                      /* prefix of the entity error files */
+    char *histFile = NULL;                                                  /* state history file name (NULL, if none) */
+    char *schedFile = NULL;                                                      /* schedule file name (NULL, if none) */
+    int schedMode = SCHED_OFF;                                                 /* the schedule is recorded or replayed */
+    uint64_t seed = 0;                                                                              /* seed of the run */
+    bool useSeed = false;                                                                    /* the seed is given (-x) */
+    int mapNode = -1;                                                          /* NUMA node of the shared region pages */
+    int opt;                                                                                /* command line option */
+    struct timespec tStart, tEnd;                                                      /* start and end of the run */
 
-    /* getting log file name */
-    if(argc==2) {
-        strcpy(nFic, argv[1]);
+    /* getting options and log file name */
+    while ((opt = getopt (argc, argv, "rbTF:VsLCW:S:H:x:X:Y:e:m:p:g:P:G:R:M:")) != -1) {
+        switch (opt) {
+            case 'r': useRing = true;
+                      break;
+            case 'b': useRing = useTrace = true;
+                      break;
+            case 'T': useThreads = true;
+                      break;
+            case 'F': useThreads = true;
+                      nWorkers = getCount (optarg, 1);
+                      break;
+            case 'V': useThreads = useVirtual = true;
+                      break;
+            case 's': useStats = true;
+                      break;
+            case 'L': useLockFree = true;
+                      break;
+            case 'C': useCheck = true;
+                      break;
+            case 'W': watchdog = (unsigned int) getCount (optarg, 1);
+                      break;
+            case 'S': nRounds = getCount (optarg, 1);
+                      break;
+            case 'H': histFile = optarg;
+                      break;
+            case 'x': seed = getSeed (optarg);
+                      useSeed = true;
+                      break;
+            case 'X': schedFile = optarg;
+                      schedMode = SCHED_RECORD;
+                      break;
+            case 'Y': schedFile = optarg;
+                      schedMode = SCHED_REPLAY;
+                      break;
+            case 'e': errPrefix = optarg;
+                      break;
+            case 'm': getMapOptions (optarg, &mapFlags, &mapNode);
+                      break;
+            case 'p': nPlayers = getCount (optarg, 1);
+                      break;
+            case 'g': nGoalies = getCount (optarg, 1);
+                      break;
+            case 'P': nTeamPlayers = getCount (optarg, 1);
+                      break;
+            case 'G': nTeamGoalies = getCount (optarg, 1);
+                      break;
+            case 'R': nReferees = getCount (optarg, 1);
+                      break;
+            case 'M': nMatches = getCount (optarg, 1);
+                      break;
+            default:  fprintf (stderr, USAGE, argv[0]);
+                      exit (EXIT_FAILURE);
+        }
+    }
+    if (((long) nPlayers < 2L * nTeamPlayers * nMatches) || ((long) nGoalies < 2L * nTeamGoalies * nMatches)) {
+        fprintf (stderr, "There must be enough players and goalies for two teams per match\n");
+        exit (EXIT_FAILURE);
+    }
+    if (useLockFree && !useRing) {
+        fprintf (stderr, "The lock-free matcher requires the ring buffer (-r or -b)\n");
+        exit (EXIT_FAILURE);
+    }
+    if (useCheck && !useRing) {
+        fprintf (stderr, "The checker of the invariants requires the ring buffer (-r or -b)\n");
+        exit (EXIT_FAILURE);
+    }
+    if ((histFile != NULL) && !useRing) {
+        fprintf (stderr, "The state history requires the ring buffer (-r or -b)\n");
+        exit (EXIT_FAILURE);
+    }
+    if (useThreads && ((mapFlags != 0) || (mapNode != -1))) {
+        fprintf (stderr, "The mapping options only apply to the shared region of a multi-process run\n");
+        exit (EXIT_FAILURE);
+    }
+    if ((schedMode != SCHED_OFF) && (useLockFree || (nRounds > 0))) {
+        fprintf (stderr, "The schedule only applies to single runs with the teams formed in the critical region\n");
+        exit (EXIT_FAILURE);
+    }
+    if (useThreads && (nRounds > 0)) {
+        fprintf (stderr, "The entity pool (-S) only applies to multi-process runs\n");
+        exit (EXIT_FAILURE);
+    }
+    if (useVirtual && (nWorkers == 0)) {
+        nWorkers = 1;
+    }
+    if ((nWorkers > 0) && (semWaitHooks (fiberWait, fiberWake) == -1)) {
+        perror ("error on installing the fiber blocking functions (futex semaphores are required)");
+        exit (EXIT_FAILURE);
+    }
+    nCol = nPlayers + nGoalies + nReferees;
+    shSize = SHARED_DATA_SIZE(nCol, 2 * nMatches, nTeamPlayers + nTeamGoalies);
+    if (schedMode != SCHED_OFF) {
+        shSize += SCHED_MAX_TURNS(nPlayers, nGoalies, nReferees, nMatches) * sizeof (uint32_t);
+        shSize = (shSize + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;/* a multiple of the alignment, for aligned_alloc */
+    }
+    if (((pidPL = malloc (nPlayers * sizeof (int))) == NULL) || ((pidGL = malloc (nGoalies * sizeof (int))) == NULL) ||
+        ((pidRF = malloc (nReferees * sizeof (int))) == NULL)) {
+        perror ("error on allocating the process identifier arrays");
+        exit (EXIT_FAILURE);
+    }
+    if (optind < argc) {
+        strncpy (nFic, argv[optind], sizeof (nFic) - 1);
+        nFic[sizeof (nFic) - 1] = '\0';
     }
     else strcpy(nFic, "");
+    if (useTrace && (strlen (nFic) == 0)) {
+        fprintf (stderr, "A binary trace requires a log file name\n");
+        exit (EXIT_FAILURE);
+    }
 
-    /* getting key value */
-    if ((key = ftok (".", 'a')) == -1) {
+    /* getting key value; the in-process engine keeps its semaphore set and its shared data private */
+    if (useThreads) {
+        key = IPC_PRIVATE;
+    }
+    else if ((key = shmemKey (true)) == -1) {
         perror ("error on generating the key");
         exit (EXIT_FAILURE);
     }
 
     /* creating and initializing the shared memory region and the log file */
-    if ((shmid = shmemCreate (key, sizeof (SHARED_DATA))) == -1) { 
-        perror ("error on creating the shared memory region");
-        exit (EXIT_FAILURE);
+    if (useThreads) {
+        if (((sh = aligned_alloc (CACHE_LINE, shSize)) == NULL) ||
+            ((ents = malloc (nCol * sizeof (ENTITY))) == NULL)) {
+            perror ("error on allocating the engine data");
+            exit (EXIT_FAILURE);
+        }
+        memset (sh, 0, shSize);
     }
-    if (shmemAttach (shmid, (void **) &sh) == -1) { 
-        perror ("error on mapping the shared region on the process address space");
-        exit (EXIT_FAILURE);
+    else {
+        if (shmemOptions (mapFlags, mapNode) == -1) {
+            perror ("error on setting the mapping options of the shared memory region");
+            exit (EXIT_FAILURE);
+        }
+        if ((shmid = shmemCreate (key, shSize)) == -1) {
+            perror ("error on creating the shared memory region");
+            exit (EXIT_FAILURE);
+        }
+        if (shmemAttach (shmid, (void **) &sh) == -1) {
+            perror ("error on mapping the shared region on the process address space");
+            shmemDestroy (shmid);
+            exit (EXIT_FAILURE);
+        }
+        run.shmid = shmid;
     }
 
-    /* initialize random generator */
-    srandom ((unsigned int) getpid ());                                
+    /* seed of the run, unless it is given */
+    if (!useSeed) {
+        struct timespec t;
+
+        clock_gettime (CLOCK_MONOTONIC, &t);
+        seed = ((uint64_t) t.tv_sec * 1000000000u + (uint64_t) t.tv_nsec) ^ ((uint64_t) getpid () << 32);
+    }
 
     /* initialize problem internal status */
-    int p;
-    for (p = 0; p < NUMPLAYERS; p++) {
-        sh->fSt.st.playerStat[p]        = ARRIVING;                            /* the players are arriving */
-    }
-    int g;
-    for (g = 0; g < NUMGOALIES; g++) {
-        sh->fSt.st.goalieStat[g]        = ARRIVING;                            /* the goalies are arriving */
-    }
-    sh->fSt.st.refereeStat = ARRIVINGR;                                               /*referee is arriving*/
-    
-    sh->fSt.nPlayers         = NUMPLAYERS;                                              
-    sh->fSt.nGoalies         = NUMGOALIES;
-    sh->fSt.playersArrived   = 0;                                             
-    sh->fSt.goaliesArrived   = 0;                                             
-    sh->fSt.playersFree      = 0;                                             
-    sh->fSt.goaliesFree      = 0;                                             
-    sh->fSt.teamId           = 1;                                             
+    sh->fSt.nPlayers         = nPlayers;                                              
+    sh->fSt.nGoalies         = nGoalies;
+    sh->fSt.nReferees        = nReferees;
+    sh->fSt.nTeamPlayers     = nTeamPlayers;
+    sh->fSt.nTeamGoalies     = nTeamGoalies;
+
+    sh->fSt.nMatches         = nMatches;
+    resetState (sh);
+    atomic_init (&sh->fSt.seq, 0);
+    sh->fSt.lockFree         = useLockFree;
+    sh->fSt.seed             = seed;
+    sh->fSt.waitLimit        = WAIT_PERIODS * 1000 * watchdog;
+    sh->sched.mode           = schedMode;
+    sh->sched.nTurns         = 0;
+    sh->sched.maxTurns       = (schedMode != SCHED_OFF) ?
+                               (uint32_t) SCHED_MAX_TURNS(nPlayers, nGoalies, nReferees, nMatches) : 0;
+    atomic_init (&sh->sched.next, 0);
+    if (schedMode == SCHED_REPLAY) {
+        if (schedLoad (schedFile, sh) == -1) {
+            perror ("error on loading the schedule");
+            if (!useThreads) {
+                shmemDettach (sh);
+                shmemDestroy (shmid);
+            }
+            exit (EXIT_FAILURE);
+        }
+        if (useSeed) {
+            sh->fSt.seed = seed;
+        }
+    }
+    sh->pool.nRounds         = nRounds;
+    atomic_init (&sh->pool.ready, 0);
+    atomic_init (&sh->pool.done, 0);
+    atomic_init (&sh->metrics.matchesStarted, 0);
+    atomic_init (&sh->metrics.matchesEnded, 0);
+    atomic_init (&sh->metrics.teamsFormed, 0);
+    atomic_init (&sh->metrics.playersLate, 0);
+    atomic_init (&sh->metrics.goaliesLate, 0);
 
     /* create log file */
-    createLog (nFic, &sh->fSt);                                  
-    saveState(nFic,&sh->fSt);
+    if (useTrace) {
+        createTrace (nFic, &sh->fSt);
+    }
+    else {
+        createLog (nFic, &sh->fSt);                                  
+        saveState(nFic,&sh->fSt);
+    }
+    logRingInit (&sh->logRing, useRing, &sh->fSt);
+    if (histFile != NULL) {
+        createHistory (histFile, &sh->fSt);
+    }
+    if (useCheck) {
+        logCheck (&sh->fSt, abortRun);
+    }
+    semStatsInit (&sh->semStats, useStats, SEM_STATS_NU, MATCH_SEM_NU, 1u << MUTEX);
 
     /* initialize semaphore ids */
     sh->mutex                       = MUTEX;                                /* mutual exclusion semaphore id */
-    sh->playersWaitTeam             = PLAYERSWAITTEAM;
-    sh->goaliesWaitTeam             = GOALIESWAITTEAM;
     sh->playersWaitReferee          = PLAYERSWAITREFEREE;
     sh->playersWaitEnd              = PLAYERSWAITEND;
     sh->refereeWaitTeams            = REFEREEWAITTEAMS;
-    sh->playerRegistered            = PLAYERREGISTERED;
     sh->playing                     = PLAYING;
+    sh->teamWait                    = TEAMWAIT;
+    sh->teamRegistered              = TEAMREGISTERED;
+    sh->poolStart                   = POOLSTART;
+    sh->poolGo                      = POOLGO;
  
      /* creating and initializing the semaphore set */
-    if ((semgid = semCreate (key, SEM_NU)) == -1) { 
+    if ((semgid = semCreate (key, SEM_NU(nMatches))) == -1) { 
         perror ("error on creating the semaphore set");
         exit (EXIT_FAILURE);
     }
+    semStatsUse (semgid, &sh->semStats);
+    run.threads = useThreads;
+    run.semgid = semgid;
+    run.sh = sh;
+    run.stats = useStats;
+    run.watchdog = watchdog;
     if (semUp (semgid, sh->mutex) == -1) {                             /* enabling access to critical region */
         perror ("error on executing the up operation for semaphore access");
         exit (EXIT_FAILURE);
     }
 
-    /* generation of intervening entities processes */                            
-    /* player processes */
-    launch_processes(PLAYER, "PL", NUMPLAYERS, nFic, pidPL);
-
-    /* goalie processes */
-    launch_processes(GOALIE, "GL", NUMGOALIES, nFic, pidGL);
+    /* generation of intervening entities, as threads of this process or as processes of their own */
+    if (useThreads) {
+        logUseRing (&sh->logRing);
+        stageFailHook (entityFailed);
+        playerBind (sh, semgid, nFic);
+        goalieBind (sh, semgid, nFic);
+        refereeBind (sh, semgid, nFic);
+        if ((nWorkers > 0) && (fiberInit (nCol, useVirtual) == -1)) {
+            perror ("error on initializing the fiber runtime");
+            exit (EXIT_FAILURE);
+        }
+        launch_threads (playerLife, nPlayers, ents, nWorkers > 0);
+        launch_threads (goalieLife, nGoalies, ents + nPlayers, nWorkers > 0);
+        launch_threads (refereeLife, nReferees, ents + nPlayers + nGoalies, nWorkers > 0);
+        if ((nWorkers > 0) && (fiberStart (nWorkers) == -1)) {
+            perror ("error on starting the fiber workers");
+            exit (EXIT_FAILURE);
+        }
+    }
+    else {
+        /* player processes */
+        launch_processes(PLAYER, "PL", nPlayers, nFic, errPrefix, pidPL);
 
-    /* smoker processes */
-    launch_processes(REFEREE, "RF", 1, nFic, &pidRF);
+        /* goalie processes */
+        launch_processes(GOALIE, "GL", nGoalies, nFic, errPrefix, pidGL);
 
+        /* referee processes */
+        launch_processes(REFEREE, "RF", nReferees, nFic, errPrefix, pidRF);
+        run.pids[0] = pidPL;
+        run.nPids[0] = nPlayers;
+        run.pids[1] = pidGL;
+        run.nPids[1] = nGoalies;
+        run.pids[2] = pidRF;
+        run.nPids[2] = nReferees;
+    }
 
     /* signaling start of operations */
+    clock_gettime (CLOCK_MONOTONIC, &tStart);
+    run.lastSeq = atomic_load (&sh->fSt.seq);
+    run.lastProgress = tStart;
     if (semSignal (semgid) == -1) {
         perror ("error on signaling start of operations");
         exit (EXIT_FAILURE);
     }
 
-    /* waiting for the termination of the intervening entities processes */
+    /* server run: releasing the rounds one at a time, the full state being reset in between */
+    for (m = 1; m <= nRounds; m++) {
+        if (m > 1) {
+            logRingDrain (nFic, &sh->logRing);
+            statWriteBegin (&sh->fSt);
+            resetState (sh);
+            statWriteEnd (&sh->fSt);
+            saveRoundStart (nFic, &sh->fSt);
+        }
+        poolStartRound (semgid, sh);
+        waitPool (nFic, sh, &sh->pool.ready, m * nCol);
+        poolGoRound (semgid, sh);
+        if (m < nRounds) {                                                   /* after the last one, the entities exit */
+            waitPool (nFic, sh, &sh->pool.done, m * nCol);
+        }
+    }
+
+    /* waiting for the termination of the intervening entities processes, draining the ring meanwhile */
     m = 0;
-    do {
-        info = wait (&status);
+    if (useThreads) {
+        while (atomic_load (&threadsDone) < (unsigned int) nCol) {
+            if (atomic_load (&threadsFailed) > 0) {
+                fprintf (stderr, "%u entity threads failed\n", atomic_load (&threadsFailed));
+                abortRun ();
+            }
+            if (!useRing || (logRingDrain (nFic, &sh->logRing) == 0)) {
+                watchdogCheck (atomic_load (&threadsDone));
+                usleep (DRAIN_PERIOD);
+            }
+        }
+        if (nWorkers > 0) {
+            fiberJoin ();
+        }
+        else for (m = 0; m < nCol; m++) {
+            pthread_join (ents[m].thread, NULL);
+        }
+    }
+    else do {
+        if (useRing || (watchdog > 0)) {
+            unsigned int n = useRing ? logRingDrain (nFic, &sh->logRing) : 0;
+            if ((info = waitpid (-1, &status, WNOHANG)) == 0) {
+                if (n == 0) {
+                    watchdogCheck (m);
+                    usleep (DRAIN_PERIOD);
+                }
+                continue;
+            }
+        }
+        else info = wait (&status);
         if (info == -1) { 
             perror ("error on aiting for an intervening process");
             exit (EXIT_FAILURE);
         }
+        if (!WIFEXITED (status) || (WEXITSTATUS (status) != 0)) {
+            failed += 1;
+        }
         m += 1;
-    } while (m < 1 + NUMPLAYERS + NUMGOALIES);
+    } while (m < nCol);
+    clock_gettime (CLOCK_MONOTONIC, &tEnd);
+    if (useRing) {
+        logRingDrain (nFic, &sh->logRing);
+    }
+    logClose ();
+    if ((schedMode == SCHED_RECORD) && (schedSave (schedFile, sh) == -1)) {
+        perror ("error on writing the schedule");
+        exit (EXIT_FAILURE);
+    }
+    if (failed > 0) {
+        fprintf (stderr, "%d entity processes failed\n", failed);
+        status = EXIT_FAILURE;
+    }
+    else if ((schedMode == SCHED_REPLAY) && (atomic_load (&sh->sched.next) != sh->sched.nTurns)) {
+        fprintf (stderr, "The run left the schedule after %u of its %u turns\n", atomic_load (&sh->sched.next),
+                 sh->sched.nTurns);
+        status = EXIT_FAILURE;
+    }
+    else status = EXIT_SUCCESS;
+    if (useVirtual) {
+        fprintf (stderr, "simulated time: %.6f s\n", fiberTime () / 1e9);
+    }
+    if (nRounds > 0) {
+        double t = (tEnd.tv_sec - tStart.tv_sec) + (tEnd.tv_nsec - tStart.tv_nsec) / 1e9;
+        fprintf (stderr, "%d rounds of %d matches, %d referees: %.3f s, %.1f matches/s\n", nRounds, nMatches,
+                 nReferees, t, nRounds * nMatches / t);
+    }
+    else if (nMatches > 1) {
+        double t = (tEnd.tv_sec - tStart.tv_sec) + (tEnd.tv_nsec - tStart.tv_nsec) / 1e9;
+        fprintf (stderr, "%d matches, %d referees: %.3f s, %.1f matches/s\n", nMatches, nReferees, t, nMatches / t);
+    }
+
+    if (useStats) {
+        const char *semNames[] = SEM_NAMES;
+
+        semStatsPrint (stderr, &sh->semStats, semNames);
+    }
 
     /* destruction of semaphore set and shared region */
     if (semDestroy (semgid) == -1) {
         perror ("error on destructing the semaphore set");
         exit (EXIT_FAILURE);
     }
-    if (shmemDettach (sh) == -1) { 
-        perror ("error on unmapping the shared region off the process address space");
-        exit (EXIT_FAILURE);
+    if (useThreads) {
+        free (sh);
+        free (ents);
     }
-    if (shmemDestroy (shmid) == -1) { 
-        perror ("error on destructing the shared region");
-        exit (EXIT_FAILURE);
+    else {
+        if (shmemDettach (sh) == -1) {
+            perror ("error on unmapping the shared region off the process address space");
+            exit (EXIT_FAILURE);
+        }
+        if (shmemDestroy (shmid) == -1) {
+            perror ("error on destructing the shared region");
+            exit (EXIT_FAILURE);
+        }
     }
 
-    return EXIT_SUCCESS;
+    free (pidPL);
+    free (pidGL);
+    free (pidRF);
+
+    return status;
 }
@@ -0,0 +1,120 @@
+/**
+ *  \file schedule.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Recording and replay of the order in which the entities enter the critical region.
+ *
+ *  Defined operations:
+ *     \li waiting for the turn of an entity, before entering the critical region (entities)
+ *     \li taking the turn, once in the critical region (entities)
+ *     \li writing the schedule of a run to a file (main process)
+ *     \li loading a schedule from a file into the shared region (main process).
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+
+#include "probDataStruct.h"
+#include "sharedDataSync.h"
+#include "fiber.h"
+#include "schedule.h"
+
+/* external functions */
+
+void schedTurn (SHARED_DATA *sh, unsigned int col)
+{
+    uint32_t next;
+
+    if (sh->sched.mode != SCHED_REPLAY) {
+        return;
+    }
+    while (((next = atomic_load_explicit (&sh->sched.next, memory_order_acquire)) < sh->sched.nTurns) &&
+           (SCHED_TURNS(sh)[next] != col)) {
+        fiberWait (&sh->sched.next, next);
+    }
+}
+
+void schedTaken (SHARED_DATA *sh, unsigned int col)
+{
+    uint32_t next;
+
+    if (sh->sched.mode == SCHED_RECORD) {
+        if (sh->sched.nTurns < sh->sched.maxTurns) {
+            SCHED_TURNS(sh)[sh->sched.nTurns] = col;
+        }
+        sh->sched.nTurns++;                                                    /* counted anyway, to tell an overflow */
+    }
+    else if ((sh->sched.mode == SCHED_REPLAY) &&
+             ((next = atomic_load_explicit (&sh->sched.next, memory_order_relaxed)) < sh->sched.nTurns)) {
+        atomic_store_explicit (&sh->sched.next, next + 1, memory_order_release);
+        fiberWake (&sh->sched.next, INT_MAX);
+    }
+}
+
+int schedSave (char name[], SHARED_DATA *sh)
+{
+    SCHED_HDR hdr;
+    FILE *fic;
+
+    if (sh->sched.nTurns > sh->sched.maxTurns) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+    memset (&hdr, 0, sizeof (hdr));
+    hdr.magic = SCHED_MAGIC;
+    hdr.version = SCHED_VERSION;
+    hdr.nPlayers = (uint32_t) sh->fSt.nPlayers;
+    hdr.nGoalies = (uint32_t) sh->fSt.nGoalies;
+    hdr.nReferees = (uint32_t) sh->fSt.nReferees;
+    hdr.nTeamPlayers = (uint32_t) sh->fSt.nTeamPlayers;
+    hdr.nTeamGoalies = (uint32_t) sh->fSt.nTeamGoalies;
+    hdr.nMatches = (uint32_t) sh->fSt.nMatches;
+    hdr.seed = sh->fSt.seed;
+    hdr.nTurns = sh->sched.nTurns;
+
+    if ((fic = fopen (name, "w")) == NULL) {
+        return -1;
+    }
+    if ((fwrite (&hdr, sizeof (hdr), 1, fic) != 1) ||
+        (fwrite (SCHED_TURNS(sh), sizeof (uint32_t), hdr.nTurns, fic) != hdr.nTurns)) {
+        fclose (fic);
+        return -1;
+    }
+    return fclose (fic);
+}
+
+int schedLoad (char name[], SHARED_DATA *sh)
+{
+    SCHED_HDR hdr;
+    FILE *fic;
+
+    if ((fic = fopen (name, "r")) == NULL) {
+        return -1;
+    }
+    if (fread (&hdr, sizeof (hdr), 1, fic) != 1) {
+        hdr.magic = 0;
+    }
+    if ((hdr.magic != SCHED_MAGIC) || (hdr.version != SCHED_VERSION) ||
+        (hdr.nPlayers != (uint32_t) sh->fSt.nPlayers) || (hdr.nGoalies != (uint32_t) sh->fSt.nGoalies) ||
+        (hdr.nReferees != (uint32_t) sh->fSt.nReferees) || (hdr.nTeamPlayers != (uint32_t) sh->fSt.nTeamPlayers) ||
+        (hdr.nTeamGoalies != (uint32_t) sh->fSt.nTeamGoalies) || (hdr.nMatches != (uint32_t) sh->fSt.nMatches) ||
+        (hdr.nTurns > sh->sched.maxTurns) ||
+        (fread (SCHED_TURNS(sh), sizeof (uint32_t), hdr.nTurns, fic) != hdr.nTurns)) {
+        fclose (fic);
+        errno = EINVAL;
+        return -1;
+    }
+    fclose (fic);
+    sh->fSt.seed = hdr.seed;
+    sh->sched.nTurns = hdr.nTurns;
+    atomic_init (&sh->sched.next, 0);
+    return 0;
+}
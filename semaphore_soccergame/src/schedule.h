@@ -0,0 +1,115 @@
+/**
+ *  \file schedule.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Recording and replay of the order in which the entities enter the critical region.
+ *
+ *  With the teams formed in the critical region, the course of a run (the seats taken in the teams, the matches
+ *  claimed by the referees, the order of the state changes) only depends on that order. Recorded (option -X of the
+ *  main process) with the seed of the run, it is enough to repeat the run exactly (option -Y): on replay, an entity
+ *  only tries to enter the critical region on its turn, so a slow or deadlocking schedule may be reproduced and
+ *  profiled at will.
+ *
+ *  Defined operations:
+ *     \li waiting for the turn of an entity, before entering the critical region (entities)
+ *     \li taking the turn, once in the critical region (entities)
+ *     \li writing the schedule of a run to a file (main process)
+ *     \li loading a schedule from a file into the shared region (main process).
+ *
+ *  The schedule file is a header followed by the log column of each turn (32 bits each). An entity waiting for its
+ *  turn is parked if it is a fiber; otherwise it yields the processor until its turn comes (see fiberWait).
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#ifndef SCHEDULE_H_
+#define SCHEDULE_H_
+
+#include <stdint.h>
+
+#include "sharedDataSync.h"
+
+/** \brief schedule file magic number ("SGSC") */
+#define  SCHED_MAGIC      0x43534753u
+/** \brief schedule file format version */
+#define  SCHED_VERSION    1
+
+/**
+ *  \brief Definition of <em>schedule file header</em> data type.
+ *
+ *  The configuration of the run must be the same on replay.
+ */
+typedef struct {
+    /** \brief magic number, SCHED_MAGIC */
+    uint32_t magic;
+    /** \brief format version, SCHED_VERSION */
+    uint32_t version;
+    /** \brief total number of players */
+    uint32_t nPlayers;
+    /** \brief total number of goalies */
+    uint32_t nGoalies;
+    /** \brief total number of referees */
+    uint32_t nReferees;
+    /** \brief number of players in each team */
+    uint32_t nTeamPlayers;
+    /** \brief number of goalies in each team */
+    uint32_t nTeamGoalies;
+    /** \brief number of matches */
+    uint32_t nMatches;
+    /** \brief seed of the run */
+    uint64_t seed;
+    /** \brief number of turns */
+    uint32_t nTurns;
+    /** \brief reserved, 0 */
+    uint32_t reserved;
+} SCHED_HDR;
+
+/**
+ *  \brief Waiting for the turn of an entity to enter the critical region.
+ *
+ *  To be called just before the down operation on the mutex. Nothing is done unless a schedule is replayed, or once
+ *  all its turns have been taken.
+ *
+ *  \param sh pointer to the shared region
+ *  \param col log column of the entity
+ */
+extern void schedTurn (SHARED_DATA *sh, unsigned int col);
+
+/**
+ *  \brief Taking the turn of an entity, once in the critical region.
+ *
+ *  To be called just after the down operation on the mutex: the turn is recorded, or the next one is let in (replay).
+ *
+ *  \param sh pointer to the shared region
+ *  \param col log column of the entity
+ */
+extern void schedTaken (SHARED_DATA *sh, unsigned int col);
+
+/**
+ *  \brief Writing the schedule recorded in a run to a file.
+ *
+ *  \param name name of the file
+ *  \param sh pointer to the shared region
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>; EOVERFLOW, if the turns
+ *          did not fit in the shared region)
+ */
+extern int schedSave (char name[], SHARED_DATA *sh);
+
+/**
+ *  \brief Loading a schedule into the shared region, to be replayed.
+ *
+ *  The seed of the run is set to the one of the schedule.
+ *
+ *  \param name name of the file
+ *  \param sh pointer to the shared region, whose configuration is already set
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>; EINVAL, if the file is
+ *          not a schedule of this version or it was recorded with another configuration)
+ */
+extern int schedLoad (char name[], SHARED_DATA *sh);
+
+#endif /* SCHEDULE_H_ */
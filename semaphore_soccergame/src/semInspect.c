@@ -0,0 +1,164 @@
+/**
+ *  \file semInspect.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Inspector of a run in progress: it attaches to the shared region of the run started in the same directory and
+ *  prints the team formation counters, the teams being formed, the number of entities in each state and the
+ *  semaphore counters (the run must have been started with option -s for the latter).
+ *  The full state is read through its sequence lock: nothing is written to the shared region.
+ *
+ *  Upon execution, the following parameters are accepted:
+ *    \li -i n: print every n ms, until the run is over (by default, print once)
+ *    \li -k key: creation key of the run (by default, the one of shmemKey): with POSIX shared memory, each run
+ *        has a key of its own, which is the process id of its generator.
+ *
+ *  Only multi-process runs may be inspected, as the in-process engines keep their data private.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "sharedDataSync.h"
+#include "sharedMemory.h"
+#include "statSeqlock.h"
+
+/** \brief command line usage */
+#define   USAGE                "Usage: %s [-i interval] [-k key]\n"
+
+/**
+ *  \brief Printing the number of entities of one kind in each state.
+ *
+ *  \param kind name of the kind of entity
+ *  \param st state of the entities of that kind
+ *  \param n number of entities of that kind
+ */
+static void printStates (const char *kind, uint8_t st[], int n)
+{
+    unsigned int count[256] = { 0 };
+    int i;
+
+    for (i = 0; i < n; i++) {
+        count[st[i]]++;
+    }
+    printf ("%-8s", kind);
+    for (i = 0; i < 256; i++) {
+        if (count[i] != 0) {
+            printf (" %c:%u", (char) i, count[i]);
+        }
+    }
+    printf ("\n");
+}
+
+/**
+ *  \brief Printing the teams being formed, with the number of members that already joined each one.
+ *
+ *  \param sh pointer to the shared region
+ */
+static void printTeams (SHARED_DATA *sh)
+{
+    int size = sh->fSt.nTeamPlayers + sh->fSt.nTeamGoalies;
+    int t, joined;
+    int shown = 0;                                                                    /* number of teams printed */
+
+    printf ("teams being formed:");
+    for (t = 1; t <= 2 * sh->fSt.nMatches; t++) {
+        joined = atomic_load_explicit (&TEAM_SLOT(sh, t)->joined, memory_order_relaxed);
+        if ((joined > 0) && (joined < size)) {
+            printf (" %d:%d/%d", t, joined, size);
+            shown++;
+        }
+    }
+    printf ("%s\n", (shown == 0) ? " none" : "");
+}
+
+/**
+ *  \brief Printing the present counters of the run.
+ *
+ *  The full state is read through its sequence lock, so the run is never slowed down by taking the mutex.
+ *
+ *  \param sh pointer to the shared region
+ *  \param fSt pointer to the location where the snapshot of the full state is stored
+ */
+static void inspect (SHARED_DATA *sh, FULL_STAT *fSt)
+{
+    const char *semNames[] = SEM_NAMES;
+    unsigned int retries;
+
+    retries = statSnapshot (&sh->fSt, fSt);
+    printf ("players arrived %d free %d, goalies arrived %d free %d, next team %d, matches claimed %d of %d"
+            " (snapshot %u, %u retries)\n", fSt->playersArrived, fSt->playersFree, fSt->goaliesArrived,
+            fSt->goaliesFree, fSt->teamId, fSt->matchesClaimed, fSt->nMatches, fSt->seq / 2, retries);
+    printTeams (sh);
+    printStates ("players", &PLAYER_STAT(fSt, 0), fSt->nPlayers);
+    printStates ("goalies", &GOALIE_STAT(fSt, 0), fSt->nGoalies);
+    printStates ("referees", &REFEREE_STAT(fSt, 0), fSt->nReferees);
+    if (sh->semStats.enabled) {
+        semStatsPrint (stdout, &sh->semStats, semNames);
+    }
+    else printf ("semaphore counters not enabled (option -s of the main process)\n");
+    fflush (stdout);
+}
+
+/**
+ *  \brief Main program.
+ *
+ *  Its role is to attach to the shared region of a run in progress and to print its counters.
+ */
+int main (int argc, char *argv[])
+{
+    int key = -1, shmid, opt;
+    int interval = 0;                                                                    /* printing interval (in ms) */
+    SHARED_DATA *sh;
+    FULL_STAT *fSt;                                                                     /* snapshot of the full state */
+
+    while ((opt = getopt (argc, argv, "i:k:")) != -1) {
+        switch (opt) {
+            case 'i': interval = atoi (optarg);
+                      break;
+            case 'k': key = (int) strtol (optarg, NULL, 0);
+                      break;
+            default:  fprintf (stderr, USAGE, argv[0]);
+                      return EXIT_FAILURE;
+        }
+    }
+
+    if ((key == -1) && ((key = shmemKey (false)) == -1)) {
+        perror ("error on generating the key");
+        return EXIT_FAILURE;
+    }
+    if ((shmid = shmemConnect (key)) == -1) {
+        perror ("error on connecting to the shared memory region (is a run in progress?)");
+        return EXIT_FAILURE;
+    }
+    if (shmemAttach (shmid, (void **) &sh) == -1) {
+        perror ("error on mapping the shared region on the process address space");
+        return EXIT_FAILURE;
+    }
+
+    if ((fSt = aligned_alloc (CACHE_LINE, FULL_STAT_SIZE(NUM_COLS(&sh->fSt)))) == NULL) {
+        perror ("error on allocating the snapshot");
+        return EXIT_FAILURE;
+    }
+
+    inspect (sh, fSt);
+    while (interval > 0) {
+        usleep (1000 * interval);
+        if (shmemConnect (key) == -1) {                                                            /* the run is over */
+            break;
+        }
+        printf ("\n");
+        inspect (sh, fSt);
+    }
+
+    free (fSt);
+    shmemDettach (sh);
+    return EXIT_SUCCESS;
+}
@@ -6,11 +6,9 @@
  *  Synchronization based on semaphores and shared memory.
  *  Implementation with SVIPC.
  *
- *  Definition of the operations carried out by the goalie:
- *     \li arriving
- *     \li goalieConstituteTeam
- *     \li waitReferee
- *     \li playUntilEnd
+ *  Binding of the goalies to the life cycle of the team members (see member.h):
+ *     \li binding of the kind
+ *     \li life cycle of a goalie.
  *
  *  \author Nuno Lau - December 2024
  */
@@ -31,12 +29,18 @@
 #include "sharedDataSync.h"
 #include "semaphore.h"
 #include "sharedMemory.h"
+#include "entities.h"
+#include "entityPool.h"
+#include "entityStage.h"
+#include "member.h"
 
 /** \brief logging file name */
 static char nFic[51];
 
+#ifndef SOCCERGAME_ENGINE
 /** \brief shared memory block access identifier */
 static int shmid;
+#endif
 
 /** \brief semaphore set access identifier */
 static int semgid;
@@ -44,18 +48,54 @@ static int semgid;
 /** \brief pointer to shared memory region */
 static SHARED_DATA *sh;
 
-/** \brief goalie takes some time to arrive */
-static void arrive (int id);
+/** \brief the goalies, as a kind of team member */
+static MEMBER_KIND kind;
 
-/** \brief goalie constitutes team */
-static int goalieConstituteTeam (int id);
+/**
+ *  \brief Binding of the goalies, as a kind of team member.
+ *
+ *  Their log columns, and their seats in the roster of a team, follow those of the players.
+ */
+static void bindKind (void)
+{
+    stageBind (&kind.role, sh, semgid, nFic, "GL");
+    kind.col0 = GOALIE_COL(&sh->fSt, 0);
+    kind.arrived = &sh->fSt.goaliesArrived;
+    kind.free = &sh->fSt.goaliesFree;
+    kind.late = &sh->metrics.goaliesLate;
+    kind.perTeam = sh->fSt.nTeamGoalies;
+    kind.seat0 = sh->fSt.nTeamPlayers;
+    kind.delay = 60.0;
+}
 
-/** \brief goalie waits for referee to start match */
-static void waitReferee(int id, int team);
+/**
+ *  \brief Binding of the goalies to the simulation.
+ *
+ *  Used by the in-process engine, where the shared data and the semaphore set are the generator's own.
+ *
+ *  \param shared pointer to the shared data
+ *  \param semSet semaphore set access identifier
+ *  \param logFile logging file name
+ */
+void goalieBind (SHARED_DATA *shared, int semSet, char *logFile)
+{
+    sh = shared;
+    semgid = semSet;
+    strncpy (nFic, logFile, sizeof (nFic) - 1);
+    bindKind ();
+}
 
-/** \brief goalie waits for referee to end match */
-static void playUntilEnd(int id, int team);
+/**
+ *  \brief Life cycle of the goalie.
+ *
+ *  \param id goalie id
+ */
+void goalieLife (int id)
+{
+    memberLife (&kind, id);
+}
 
+#ifndef SOCCERGAME_ENGINE
 /**
  *  \brief Main program.
  *
@@ -65,7 +105,7 @@ int main (int argc, char *argv[])
 {
     int key;                                            /*access key to shared memory and semaphore set */
     char *tinp;                                                       /* numerical parameters test flag */
-    int n, team;
+    int n;
 
     /* validation of command line parameters */
     if (argc != 4) { 
@@ -76,7 +116,7 @@ int main (int argc, char *argv[])
     
     /* get goalie id - argv[1]*/
     n = (unsigned int) strtol (argv[1], &tinp, 0);
-    if ((*tinp != '\0') || (n >= NUMGOALIES )) { 
+    if ((*tinp != '\0') || (n < 0)) { 
         fprintf (stderr, "Goalie process identification is wrong!\n");
         return EXIT_FAILURE;
     }
@@ -89,7 +129,7 @@ int main (int argc, char *argv[])
     setbuf(stderr,NULL);
 
     /* getting key value */
-    if ((key = ftok (".", 'a')) == -1) {
+    if ((key = shmemKey (false)) == -1) {
         perror ("error on generating the key");
         exit (EXIT_FAILURE);
     }
@@ -108,15 +148,17 @@ int main (int argc, char *argv[])
         perror ("error on mapping the shared region on the process address space");
         return EXIT_FAILURE;
     }
+    logUseRing (&sh->logRing);
+    semStatsUse (semgid, &sh->semStats);
+    bindKind ();
+    if (n >= sh->fSt.nGoalies) {
+        fprintf (stderr, "Goalie process identification is wrong!\n");
+        return EXIT_FAILURE;
+    }
 
-    /* initialize random generator */
-    srandom ((unsigned int) getpid ());              
-
-    /* simulation of the life cycle of the goalie */
-    arrive(n);
-    if((team = goalieConstituteTeam(n))!=0) {
-        waitReferee(n, team);
-        playUntilEnd(n, team);
+    /* simulation of the life cycle of the goalie, once or, in a server run, once per round */
+    while (poolNextRound (semgid, sh)) {
+        goalieLife(n);
     }
 
     /* unmapping the shared region off the process address space */
@@ -127,211 +169,4 @@ int main (int argc, char *argv[])
 
     return EXIT_SUCCESS;
 }
-
-/**
- *  \brief goalie takes some time to arrive
- *
- *  Goalie updates state and takes some time to arrive
- *  The internal state should be saved.
- *
- */
-static void arrive(int id)
-{
-    if (semDown(semgid, sh->mutex) == -1)
-    { /* enter critical region */
-        perror("error on the down operation for semaphore access (GL)");
-        exit(EXIT_FAILURE);
-    }
-    sh->fSt.st.goalieStat[id] = ARRIVING;
-    saveState(nFic, &sh->fSt);
-
-    if (semUp(semgid, sh->mutex) == -1)
-    { /* exit critical region */
-        perror("error on the up operation for semaphore access (GL)");
-        exit(EXIT_FAILURE);
-    }
-
-    usleep((200.0 * random()) / (RAND_MAX + 1.0) + 60.0);
-}
-
-/**
- *  \brief goalie constitutes team
- *
- *  If goalie is late, it updates state and leaves.
- *  If there are enough free players to form a team, goalie forms team allowing team members to 
- *  proceed and waiting for them to acknowledge registration.
- *  Otherwise it updates state, waits for the forming teammate to "call" him, saves its team
- *  and acknowledges registration.
- *  The internal state should be saved.
- *
- *  \param id goalie id
- * 
- *  \return id of goalie team (0 for late goalies; 1 for team 1; 2 for team 2)
- *
- */
-static int goalieConstituteTeam(int id)
-{
-    int ret = 0;
-    if (semDown(semgid, sh->mutex) == -1)
-    { /* enter critical region */
-        perror("error on the down operation for semaphore access (GL)");
-        exit(EXIT_FAILURE);
-    }
-    sh->fSt.goaliesArrived++;
-
-    //verificar se há 4 jogadores livres
-    //para os players, verificar se ha mais 3 jogadores livres e um goalie -- NOT HERE :v
-    if (sh->fSt.goaliesArrived > (NUMTEAMGOALIES * 2))
-    {
-        sh->fSt.st.goalieStat[id] = LATE;
-        saveState(nFic, &sh->fSt);
-    }
-    else
-    {
-
-        if (sh->fSt.playersFree >= NUMTEAMPLAYERS)
-        {
-            sh->fSt.st.goalieStat[id] = FORMING_TEAM;
-            sh->fSt.playersFree -= NUMTEAMPLAYERS;
-            saveState(nFic, &sh->fSt);
-
-            //goalie fica à espera que os jogadores entrem na equipa
-            //down dentro da região critica mas é necessário :(
-            for (int i = 0; i < NUMTEAMPLAYERS; i++)
-            {
-                if (semUp(semgid, sh->playersWaitTeam) == -1)
-                {
-                    perror("error on the up operation for semaphore access (GL)");
-                    exit(EXIT_FAILURE);
-                }
-            }
-
-            for (int i = 0; i < NUMTEAMPLAYERS; i++)
-            {
-                if (semDown(semgid, sh->playerRegistered) == -1)
-                {
-                    perror("error on the down operation for semaphore access (GL)");
-                    exit(EXIT_FAILURE);
-                }
-            }
-
-            ret = sh->fSt.teamId;
-            sh->fSt.teamId++; //team formed, now on to other team to be formed
-            if (semUp(semgid, sh->refereeWaitTeams) == -1)
-            {
-                perror("error on the up operation for semaphore access (GL)");
-                exit(EXIT_FAILURE);
-            }
-        }
-        else
-        {
-            sh->fSt.st.goalieStat[id] = WAITING_TEAM;
-            sh->fSt.goaliesFree++;
-            saveState(nFic, &sh->fSt);
-        }
-    }
-    if (semUp(semgid, sh->mutex) == -1)
-    { /* exit critical region */
-        perror("error on the up operation for semaphore access (GL)");
-        exit(EXIT_FAILURE);
-    }
-
-    if (sh->fSt.st.goalieStat[id] == WAITING_TEAM)
-    {
-        if (semDown(semgid, sh->goaliesWaitTeam) == -1)
-        {
-            perror("error on the down operation for semaphore access (GL)");
-            exit(EXIT_FAILURE);
-        }
-
-        ret = sh->fSt.teamId;
-
-        if (semUp(semgid, sh->playerRegistered) == -1)
-        { /* exit critical region */
-            perror("error on the up operation for semaphore access (GL)");
-            exit(EXIT_FAILURE);
-        }
-    }
-
-    return ret;
-}
-
-/**
- *  \brief goalie waits for referee to start match
- *
- *  The goalie updates its state and waits for referee to start match.  
- *  The internal state should be saved.
- *
- *  \param id   goalie id
- *  \param team goalie team
- */
-static void waitReferee(int id, int team)
-{
-    if (semDown(semgid, sh->mutex) == -1)
-    { /* enter critical region */
-        perror("error on the down operation for semaphore access (GL)");
-        exit(EXIT_FAILURE);
-    }
-
-    if (team == 1)
-    {
-        sh->fSt.st.goalieStat[id] = WAITING_START_1;
-        saveState(nFic, &sh->fSt);
-    }
-    else
-    {
-        sh->fSt.st.goalieStat[id] = WAITING_START_2;
-        saveState(nFic, &sh->fSt);
-    }
-
-    if (semUp(semgid, sh->mutex) == -1)
-    { /* exit critical region */
-        perror("error on the up operation for semaphore access (GL)");
-        exit(EXIT_FAILURE);
-    }
-
-    if (semDown(semgid, sh->playersWaitReferee) == -1)
-    {
-        perror("error on the up operation for semaphore access (RF)");
-        exit(EXIT_FAILURE);
-    }
-}
-
-/**
- *  \brief goalie waits for referee to end match
- *
- *  The goalie updates its state and waits for referee to end match.  
- *  The internal state should be saved.
- *
- *  \param id   goalie id
- *  \param team goalie team
- */
-static void playUntilEnd(int id, int team)
-{
-    if (semDown(semgid, sh->mutex) == -1)
-    { /* enter critical region */
-        perror("error on the down operation for semaphore access (GL)");
-        exit(EXIT_FAILURE);
-    }
-
-    if (team == 1)
-    {
-        sh->fSt.st.goalieStat[id] = PLAYING_1;
-        saveState(nFic, &sh->fSt);
-    }
-    else
-    {
-        sh->fSt.st.goalieStat[id] = PLAYING_2;
-        saveState(nFic, &sh->fSt);
-    }
-    if (semUp(semgid, sh->mutex) == -1)
-    { /* exit critical region */
-        perror("error on the up operation for semaphore access (GL)");
-        exit(EXIT_FAILURE);
-    }
-    if (semDown(semgid, sh->playersWaitEnd) == -1)
-    {
-        perror("error on the up operation for semaphore access (GL)");
-        exit(EXIT_FAILURE);
-    }
-}
+#endif /* SOCCERGAME_ENGINE */
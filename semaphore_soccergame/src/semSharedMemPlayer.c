@@ -6,11 +6,9 @@
  *  Synchronization based on semaphores and shared memory.
  *  Implementation with SVIPC.
  *
- *  Definition of the operations carried out by the players:
- *     \li arrive
- *     \li playerConstituteTeam
- *     \li waitReferee
- *     \li playUntilEnd
+ *  Binding of the players to the life cycle of the team members (see member.h):
+ *     \li binding of the kind
+ *     \li life cycle of a player.
  *
  *  \author Nuno Lau - December 2024
  */
@@ -30,12 +28,18 @@
 #include "sharedDataSync.h"
 #include "semaphore.h"
 #include "sharedMemory.h"
+#include "entities.h"
+#include "entityPool.h"
+#include "entityStage.h"
+#include "member.h"
 
 /** \brief logging file name */
 static char nFic[51];
 
+#ifndef SOCCERGAME_ENGINE
 /** \brief shared memory block access identifier */
 static int shmid;
+#endif
 
 /** \brief semaphore set access identifier */
 static int semgid;
@@ -43,18 +47,54 @@ static int semgid;
 /** \brief pointer to shared memory region */
 static SHARED_DATA *sh;
 
-/** \brief player takes some time to arrive */
-static void arrive (int id);
+/** \brief the players, as a kind of team member */
+static MEMBER_KIND kind;
 
-/** \brief player constitutes team */
-static int playerConstituteTeam (int id);
+/**
+ *  \brief Binding of the players, as a kind of team member.
+ *
+ *  Their log columns come first, and so do their seats in the roster of a team.
+ */
+static void bindKind (void)
+{
+    stageBind (&kind.role, sh, semgid, nFic, "PL");
+    kind.col0 = PLAYER_COL(&sh->fSt, 0);
+    kind.arrived = &sh->fSt.playersArrived;
+    kind.free = &sh->fSt.playersFree;
+    kind.late = &sh->metrics.playersLate;
+    kind.perTeam = sh->fSt.nTeamPlayers;
+    kind.seat0 = 0;
+    kind.delay = 50.0;
+}
 
-/** \brief player waits for referee to start match */
-static void waitReferee(int id, int team);
+/**
+ *  \brief Binding of the players to the simulation.
+ *
+ *  Used by the in-process engine, where the shared data and the semaphore set are the generator's own.
+ *
+ *  \param shared pointer to the shared data
+ *  \param semSet semaphore set access identifier
+ *  \param logFile logging file name
+ */
+void playerBind (SHARED_DATA *shared, int semSet, char *logFile)
+{
+    sh = shared;
+    semgid = semSet;
+    strncpy (nFic, logFile, sizeof (nFic) - 1);
+    bindKind ();
+}
 
-/** \brief player waits for referee to end match */
-static void playUntilEnd(int id, int team);
+/**
+ *  \brief Life cycle of the player.
+ *
+ *  \param id player id
+ */
+void playerLife (int id)
+{
+    memberLife (&kind, id);
+}
 
+#ifndef SOCCERGAME_ENGINE
 /**
  *  \brief Main program.
  *
@@ -64,7 +104,7 @@ int main (int argc, char *argv[])
 {
     int key;                                            /*access key to shared memory and semaphore set */
     char *tinp;                                                       /* numerical parameters test flag */
-    int n, team;
+    int n;
 
     /* validation of command line parameters */
     if (argc != 4) { 
@@ -74,9 +114,9 @@ int main (int argc, char *argv[])
     }
     
 
-    /* get goalie id - argv[1]*/
+    /* get player id - argv[1]*/
     n = (unsigned int) strtol (argv[1], &tinp, 0);
-    if ((*tinp != '\0') || (n >= NUMPLAYERS )) { 
+    if ((*tinp != '\0') || (n < 0)) { 
         fprintf (stderr, "Player process identification is wrong!\n");
         return EXIT_FAILURE;
     }
@@ -90,7 +130,7 @@ int main (int argc, char *argv[])
 
 
     /* getting key value */
-    if ((key = ftok (".", 'a')) == -1) {
+    if ((key = shmemKey (false)) == -1) {
         perror ("error on generating the key");
         exit (EXIT_FAILURE);
     }
@@ -109,16 +149,18 @@ int main (int argc, char *argv[])
         perror ("error on mapping the shared region on the process address space");
         return EXIT_FAILURE;
     }
-
-    /* initialize random generator */
-    srandom ((unsigned int) getpid ());                                                 
+    logUseRing (&sh->logRing);
+    semStatsUse (semgid, &sh->semStats);
+    bindKind ();
+    if (n >= sh->fSt.nPlayers) {
+        fprintf (stderr, "Player process identification is wrong!\n");
+        return EXIT_FAILURE;
+    }
 
 
-    /* simulation of the life cycle of the player */
-    arrive(n);
-    if((team = playerConstituteTeam(n))!=0) {
-        waitReferee(n, team);
-        playUntilEnd(n, team);
+    /* simulation of the life cycle of the player, once or, in a server run, once per round */
+    while (poolNextRound (semgid, sh)) {
+        playerLife(n);
     }
 
     /* unmapping the shared region off the process address space */
@@ -129,221 +171,4 @@ int main (int argc, char *argv[])
 
     return EXIT_SUCCESS;
 }
-
-/**
- *  \brief player takes some time to arrive
- *
- *  Player updates state and takes some time to arrive
- *  The internal state should be saved.
- *
- */
-static void arrive(int id)
-{
-
-    if (semDown(semgid, sh->mutex) == -1)
-    { /* enter critical region */
-        perror("error on the down operation for semaphore access (PL)");
-        exit(EXIT_FAILURE);
-    }
-
-    sh->fSt.st.playerStat[id] = ARRIVING;
-    saveState(nFic, &sh->fSt);
-    if (semUp(semgid, sh->mutex) == -1)
-    { /* exit critical region */
-        perror("error on the up operation for semaphore access (PL)");
-        exit(EXIT_FAILURE);
-    }
-
-    usleep((200.0 * random()) / (RAND_MAX + 1.0) + 50.0);
-}
-
-/**
- *  \brief player constitutes team
- *
- *  If player is late, it updates state and leaves.
- *  If there are enough free players and free goalies to form a team, player forms team allowing 
- *  team members to proceed and waiting for them to acknowledge registration.
- *  Otherwise it updates state, waits for the forming teammate to "call" him, saves its team
- *  and acknowledges registration.
- *  The internal state should be saved.
- *
- *  \param id player id
- * 
- *  \return id of player team (0 for late goalies; 1 for team 1; 2 for team 2)
- *
- */
-static int playerConstituteTeam(int id)
-{
-    int ret = 0;
-    if (semDown(semgid, sh->mutex) == -1)
-    { /* enter critical region */
-        perror("error on the down operation for semaphore access (PL)");
-        exit(EXIT_FAILURE);
-    }
-
-    sh->fSt.playersArrived++;
-
-    if (sh->fSt.playersArrived > NUMTEAMPLAYERS * 2) //este menos um é para compensar o "eu" que acabou de chegar
-    {
-        sh->fSt.st.playerStat[id] = LATE;
-        saveState(nFic, &sh->fSt);
-    }
-    else
-    {
-
-        if (sh->fSt.playersFree >= NUMTEAMPLAYERS - 1 && sh->fSt.goaliesFree >= NUMTEAMGOALIES)
-        {
-
-            sh->fSt.st.playerStat[id] = FORMING_TEAM;
-
-            sh->fSt.goaliesFree -= NUMTEAMGOALIES;
-            sh->fSt.playersFree -= (NUMTEAMPLAYERS - 1); //não se subtrai a si proprio
-            saveState(nFic, &sh->fSt);
-
-            for (int i = 0; i < NUMTEAMPLAYERS - 1; i++)
-            {
-                if (semUp(semgid, sh->playersWaitTeam) == -1)
-                {
-                    perror("error on the up operation for semaphore access (PL)");
-                    exit(EXIT_FAILURE);
-                }
-            }
-            if (semUp(semgid, sh->goaliesWaitTeam) == -1)
-            {
-                perror("error on the up operation for semaphore access (PL)");
-                exit(EXIT_FAILURE);
-            }
-
-            for (int i = 0; i < NUMTEAMPLAYERS - 1; i++)
-            {
-
-                if (semDown(semgid, sh->playerRegistered) == -1)
-                {
-                    perror("error on the down operation for semaphore access (PL)");
-                    exit(EXIT_FAILURE);
-                }
-            }
-            ret = sh->fSt.teamId;
-            sh->fSt.teamId++;
-            if (semUp(semgid, sh->refereeWaitTeams) == -1)
-            {
-                perror("error on the up operation for semaphore access (PL)");
-                exit(EXIT_FAILURE);
-            }
-        }
-        else
-        {
-            sh->fSt.st.playerStat[id] = WAITING_TEAM;
-            sh->fSt.playersFree++;
-            saveState(nFic, &sh->fSt);
-        }
-    }
-    if (semUp(semgid, sh->mutex) == -1)
-    { /* exit critical region */
-        perror("error on the up operation for semaphore access (PL)");
-        exit(EXIT_FAILURE);
-    }
-
-    if (sh->fSt.st.playerStat[id] == WAITING_TEAM)
-    {
-
-        if (semDown(semgid, sh->playersWaitTeam) == -1)
-        {
-            perror("error on the down operation for semaphore access (PL)");
-            exit(EXIT_FAILURE);
-        }
-
-        ret = sh->fSt.teamId;
-
-        if (semUp(semgid, sh->playerRegistered) == -1)
-        {
-            perror("error on the up operation for semaphore access (PL)");
-            exit(EXIT_FAILURE);
-        }
-    }
-
-    return ret;
-}
-
-/**
- *  \brief player waits for referee to start match
- *
- *  The player updates its state and waits for referee to end match.  
- *  The internal state should be saved.
- *
- *  \param id   player id
- *  \param team player team
- */
-static void waitReferee(int id, int team)
-{
-
-    if (semDown(semgid, sh->mutex) == -1)
-    { /* enter critical region */
-        perror("error on the down operation for semaphore access (PL)");
-        exit(EXIT_FAILURE);
-    }
-
-    if (team == 1)
-    {
-        sh->fSt.st.playerStat[id] = WAITING_START_1;
-        saveState(nFic, &sh->fSt);
-    }
-    else
-    {
-        sh->fSt.st.playerStat[id] = WAITING_START_2;
-        saveState(nFic, &sh->fSt);
-    }
-    if (semUp(semgid, sh->mutex) == -1)
-    { /* exit critical region */
-        perror("error on the up operation for semaphore access (PL)");
-        exit(EXIT_FAILURE);
-    }
-
-    if (semDown(semgid, sh->playersWaitReferee) == -1)
-    {
-        perror("error on the up operation for semaphore access (RF)");
-        exit(EXIT_FAILURE);
-    }
-}
-
-/**
- *  \brief player waits for referee to end match
- *
- *  The player updates its state and waits for referee to end match.  
- *  The internal state should be saved.
- *
- *  \param id   player id
- *  \param team player team
- */
-static void playUntilEnd(int id, int team)
-{
-    if (semDown(semgid, sh->mutex) == -1)
-    { /* enter critical region */
-        perror("error on the down operation for semaphore access (PL)");
-        exit(EXIT_FAILURE);
-    }
-
-    if (team == 1)
-    {
-        sh->fSt.st.playerStat[id] = PLAYING_1;
-        saveState(nFic, &sh->fSt);
-    }
-    else
-    {
-        sh->fSt.st.playerStat[id] = PLAYING_2;
-        saveState(nFic, &sh->fSt);
-    }
-    if (semUp(semgid, sh->mutex) == -1)
-    { /* exit critical region */
-        perror("error on the up operation for semaphore access (PL)");
-        exit(EXIT_FAILURE);
-    }
-    if (semDown(semgid, sh->playersWaitEnd) == -1)
-    {
-        perror("error on the up operation for semaphore access (PL)");
-        exit(EXIT_FAILURE);
-    }
-}
-
-
-
+#endif /* SOCCERGAME_ENGINE */
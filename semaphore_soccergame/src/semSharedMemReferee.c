@@ -8,6 +8,7 @@
  *
  *  Definition of the operations carried out by the referee:
  *     \li arrive
+ *     \li claimMatch
  *     \li waitForTeams
  *     \li startGame
  *     \li play
@@ -34,13 +35,20 @@
 #include "sharedDataSync.h"
 #include "semaphore.h"
 #include "sharedMemory.h"
+#include "entities.h"
+#include "entityPool.h"
+#include "fiber.h"
+#include "entityRandom.h"
+#include "entityStage.h"
 
 
 /** \brief logging file name */
 static char nFic[51];
 
+#ifndef SOCCERGAME_ENGINE
 /** \brief shared memory block access identifier */
 static int shmid;
+#endif
 
 /** \brief semaphore set access identifier */
 static int semgid;
@@ -48,21 +56,68 @@ static int semgid;
 /** \brief pointer to shared memory region */
 static SHARED_DATA *sh;
 
+/** \brief binding of the referees to the stages of their life cycle */
+static STAGE_ROLE role;
+
 /** \brief referee takes some time to arrive */
-static void arrive ();
+static void arrive (int id, ENTITY_RNG *rng);
+
+/** \brief referee claims the next match to be refereed */
+static int claimMatch (int id);
+
+/** \brief the two teams of a match are full */
+static bool teamsFull (int match);
 
 /** \brief referee waits for teams to be formed */
-static void waitForTeams ();
+static void waitForTeams (int id, int match);
 
 /** \brief referee starts game */
-static void startGame ();
+static void startGame (int id, int match);
 
 /** \brief referee takes some time to allow game to finish */
-static void play ();
+static void play (int id, ENTITY_RNG *rng);
 
 /** \brief referee ends game */
-static void endGame ();
+static void endGame (int id, int match);
+
+/**
+ *  \brief Binding of the referees to the simulation.
+ *
+ *  Used by the in-process engine, where the shared data and the semaphore set are the generator's own.
+ *
+ *  \param shared pointer to the shared data
+ *  \param semSet semaphore set access identifier
+ *  \param logFile logging file name
+ */
+void refereeBind (SHARED_DATA *shared, int semSet, char *logFile)
+{
+    sh = shared;
+    semgid = semSet;
+    strncpy (nFic, logFile, sizeof (nFic) - 1);
+    stageBind (&role, sh, semgid, nFic, "RF");
+}
 
+/**
+ *  \brief Life cycle of the referee.
+ *
+ *  \param id referee id
+ */
+void refereeLife (int id)
+{
+    ENTITY_RNG rng;                                                                        /* generator of the delays */
+    int match;
+
+    rngSeed (&rng, sh->fSt.seed, REFEREE_COL(&sh->fSt, id), poolRound (sh));
+    arrive(id, &rng);
+    while ((match = claimMatch(id)) >= 0) {
+        waitForTeams(id, match);
+        startGame(id, match);
+        play(id, &rng);
+        endGame(id, match);
+    }
+}
+
+#ifndef SOCCERGAME_ENGINE
 /**
  *  \brief Main program.
  *
@@ -71,6 +126,8 @@ static void endGame ();
 int main (int argc, char *argv[])
 {
     int key;                                          /*access key to shared memory and semaphore set */
+    char *tinp;                                                     /* numerical parameters test flag */
+    int n;
 
     /* validation of command line parameters */
     if (argc != 4) { 
@@ -79,7 +136,12 @@ int main (int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
-    /* argv[1] may be ignored as there is only one referee - id=0 */
+    /* get referee id - argv[1]*/
+    n = (unsigned int) strtol (argv[1], &tinp, 0);
+    if ((*tinp != '\0') || (n < 0)) { 
+        fprintf (stderr, "Referee process identification is wrong!\n");
+        return EXIT_FAILURE;
+    }
 
     /* get logfile name - argv[2]*/
     strcpy (nFic, argv[2]);
@@ -89,7 +151,7 @@ int main (int argc, char *argv[])
     setbuf(stderr,NULL);
 
     /* getting key value */
-    if ((key = ftok (".", 'a')) == -1) {
+    if ((key = shmemKey (false)) == -1) {
         perror ("error on generating the key");
         exit (EXIT_FAILURE);
     }
@@ -108,16 +170,18 @@ int main (int argc, char *argv[])
         perror ("error on mapping the shared region on the process address space");
         return EXIT_FAILURE;
     }
+    logUseRing (&sh->logRing);
+    semStatsUse (semgid, &sh->semStats);
+    stageBind (&role, sh, semgid, nFic, "RF");
+    if (n >= sh->fSt.nReferees) {
+        fprintf (stderr, "Referee process identification is wrong!\n");
+        return EXIT_FAILURE;
+    }
 
-    /* initialize random generator */
-    srandom ((unsigned int) getpid ());                                      
-
-    /* simulation of the life cycle of the referee */
-    arrive();
-    waitForTeams();
-    startGame();
-    play();
-    endGame();
+    /* simulation of the life cycle of the referee, once or, in a server run, once per round */
+    while (poolNextRound (semgid, sh)) {
+        refereeLife(n);
+    }
 
     /* unmapping the shared region off the process address space */
     if (shmemDettach (sh) == -1) { 
@@ -127,161 +191,139 @@ int main (int argc, char *argv[])
 
     return EXIT_SUCCESS;
 }
+#endif /* SOCCERGAME_ENGINE */
 
 /**
  *  \brief referee takes some time to arrive
  *
  *  Referee updates state and takes some time to arrive
+ *  With the ring buffer in use, the critical region is not entered (see stageState).
  *  The internal state should be saved.
  *
+ *  \param id referee id
+ *  \param rng pointer to the generator of the delays of the referee
  */
-static void arrive ()
+static void arrive (int id, ENTITY_RNG *rng)
 {
-    if (semDown (semgid, sh->mutex) == -1) {                                                      /* enter critical region */
-        perror ("error on the down operation for semaphore access (RF)");
-        exit (EXIT_FAILURE);
+    stageRefereeArrive (&role, REFEREE_COL(&sh->fSt, id));
+    fiberSleep(100.0*rngUniform(rng)+10.0);
+}
+
+/**
+ *  \brief referee claims the next match to be refereed
+ *
+ *  Matches are claimed in order, so the first teams to be formed are the first to play.
+ *
+ *  \param id referee id
+ *
+ *  \return match id (0, 1, ...), or -1 if all matches have already been claimed
+ */
+static int claimMatch (int id)
+{
+    int match = -1;
+
+    stageEnter (&role, REFEREE_COL(&sh->fSt, id));                                           /* enter critical region */
+    if (sh->fSt.matchesClaimed < sh->fSt.nMatches) {
+        match = sh->fSt.matchesClaimed++;
     }
+    stageLeave (&role);                                                                      /* leave critical region */
 
-    /* TODO: insert your code here */
-    sh->fSt.st.refereeStat = ARRIVING;
-    saveState(nFic, &sh->fSt);
+    return match;
+}
 
+/**
+ *  \brief the two teams of a match are full
+ *
+ *  Only the team slots of the match are looked at: the teams of other matches may be formed in any order.
+ *
+ *  \param match match id
+ *
+ *  \return true if every member of both teams has joined them
+ */
+static bool teamsFull (int match)
+{
+    int size = sh->fSt.nTeamPlayers + sh->fSt.nTeamGoalies;
 
-    if (semUp (semgid, sh->mutex) == -1) {                                                        /* leave critical region */
-        perror ("error on the up operation for semaphore access (RF)");
-        exit (EXIT_FAILURE);
-    }
-    
-    usleep((100.0*random())/(RAND_MAX+1.0)+10.0);
-   
+    return (atomic_load (&TEAM_SLOT(sh, 2 * match + 1)->joined) == size) &&
+           (atomic_load (&TEAM_SLOT(sh, 2 * match + 2)->joined) == size);
 }
 
 /**
  *  \brief referee waits for teams to be formed
  *
- *  Referee updates state and waits for the 2 teams to be completely formed
+ *  Referee updates state and waits for the 2 teams of the match to be completely formed
+ *  With the ring buffer in use, the critical region is not entered (see stageState).
  *  The internal state should be saved.
  *
+ *  \param id    referee id
+ *  \param match match id
  */
-static void waitForTeams ()
+static void waitForTeams (int id, int match)
 {
-    if (semDown (semgid, sh->mutex) == -1) {                                                      /* enter critical region */
-        perror ("error on the down operation for semaphore access (RF)");
-        exit (EXIT_FAILURE);
-    }
-
-    /* TODO: insert your code here */
-    if (sh->fSt.teamId < 3) {
-        sh->fSt.st.refereeStat = WAITING_TEAMS;
-        saveState(nFic, &sh->fSt);
-    }
-
+    LOG_SNAP snap = { .pending = false };                                                /* state change, if any */
 
-    if (semUp (semgid, sh->mutex) == -1) {                                                        /* leave critical region */
-        perror ("error on the up operation for semaphore access (RF)");
-        exit (EXIT_FAILURE);
+    if (OWN_STATE_FREE(sh)) {
+        if (!teamsFull (match)) {
+            stageState (&role, REFEREE_COL(&sh->fSt, id), WAITING_TEAMS);
+        }
     }
-
-    /* TODO: insert your code here */
-    for (int i = 0; i < 2; i++) {       // 2 downs - 2 equipas
-        if (semDown (semgid, sh->refereeWaitTeams) == -1) {
-            perror ("error on the down operation for semaphore access (RF)");
-            exit (EXIT_FAILURE);
+    else {
+        stageEnter (&role, REFEREE_COL(&sh->fSt, id));                                       /* enter critical region */
+        if (!teamsFull (match)) {
+            REFEREE_STAT(&sh->fSt, id) = WAITING_TEAMS;
+            snapStateChange(nFic, &sh->fSt, REFEREE_COL(&sh->fSt, id), &snap);
         }
+        stageLeave (&role);                                                                  /* leave critical region */
+        commitStateChange (&snap);
     }
 
+    stageDown (&role, MATCH_SEM(sh->refereeWaitTeams, match), 2);                              /* 2 downs - 2 equipas */
 }
 
 /**
  *  \brief referee starts game
  *
  *  Referee updates state and notifies players and goalies to start match
+ *  With the ring buffer in use, the critical region is not entered (see stageState).
  *  The internal state should be saved.
  *
+ *  \param id    referee id
+ *  \param match match id
  */
-static void startGame ()
+static void startGame (int id, int match)
 {
-    if (semDown (semgid, sh->mutex) == -1) {                                                      /* enter critical region */
-        perror ("error on the down operation for semaphore access (RF)");
-        exit (EXIT_FAILURE);
-    }
-
-    /* TODO: insert your code here */
-    sh->fSt.st.refereeStat = STARTING_GAME;
-    saveState(nFic, &sh->fSt);
-
-
-    if (semUp (semgid, sh->mutex) == -1) {                                                        /* leave critical region */
-        perror ("error on the up operation for semaphore access (RF)");
-        exit (EXIT_FAILURE);
-    }
-
-    /* TODO: insert your code here */
-    for (int i = 0; i < (NUMTEAMGOALIES+NUMTEAMPLAYERS)*2; i++) {
-        if (semUp (semgid, sh->playersWaitReferee) == -1) {
-            perror ("error on the up operation for semaphore access (RF)");
-            exit (EXIT_FAILURE);
-        }
-    }
-
+    stageRefereeStart (&role, REFEREE_COL(&sh->fSt, id), match);
+    atomic_fetch_add_explicit (&sh->metrics.matchesStarted, 1, memory_order_relaxed);
 }
 
 /**
  *  \brief referee takes some time to allow game to finish
  *
  *  Referee updates state and takes some time to finish the game 
+ *  With the ring buffer in use, the critical region is not entered (see stageState).
  *  The internal state should be saved.
  *
+ *  \param id referee id
+ *  \param rng pointer to the generator of the delays of the referee
  */
-static void play ()
+static void play (int id, ENTITY_RNG *rng)
 {
-    if (semDown (semgid, sh->mutex) == -1) {                                                      /* enter critical region */
-        perror ("error on the down operation for semaphore access (RF)");
-        exit (EXIT_FAILURE);
-    }
-
-    /* TODO: insert your code here */
-    sh->fSt.st.refereeStat = REFEREEING;
-    saveState(nFic, &sh->fSt);
-
-    if (semUp (semgid, sh->mutex) == -1) {                                                        /* leave critical region */
-        perror ("error on the up operation for semaphore access (RF)");
-        exit (EXIT_FAILURE);
-    }
-
-    usleep((100.0*random())/(RAND_MAX+1.0)+900.0);
+    stageRefereePlay (&role, REFEREE_COL(&sh->fSt, id));
+    fiberSleep(100.0*rngUniform(rng)+900.0);
 }
 
 /**
  *  \brief referee ends game
  *
  *  Referee updates state and notifies players and goalies to end match
+ *  With the ring buffer in use, the critical region is not entered (see stageState).
  *  The internal state should be saved.
  *
+ *  \param id    referee id
+ *  \param match match id
  */
-static void endGame ()
+static void endGame (int id, int match)
 {
-    if (semDown (semgid, sh->mutex) == -1) {                                                      /* enter critical region */
-        perror ("error on the down operation for semaphore access (RF)");
-        exit (EXIT_FAILURE);
-    }
-
-    /* TODO: insert your code here */
-    sh->fSt.st.refereeStat = ENDING_GAME;
-    saveState(nFic, &sh->fSt);
-
-
-    if (semUp (semgid, sh->mutex) == -1) {                                                        /* leave critical region */
-        perror ("error on the up operation for semaphore access (RF)");
-        exit (EXIT_FAILURE);
-    }
-
-    /* TODO: insert your code here */
-    for (int i = 0; i < (NUMTEAMGOALIES+NUMTEAMPLAYERS)*2; i++) {
-        if (semUp (semgid, sh->playersWaitEnd) == -1) {
-            perror ("error on the up operation for semaphore access (RF)");
-            exit (EXIT_FAILURE);
-        }
-    }
-
-}
\ No newline at end of file
+    stageRefereeEnd (&role, REFEREE_COL(&sh->fSt, id), match);
+    atomic_fetch_add_explicit (&sh->metrics.matchesEnded, 1, memory_order_release);           /* after matchesStarted */
+}
@@ -0,0 +1,164 @@
+/**
+ *  \file semStats.c (implementation file)
+ *
+ *  \brief Semaphore instrumentation.
+ *
+ *  Defined operations:
+ *     \li initialization of the counters block
+ *     \li selection of the block where this process counts the operations on a semaphore set
+ *     \li counting a <em>down</em> (and the time it was blocked) and an <em>up</em> (used by the semaphore
+ *         implementations)
+ *     \li printing the counters.
+ *
+ *  The counters are updated with atomic operations, as they are shared by all processes of a run.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "semStats.h"
+
+/** \brief set whose operations are counted by this process (-1 if none) */
+static int statsSet = -1;
+
+/** \brief block where they are counted */
+static SEM_STATS *stats = NULL;
+
+/* internal functions */
+
+static unsigned int bucket (uint64_t ns)
+{
+    unsigned int k = 0;
+
+    while ((ns >>= 1) != 0) {
+        k++;
+    }
+    return (k < SEMSTATS_HIST) ? k : SEMSTATS_HIST - 1;
+}
+
+static void maxUpdate (_Atomic uint64_t *max, uint64_t val)
+{
+    uint64_t cur = atomic_load_explicit (max, memory_order_relaxed);
+
+    while ((val > cur) && !atomic_compare_exchange_weak_explicit (max, &cur, val, memory_order_relaxed,
+                                                                   memory_order_relaxed)) {
+    }
+}
+
+/* upper bound of the bucket where the fraction q of the samples is reached, at most the largest sample max (in us) */
+static double quantile (_Atomic uint64_t hist[], uint64_t n, double q, uint64_t max)
+{
+    double bound;
+    uint64_t sum = 0;
+    unsigned int k;
+
+    for (k = 0; k < SEMSTATS_HIST; k++) {
+        sum += atomic_load (&hist[k]);
+        if (sum >= q * n) {
+            break;
+        }
+    }
+    bound = (double) (2ull << ((k < SEMSTATS_HIST) ? k : SEMSTATS_HIST - 1));
+    return ((bound < max) ? bound : max) / 1e3;
+}
+
+/* external functions */
+
+void semStatsInit (SEM_STATS *st, bool enabled, unsigned int nSlots, unsigned int period, uint32_t lockMask)
+{
+    memset (st, 0, sizeof (SEM_STATS));
+    st->enabled = enabled;
+    st->nSlots = (nSlots > SEMSTATS_SLOTS) ? SEMSTATS_SLOTS : nSlots;
+    st->period = ((period == 0) || (period > st->nSlots)) ? 1 : period;
+    st->lockMask = lockMask;
+}
+
+void semStatsUse (int semgid, SEM_STATS *st)
+{
+    if (st->enabled) {
+        statsSet = semgid;
+        stats = st;
+    }
+}
+
+SEM_STATS *semStatsFor (int semgid)
+{
+    return ((stats != NULL) && (semgid == statsSet)) ? stats : NULL;
+}
+
+uint64_t semStatsNow (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+void semStatsDown (SEM_STATS *st, unsigned int sindex, bool blocked, uint64_t t0)
+{
+    unsigned int s = SEMSTATS_SLOT(st, sindex);
+    SEM_COUNTERS *c = &st->slot[s];
+    uint64_t t = semStatsNow (), wait = t - t0;
+
+    atomic_fetch_add_explicit (&c->downs, 1, memory_order_relaxed);
+    if (blocked) {
+        atomic_fetch_add_explicit (&c->contended, 1, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit (&c->waitNs, wait, memory_order_relaxed);
+    atomic_fetch_add_explicit (&c->waitHist[bucket (wait)], 1, memory_order_relaxed);
+    maxUpdate (&c->waitMax, wait);
+    if (st->lockMask & (1u << s)) {
+        atomic_store_explicit (&c->acquiredAt, t, memory_order_relaxed);
+    }
+}
+
+void semStatsUp (SEM_STATS *st, unsigned int sindex)
+{
+    unsigned int s = SEMSTATS_SLOT(st, sindex);
+    SEM_COUNTERS *c = &st->slot[s];
+    uint64_t t0, hold;
+
+    atomic_fetch_add_explicit (&c->ups, 1, memory_order_relaxed);
+    if ((st->lockMask & (1u << s)) && ((t0 = atomic_load_explicit (&c->acquiredAt, memory_order_relaxed)) != 0)) {
+        hold = semStatsNow () - t0;
+        atomic_fetch_add_explicit (&c->holds, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit (&c->holdNs, hold, memory_order_relaxed);
+        atomic_fetch_add_explicit (&c->holdHist[bucket (hold)], 1, memory_order_relaxed);
+        maxUpdate (&c->holdMax, hold);
+    }
+}
+
+void semStatsPrint (FILE *fic, SEM_STATS *st, const char *names[])
+{
+    unsigned int s;
+    uint64_t downs, holds, max;
+    SEM_COUNTERS *c;
+    char num[12];
+
+    fprintf (fic, "%-20s %10s %10s %10s %10s %10s %10s %10s %10s %10s\n", "semaphore", "downs", "ups", "blocked",
+             "wait_avg", "wait_p99", "wait_max", "hold_avg", "hold_p99", "hold_max");
+    for (s = 1; s < st->nSlots; s++) {
+        c = &st->slot[s];
+        sprintf (num, "%u", s);
+        downs = atomic_load (&c->downs);
+        fprintf (fic, "%-20s %10llu %10llu %10llu", (names != NULL) ? names[s] : num, (unsigned long long) downs,
+                 (unsigned long long) atomic_load (&c->ups), (unsigned long long) atomic_load (&c->contended));
+        if (downs > 0) {
+            max = atomic_load (&c->waitMax);
+            fprintf (fic, " %10.2f %10.2f %10.2f", atomic_load (&c->waitNs) / 1e3 / downs,
+                     quantile (c->waitHist, downs, 0.99, max), max / 1e3);
+        }
+        else fprintf (fic, " %10s %10s %10s", "-", "-", "-");
+        if ((holds = atomic_load (&c->holds)) > 0) {
+            max = atomic_load (&c->holdMax);
+            fprintf (fic, " %10.2f %10.2f %10.2f", atomic_load (&c->holdNs) / 1e3 / holds,
+                     quantile (c->holdHist, holds, 0.99, max), max / 1e3);
+        }
+        else fprintf (fic, " %10s %10s %10s", "-", "-", "-");
+        fprintf (fic, "\n");
+    }
+    fprintf (fic, "(times in us; the p99 ones are upper bounds of power of two buckets, down to the max)\n");
+}
@@ -0,0 +1,155 @@
+/**
+ *  \file semStats.h (interface file)
+ *
+ *  \brief Semaphore instrumentation.
+ *
+ *  Optional per semaphore counters, kept in a block of shared memory so that every process of a run adds to the
+ *  same ones, and an inspector may read them while the run is going on.
+ *  Defined operations:
+ *     \li initialization of the counters block
+ *     \li selection of the block where this process counts the operations on a semaphore set
+ *     \li counting a <em>down</em> (and the time it was blocked) and an <em>up</em> (used by the semaphore
+ *         implementations)
+ *     \li printing the counters.
+ *
+ *  For the semaphores used as locks, the time between the <em>down</em> and the next <em>up</em> (the hold time) is
+ *  also measured.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#ifndef SEMSTATS_H_
+#define SEMSTATS_H_
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+/** \brief maximum number of counter slots */
+#define  SEMSTATS_SLOTS   16
+
+/** \brief number of histogram buckets: bucket k counts the times in [2^k, 2^(k+1)) ns */
+#define  SEMSTATS_HIST    32
+
+/** \brief alignment of the counters of each slot (a cache line, so that the slots of different semaphores do not
+           share one) */
+#define  SEMSTATS_ALIGN   64
+
+/**
+ *  \brief Definition of <em>semaphore counters</em> data type.
+ */
+typedef struct {
+    /** \brief number of <em>down</em> operations */
+    _Alignas(SEMSTATS_ALIGN) _Atomic uint64_t downs;
+    /** \brief number of <em>up</em> operations */
+    _Atomic uint64_t ups;
+    /** \brief number of <em>down</em> operations that had to block */
+    _Atomic uint64_t contended;
+    /** \brief total time spent in <em>down</em> operations (in ns) */
+    _Atomic uint64_t waitNs;
+    /** \brief longest time spent in a <em>down</em> operation (in ns) */
+    _Atomic uint64_t waitMax;
+    /** \brief histogram of the time spent in <em>down</em> operations */
+    _Atomic uint64_t waitHist[SEMSTATS_HIST];
+    /** \brief time of the last <em>down</em> of a lock (CLOCK_MONOTONIC, in ns) */
+    _Atomic uint64_t acquiredAt;
+    /** \brief number of times a lock was held */
+    _Atomic uint64_t holds;
+    /** \brief total hold time of a lock (in ns) */
+    _Atomic uint64_t holdNs;
+    /** \brief longest hold time of a lock (in ns) */
+    _Atomic uint64_t holdMax;
+    /** \brief histogram of the hold time of a lock */
+    _Atomic uint64_t holdHist[SEMSTATS_HIST];
+} SEM_COUNTERS;
+
+/**
+ *  \brief Definition of <em>semaphore counters block</em> data type.
+ *
+ *  Semaphore <tt>i</tt> of the set is counted in slot <tt>i</tt>, if <tt>i < nSlots</tt>; the ones beyond are
+ *  folded onto the last <tt>period</tt> slots (see SEMSTATS_SLOT), so that repeated groups of semaphores, as the
+ *  ones of each match, share their counters.
+ */
+typedef struct {
+    /** \brief true when the operations are to be counted */
+    bool enabled;
+    /** \brief number of slots in use */
+    unsigned int nSlots;
+    /** \brief folding period of the semaphores beyond the last slot */
+    unsigned int period;
+    /** \brief slots of the semaphores used as locks (bit i for slot i) */
+    uint32_t lockMask;
+    /** \brief counters */
+    SEM_COUNTERS slot[SEMSTATS_SLOTS];
+} SEM_STATS;
+
+/** \brief slot where semaphore <tt>i</tt> is counted */
+#define  SEMSTATS_SLOT(p_st, i)  (((i) < (p_st)->nSlots) ? (i) : \
+                                  (p_st)->nSlots - (p_st)->period + ((i) - (p_st)->nSlots) % (p_st)->period)
+
+/**
+ *  \brief Initialization of the counters block.
+ *
+ *  \param st pointer to the block
+ *  \param enabled true if the operations are to be counted
+ *  \param nSlots number of slots in use (1 .. SEMSTATS_SLOTS)
+ *  \param period folding period of the semaphores beyond the last slot (1 .. nSlots)
+ *  \param lockMask slots of the semaphores used as locks
+ */
+extern void semStatsInit (SEM_STATS *st, bool enabled, unsigned int nSlots, unsigned int period, uint32_t lockMask);
+
+/**
+ *  \brief Selection of the block where this process counts the operations on a semaphore set.
+ *
+ *  Nothing is counted if the block is not enabled.
+ *
+ *  \param semgid set identifier
+ *  \param st pointer to the block
+ */
+extern void semStatsUse (int semgid, SEM_STATS *st);
+
+/**
+ *  \brief Block where the operations on a semaphore set are counted.
+ *
+ *  \param semgid set identifier
+ *
+ *  \return pointer to the block, or NULL if the operations on the set are not counted
+ */
+extern SEM_STATS *semStatsFor (int semgid);
+
+/**
+ *  \brief Present time.
+ *
+ *  \return CLOCK_MONOTONIC time (in ns)
+ */
+extern uint64_t semStatsNow (void);
+
+/**
+ *  \brief Counting a <em>down</em>, once it is carried out.
+ *
+ *  \param st pointer to the block
+ *  \param sindex semaphore location in the set
+ *  \param blocked true if the caller was blocked
+ *  \param t0 time the operation was started (see semStatsNow)
+ */
+extern void semStatsDown (SEM_STATS *st, unsigned int sindex, bool blocked, uint64_t t0);
+
+/**
+ *  \brief Counting an <em>up</em>, before it is carried out.
+ *
+ *  \param st pointer to the block
+ *  \param sindex semaphore location in the set
+ */
+extern void semStatsUp (SEM_STATS *st, unsigned int sindex);
+
+/**
+ *  \brief Printing the counters, one line per slot in use.
+ *
+ *  \param fic output stream
+ *  \param st pointer to the block
+ *  \param names names of the slots (NULL for the slot numbers)
+ */
+extern void semStatsPrint (FILE *fic, SEM_STATS *st, const char *names[]);
+
+#endif /* SEMSTATS_H_ */
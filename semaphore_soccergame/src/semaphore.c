@@ -9,20 +9,84 @@
  *     \li destruction of a previously created set of semaphores
  *     \li signalling start of operations
  *     \li <em>down</em> of a semaphore within the set
- *     \li <em>up</em> of a semaphore within the set.
+ *     \li <em>up</em> of a semaphore within the set
+ *     \li counted <em>down</em> and <em>up</em> of a semaphore within the set
+ *     \li <em>down</em> of a semaphore within the set, with a time limit
+ *     \li atomic operation on several semaphores within the set
+ *     \li reading the value of a semaphore within the set.
+ *
+ *  The operations are counted in the block selected with semStatsUse, if any.
  *
  *  \author António Rui Borges - October 1995
  */
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
+#include <errno.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/sem.h>
 #include <assert.h>
 
+#include "semaphore.h"
+#include "semStats.h"
+
 /** \brief access permission: user r-w */
 #define  MASK           0600
 
+/* internal functions */
+
+/* validation of the operations of semMultiOp; the set itself is checked by semop */
+static bool opsValid (SEM_OP ops[], unsigned int nops)
+{
+  unsigned int i, k;
+
+  if ((nops == 0) || (nops > SEMOPS_MAX))
+     return false;
+  for (i = 0; i < nops; i++)
+  { assert(ops[i].sindex>0);
+    if ((ops[i].delta == 0) || (ops[i].delta < -32767) || (ops[i].delta > 32767))
+       return false;
+    for (k = 0; k < i; k++)
+      if ((ops[k].sindex == ops[i].sindex) && ((ops[k].delta > 0) != (ops[i].delta > 0)))
+         return false;                                                                      /* a down and an up on it */
+  }
+  return true;
+}
+
+/* semop (semtimedop, with a time limit), counting the operations when the set is instrumented: a first try without
+   blocking tells whether the caller has to block */
+static int semOps (int semgid, struct sembuf *op, unsigned int nops, const struct timespec *tmo)
+{
+  SEM_STATS *st;
+  uint64_t t0;
+  bool blocked = false;
+  unsigned int i;
+  int stat;
+
+  if ((st = semStatsFor (semgid)) == NULL)
+     return semtimedop (semgid, op, nops, tmo);
+  for (i = 0; i < nops; i++)
+    if (op[i].sem_op > 0)
+       semStatsUp (st, op[i].sem_num);                               /* before the up, to end the hold time of a lock */
+  t0 = semStatsNow ();
+  for (i = 0; i < nops; i++)
+    op[i].sem_flg = IPC_NOWAIT;
+  if (((stat = semop (semgid, op, nops)) == -1) && (errno == EAGAIN))
+     { for (i = 0; i < nops; i++)
+         op[i].sem_flg = 0;
+       blocked = true;
+       stat = semtimedop (semgid, op, nops, tmo);
+     }
+  if (stat == 0)
+     for (i = 0; i < nops; i++)
+       if (op[i].sem_op < 0)
+          semStatsDown (st, op[i].sem_num, blocked, t0);
+  return stat;
+}
+
 /**
  *  \brief Creation of a set of semaphores.
  *
@@ -38,13 +102,24 @@
 
 int semCreate (int key, unsigned int snum)
 {
-  return semget ((key_t) key, snum+1, MASK | IPC_CREAT | IPC_EXCL);
+  int semgid;                                                                            /* semaphore set identifier */
+  struct sembuf gate = { 0, 1, 0 };                                           /* closing the start of operations gate */
+
+  if ((semgid = semget ((key_t) key, snum+1, MASK | IPC_CREAT | IPC_EXCL)) == -1)
+     return -1;
+  if (semop (semgid, &gate, 1) == -1)
+     { semctl (semgid, 0, IPC_RMID, NULL);
+       return -1;
+     }
+  return semgid;
 }
 
 /**
  *  \brief Connection to a previously created set of semaphores.
  *
  *  The function fails if there is no semaphore set with a creation key equal to <tt>key</tt>.
+ *  The caller is blocked until the start of operations is signalled (see semSignal). The start of operations
+ *  semaphore is only waited for to be zero, which leaves it untouched, so that all the callers go through at once.
  *
  *  \param key creation key
  *
@@ -55,11 +130,11 @@ int semCreate (int key, unsigned int snum)
 int semConnect (int key)
 {
   int semgid;                                                                            /* semaphore set identifier */
-  struct sembuf init[2] = {{ 0, -1, 0 }, {0, 1, 0}};                                     /* initialization operation */
+  struct sembuf init = { 0, 0, 0 };                                                      /* initialization operation */
 
   if ((semgid = semget ((key_t) key, 1, MASK)) == -1)
      return -1;
-     else if (semop (semgid, init, 2) == -1)
+     else if (semop (semgid, &init, 1) == -1)
              return -1;
              else return semgid;
 }
@@ -84,6 +159,7 @@ int semDestroy (int semgid)
  *  \brief Signalling start of operations upon initialization of shared data structures.
  *
  *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *  Every process blocked in semConnect is woken up by a single operation.
  *
  *  \param semgid set identifier
  *
@@ -93,9 +169,9 @@ int semDestroy (int semgid)
 
 int semSignal (int semgid)
 {
-  struct sembuf up = { 0, 1, 0 };                                                         /* all around up operation */
+  struct sembuf gate = { 0, -1, 0 };                                          /* opening the start of operations gate */
 
-  return semop (semgid, &up, 1);
+  return semop (semgid, &gate, 1);
 }
 
 /**
@@ -116,7 +192,7 @@ int semDown (int semgid, unsigned int sindex)
 
   assert(sindex>0);
   down.sem_num = (unsigned short) sindex;
-  return semop (semgid, &down, 1);
+  return semOps (semgid, &down, 1, NULL);
 }
 
 /**
@@ -137,5 +213,169 @@ int semUp (int semgid, unsigned int sindex)
 
   assert(sindex>0);
   up.sem_num = (unsigned short) sindex;
-  return semop (semgid, &up, 1);
+  return semOps (semgid, &up, 1, NULL);
+}
+
+/**
+ *  \brief Counted <em>down</em> of a semaphore within the set.
+ *
+ *  The value of the semaphore is decremented by <tt>n</tt> in a single operation, blocking until that is possible.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (1 .. 32767)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semDownN (int semgid, unsigned int sindex, unsigned int n)
+{
+  struct sembuf down = { 0, 0, 0 };                                                       /* specific down operation */
+
+  assert(sindex>0);
+  if ((n == 0) || (n > 32767))
+     { errno = EINVAL;
+       return -1;
+     }
+  down.sem_num = (unsigned short) sindex;
+  down.sem_op = (short) -n;
+  return semOps (semgid, &down, 1, NULL);
+}
+
+/**
+ *  \brief Counted <em>up</em> of a semaphore within the set.
+ *
+ *  The value of the semaphore is incremented by <tt>n</tt> in a single operation.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (1 .. 32767)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semUpN (int semgid, unsigned int sindex, unsigned int n)
+{
+  struct sembuf up = { 0, 0, 0 };                                                           /* specific up operation */
+
+  assert(sindex>0);
+  if ((n == 0) || (n > 32767))
+     { errno = EINVAL;
+       return -1;
+     }
+  up.sem_num = (unsigned short) sindex;
+  up.sem_op = (short) n;
+  return semOps (semgid, &up, 1, NULL);
+}
+
+/**
+ *  \brief Counted <em>down</em> of a semaphore within the set, with a time limit.
+ *
+ *  As semDownN, but the caller gives up if the value of the semaphore could not be decremented within <tt>ms</tt>
+ *  milliseconds (with no limit, for \c 0).
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (1 .. 32767)
+ *  \param ms time limit, in milliseconds
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>; ETIMEDOUT, if the time
+ *          limit expired)
+ */
+
+int semDownTimed (int semgid, unsigned int sindex, unsigned int n, unsigned int ms)
+{
+  struct sembuf down = { 0, 0, 0 };                                                       /* specific down operation */
+  struct timespec tmo = { (time_t) (ms / 1000), (long) (ms % 1000) * 1000000L };                    /* relative limit */
+  int stat;
+
+  assert(sindex>0);
+  if ((n == 0) || (n > 32767))
+     { errno = EINVAL;
+       return -1;
+     }
+  down.sem_num = (unsigned short) sindex;
+  down.sem_op = (short) -n;
+  if (((stat = semOps (semgid, &down, 1, (ms > 0) ? &tmo : NULL)) == -1) && (errno == EAGAIN))
+     errno = ETIMEDOUT;
+  return stat;
+}
+
+/**
+ *  \brief Operation on several semaphores within the set.
+ *
+ *  The operations are carried out by a single semop, which performs all of them atomically, blocking until that is
+ *  possible.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param ops operations to be performed
+ *  \param nops number of operations (1 .. SEMOPS_MAX)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semMultiOp (int semgid, SEM_OP ops[], unsigned int nops)
+{
+  struct sembuf op[SEMOPS_MAX];                                                                /* specific operations */
+  unsigned int i;
+
+  if (!opsValid (ops, nops))
+     { errno = EINVAL;
+       return -1;
+     }
+  for (i = 0; i < nops; i++)
+  { op[i].sem_num = (unsigned short) ops[i].sindex;
+    op[i].sem_op = (short) ops[i].delta;
+    op[i].sem_flg = 0;
+  }
+  return semOps (semgid, op, nops, NULL);
+}
+
+/**
+ *  \brief Reading the value of a semaphore within the set.
+ *
+ *  Meant for diagnostics: both values may have changed by the time the function returns.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param pWaiters pointer to the number of callers blocked on the semaphore
+ *
+ *  \return value of the semaphore, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semValue (int semgid, unsigned int sindex, unsigned int *pWaiters)
+{
+  int val, nWait;
+
+  if (((val = semctl (semgid, sindex, GETVAL)) == -1) || ((nWait = semctl (semgid, sindex, GETNCNT)) == -1))
+     return -1;
+  *pWaiters = (unsigned int) nWait;
+  return val;
+}
+
+/**
+ *  \brief Installation of user level blocking functions.
+ *
+ *  Not supported: a process blocked on a System V semaphore can only be woken up by the kernel.
+ *
+ *  \param wait blocking function
+ *  \param wake wake up function
+ *
+ *  \return -\c 1, always (<tt>errno</tt> is set to ENOSYS)
+ */
+
+int semWaitHooks (SEM_WAIT_HOOK wait, SEM_WAKE_HOOK wake)
+{
+  errno = ENOSYS;
+  return -1;
 }
@@ -9,7 +9,15 @@
  *     \li destruction of a previously created set of semaphores
  *     \li signalling start of operations
  *     \li <em>down</em> of a semaphore within the set
- *     \li <em>up</em> of a semaphore within the set.
+ *     \li <em>up</em> of a semaphore within the set
+ *     \li counted <em>down</em> and <em>up</em> of a semaphore within the set
+ *     \li <em>down</em> of a semaphore within the set, with a time limit
+ *     \li atomic operation on several semaphores within the set
+ *     \li reading the value of a semaphore within the set
+ *     \li installation of user level blocking functions.
+ *
+ *  There are two implementations, selected at build time: semaphore.c, with System V semaphores, and
+ *  semaphoreFutex.c (<tt>make SYNC=futex</tt>), with futexes kept in shared memory.
  *
  *  \author António Rui Borges - October 1995
  */
@@ -17,6 +25,27 @@
 #ifndef SEMAPHORE_H_
 #define SEMAPHORE_H_
 
+/** \brief maximum number of operations in a single <tt>semMultiOp</tt> call */
+#define  SEMOPS_MAX     32
+
+/**
+ *  \brief Definition of <em>operation on a semaphore</em> data type.
+ */
+typedef struct
+        { /** \brief semaphore location in the set (1 .. snum) */
+          unsigned int sindex;
+          /** \brief value to be added to the semaphore (-32767 .. -1 for a <em>down</em>, 1 .. 32767 for an
+                     <em>up</em>) */
+          int delta;
+        } SEM_OP;
+
+/** \brief function that blocks the caller while the 32-bit word at <tt>addr</tt> holds <tt>val</tt> (it may return
+           early: the caller looks at the word again) */
+typedef void (*SEM_WAIT_HOOK) (void *addr, unsigned int val);
+
+/** \brief function that wakes up to <tt>n</tt> callers blocked on the word at <tt>addr</tt> */
+typedef void (*SEM_WAKE_HOOK) (void *addr, int n);
+
 /**
  *  \brief Creation of a set of semaphores.
  *
@@ -36,6 +65,8 @@ extern int semCreate (int key, unsigned int snum);
  *  \brief Connection to a previously created set of semaphores.
  *
  *  The function fails if there is no semaphore set with a creation key equal to <tt>key</tt>.
+ *  The caller is blocked until the start of operations is signalled (see semSignal); the wait does not write to
+ *  the set, so that all the callers go through at once.
  *
  *  \param key creation key
  *
@@ -62,6 +93,7 @@ extern int semDestroy (int semgid);
  *  \brief Signalling start of operations upon initialization of shared data structures.
  *
  *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *  Every process blocked in semConnect is woken up at once.
  *
  *  \param semgid set identifier
  *
@@ -99,4 +131,106 @@ extern int semDown (int semgid, unsigned int sindex);
 
 extern int semUp (int semgid, unsigned int sindex);
 
+/**
+ *  \brief Counted <em>down</em> of a semaphore within the set.
+ *
+ *  The value of the semaphore is decremented by <tt>n</tt> in a single operation, blocking until that is possible.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (1 .. 32767)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semDownN (int semgid, unsigned int sindex, unsigned int n);
+
+/**
+ *  \brief Counted <em>up</em> of a semaphore within the set.
+ *
+ *  The value of the semaphore is incremented by <tt>n</tt> in a single operation.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (1 .. 32767)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semUpN (int semgid, unsigned int sindex, unsigned int n);
+
+/**
+ *  \brief Counted <em>down</em> of a semaphore within the set, with a time limit.
+ *
+ *  As semDownN, but the caller gives up if the value of the semaphore could not be decremented within <tt>ms</tt>
+ *  milliseconds (with no limit, for \c 0). The limit is not kept while user level blocking functions are installed.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (1 .. 32767)
+ *  \param ms time limit, in milliseconds
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>; ETIMEDOUT, if the time
+ *          limit expired)
+ */
+
+extern int semDownTimed (int semgid, unsigned int sindex, unsigned int n, unsigned int ms);
+
+/**
+ *  \brief Operation on several semaphores within the set.
+ *
+ *  The operations are carried out as a whole, in both implementations: the call blocks until every <em>down</em>
+ *  can be performed, and then performs all of them and the <em>ups</em>; it never returns with only some of them
+ *  done. A semaphore may take several <em>downs</em> or several <em>ups</em>, but not both, in a single call.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param ops operations to be performed
+ *  \param nops number of operations (1 .. SEMOPS_MAX)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>; EINVAL, for an operation
+ *          out of range, with none performed)
+ */
+
+extern int semMultiOp (int semgid, SEM_OP ops[], unsigned int nops);
+
+/**
+ *  \brief Reading the value of a semaphore within the set.
+ *
+ *  Meant for diagnostics: both values may have changed by the time the function returns.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param pWaiters pointer to the number of callers blocked on the semaphore
+ *
+ *  \return value of the semaphore, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semValue (int semgid, unsigned int sindex, unsigned int *pWaiters);
+
+/**
+ *  \brief Installation of user level blocking functions.
+ *
+ *  From then on, the operations that have to block the caller, or to wake blocked callers up, do it through
+ *  <tt>wait</tt> and <tt>wake</tt> instead of the kernel, so that a user level scheduler may run something else
+ *  meanwhile. Only the futex implementation supports it.
+ *
+ *  \param wait blocking function
+ *  \param wake wake up function
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semWaitHooks (SEM_WAIT_HOOK wait, SEM_WAKE_HOOK wake);
+
 #endif /* SEMAPHORE_H_ */
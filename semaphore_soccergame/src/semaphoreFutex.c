@@ -0,0 +1,665 @@
+/**
+ *  \file semaphoreFutex.c (implementation file)
+ *
+ *  \brief Semaphore management.
+ *
+ *  Operations defined on semaphores:
+ *     \li creation of a set of semaphores
+ *     \li connection to a previously created set of semaphores
+ *     \li destruction of a previously created set of semaphores
+ *     \li signalling start of operations
+ *     \li <em>down</em> of a semaphore within the set
+ *     \li <em>up</em> of a semaphore within the set
+ *     \li counted <em>down</em> and <em>up</em> of a semaphore within the set
+ *     \li <em>down</em> of a semaphore within the set, with a time limit
+ *     \li atomic operation on several semaphores within the set
+ *     \li reading the value of a semaphore within the set
+ *     \li installation of user level blocking functions.
+ *
+ *  Implementation with futexes: the semaphore values live in a POSIX shared memory object named after the
+ *  creation key (or, for key IPC_PRIVATE, in memory private to the process, to be shared by its threads) and
+ *  are operated upon with atomic instructions. The kernel is only entered to block the
+ *  process, when the value of the semaphore is not large enough, or to wake blocked processes up.
+ *
+ *  Selected at build time with <tt>make SYNC=futex</tt>; the interface is the one of semaphore.h.
+ *  The operations are counted in the block selected with semStatsUse, if any.
+ *
+ *  \author António Rui Borges - October 1995
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/ipc.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <assert.h>
+
+#include "semaphore.h"
+#include "semStats.h"
+
+/** \brief access permission: user r-w */
+#define  MASK           0600
+
+/** \brief maximum number of semaphore sets a process may be connected to */
+#define  MAXSETS        8
+
+/** \brief name of the shared memory object of the set with creation key <tt>key</tt> */
+#define  SEMNAME_FMT    "/soccergame.sem.%x"
+
+/**
+ *  \brief Definition of <em>futex semaphore</em> data type.
+ */
+typedef struct {
+    /** \brief semaphore value */
+    _Atomic uint32_t val;
+    /** \brief number of processes blocked on the semaphore */
+    _Atomic uint32_t nWait;
+    /** \brief number of processes blocked on the semaphore waiting for more than one unit */
+    _Atomic uint32_t nWaitN;
+} FSEM;
+
+/**
+ *  \brief Definition of <em>set of futex semaphores</em> data type, as it is laid out in shared memory.
+ */
+typedef struct {
+    /** \brief number of semaphores in the set, including the start of operations semaphore */
+    uint32_t snum;
+    /** \brief semaphores (index 0 is the start of operations semaphore) */
+    FSEM sem[];
+} FSEMSET;
+
+/** \brief semaphore sets this process is connected to (the set identifier is the index) */
+static struct {
+    FSEMSET *set;
+    size_t size;
+    int key;
+    int futexFlags;
+} sets[MAXSETS];
+
+/** \brief user level blocking function (NULL, if blocking is done by the kernel) */
+static SEM_WAIT_HOOK waitHook = NULL;
+
+/** \brief user level wake up function */
+static SEM_WAKE_HOOK wakeHook = NULL;
+
+/** \brief futex operation flags of set <tt>semgid</tt> */
+#define  FLAGS(semgid)  (sets[semgid].futexFlags)
+
+/* internal functions */
+
+static long futex (_Atomic uint32_t *addr, int op, uint32_t val, const struct timespec *tmo)
+{
+    return syscall (SYS_futex, (uint32_t *) addr, op, val, tmo, NULL, 0);
+}
+
+/* time left until the monotonic clock reaches end; false if none */
+static bool timeLeft (const struct timespec *end, struct timespec *left)
+{
+    struct timespec now;
+
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    left->tv_sec = end->tv_sec - now.tv_sec;
+    left->tv_nsec = end->tv_nsec - now.tv_nsec;
+    if (left->tv_nsec < 0) {
+        left->tv_sec--;
+        left->tv_nsec += 1000000000L;
+    }
+    return (left->tv_sec > 0) || ((left->tv_sec == 0) && (left->tv_nsec > 0));
+}
+
+static int setMap (int key, int fd, size_t size)
+{
+    int flags = MAP_SHARED;
+    int semgid;
+    void *add;
+
+    for (semgid = 0; semgid < MAXSETS; semgid++) {
+        if (sets[semgid].set == NULL) {
+            break;
+        }
+    }
+    if (semgid == MAXSETS) {
+        if (fd != -1) {
+            close (fd);
+        }
+        errno = EMFILE;
+        return -1;
+    }
+    if (fd == -1) {
+        flags = MAP_PRIVATE | MAP_ANONYMOUS;                                              /* IPC_PRIVATE: zero filled */
+    }
+    add = mmap (NULL, size, PROT_READ | PROT_WRITE, flags, fd, 0);
+    if (fd != -1) {
+        close (fd);
+    }
+    if (add == MAP_FAILED) {
+        return -1;
+    }
+    sets[semgid].set = (FSEMSET *) add;
+    sets[semgid].size = size;
+    sets[semgid].key = key;
+    sets[semgid].futexFlags = (fd == -1) ? FUTEX_PRIVATE_FLAG : 0;
+    return semgid;
+}
+
+static FSEM *semGet (int semgid, unsigned int sindex)
+{
+    if ((semgid < 0) || (semgid >= MAXSETS) || (sets[semgid].set == NULL) || (sindex >= sets[semgid].set->snum)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return &sets[semgid].set->sem[sindex];
+}
+
+/* returns 1 if the caller had to block, 0 if not, and -1 if the time limit (ms, none for 0) expired first */
+static int fsemDown (FSEM *s, uint32_t n, int flags, unsigned int ms)
+{
+    uint32_t v = atomic_load (&s->val);
+    int blocked = 0;
+    struct timespec end, left;
+
+    if (ms > 0) {
+        clock_gettime (CLOCK_MONOTONIC, &end);
+        end.tv_sec += (time_t) (ms / 1000);
+        if ((end.tv_nsec += (long) (ms % 1000) * 1000000L) >= 1000000000L) {
+            end.tv_sec++;
+            end.tv_nsec -= 1000000000L;
+        }
+    }
+    while (true) {
+        if (v >= n) {
+            if (atomic_compare_exchange_weak (&s->val, &v, v - n)) {
+                return blocked;
+            }
+            continue;
+        }
+        if ((ms > 0) && (waitHook == NULL) && !timeLeft (&end, &left)) {
+            return -1;
+        }
+        blocked = 1;
+        atomic_fetch_add (&s->nWait, 1);
+        if (n > 1) {
+            atomic_fetch_add (&s->nWaitN, 1);
+        }
+        v = atomic_load (&s->val);
+        if ((v < n) && (waitHook != NULL)) {
+            waitHook (&s->val, v);
+        }
+        else if (v < n) {
+            /* EAGAIN, EINTR or ETIMEDOUT: just look at it again */
+            futex (&s->val, FUTEX_WAIT | flags, v, (ms > 0) ? &left : NULL);
+        }
+        if (n > 1) {
+            atomic_fetch_sub (&s->nWaitN, 1);
+        }
+        atomic_fetch_sub (&s->nWait, 1);
+        v = atomic_load (&s->val);
+    }
+}
+
+static void fsemUp (FSEM *s, uint32_t n, int flags)
+{
+    atomic_fetch_add (&s->val, n);
+    if (atomic_load (&s->nWait) > 0) {
+        /* unit waiters are woken one per unit; if some need more than one, all are woken to compete */
+        int nWake = (atomic_load (&s->nWaitN) > 0) ? INT_MAX : (int) n;
+
+        if (wakeHook != NULL) {
+            wakeHook (&s->val, nWake);
+        }
+        else futex (&s->val, FUTEX_WAKE | flags, nWake, NULL);
+    }
+}
+
+/* takes n units of the semaphore, if it has them; false, if not */
+static bool fsemTake (FSEM *s, uint32_t n)
+{
+    uint32_t v = atomic_load (&s->val);
+
+    while (v >= n) {
+        if (atomic_compare_exchange_weak (&s->val, &v, v - n)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* blocks the caller while the semaphore is short of n units, leaving them there (it may return early); it waits as
+   one that needs more than one unit, so that every up wakes it */
+static void fsemAwait (FSEM *s, uint32_t n, int flags)
+{
+    uint32_t v;
+
+    atomic_fetch_add (&s->nWait, 1);
+    atomic_fetch_add (&s->nWaitN, 1);
+    if (((v = atomic_load (&s->val)) < n) && (waitHook != NULL)) {
+        waitHook (&s->val, v);
+    }
+    else if (v < n) {
+        futex (&s->val, FUTEX_WAIT | flags, v, NULL);
+    }
+    atomic_fetch_sub (&s->nWaitN, 1);
+    atomic_fetch_sub (&s->nWait, 1);
+}
+
+/* external functions */
+
+/**
+ *  \brief Creation of a set of semaphores.
+ *
+ *  All semaphores in the set will be in set to <em>red state</em> upon creation.
+ *  The function fails if there is already a semaphore set with a creation key equal to <tt>key</tt>.
+ *
+ *  \param key creation key
+ *  \param snum number of semaphores in the set (>= 1)
+ *
+ *  \return set identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semCreate (int key, unsigned int snum)
+{
+  char name[32];                                                               /* name of the shared memory object */
+  size_t size;                                                                                   /* size of the set */
+  int fd, semgid;
+
+  size = sizeof (FSEMSET) + (snum + 1) * sizeof (FSEM);
+  if (key == IPC_PRIVATE)
+     { if ((semgid = setMap (key, -1, size)) == -1)
+          return -1;
+       sets[semgid].set->snum = snum + 1;
+       atomic_store (&sets[semgid].set->sem[0].val, 1);                            /* start of operations gate closed */
+       return semgid;
+     }
+  sprintf (name, SEMNAME_FMT, (unsigned int) key);
+  if ((fd = shm_open (name, O_RDWR | O_CREAT | O_EXCL, MASK)) == -1)
+     return -1;
+  if (ftruncate (fd, size) == -1)                                                   /* all values are set to zero */
+     { close (fd);
+       shm_unlink (name);
+       return -1;
+     }
+  if ((semgid = setMap (key, fd, size)) == -1)
+     { shm_unlink (name);
+       return -1;
+     }
+  sets[semgid].set->snum = snum + 1;
+  atomic_store (&sets[semgid].set->sem[0].val, 1);                                 /* start of operations gate closed */
+  return semgid;
+}
+
+/**
+ *  \brief Connection to a previously created set of semaphores.
+ *
+ *  The function fails if there is no semaphore set with a creation key equal to <tt>key</tt>.
+ *  The caller is blocked until the start of operations is signalled (see semSignal). The start of operations
+ *  semaphore is only read, the caller sleeping on it while it is not zero, so that all the callers go through at
+ *  once and none of them writes to its cache line.
+ *
+ *  \param key creation key
+ *
+ *  \return set identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semConnect (int key)
+{
+  char name[32];                                                               /* name of the shared memory object */
+  struct stat st;                                                                /* status of the shared memory object */
+  int fd, semgid;
+  uint32_t v;
+
+  sprintf (name, SEMNAME_FMT, (unsigned int) key);
+  if ((fd = shm_open (name, O_RDWR, MASK)) == -1)
+     return -1;
+  if (fstat (fd, &st) == -1)
+     { close (fd);
+       return -1;
+     }
+  if ((semgid = setMap (key, fd, (size_t) st.st_size)) == -1)
+     return -1;
+  while ((v = atomic_load (&sets[semgid].set->sem[0].val)) != 0)                          /* initialization operation */
+    futex (&sets[semgid].set->sem[0].val, FUTEX_WAIT | FLAGS(semgid), v, NULL);
+  return semgid;
+}
+
+/**
+ *  \brief Destruction of a previously created set of semaphores.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semDestroy (int semgid)
+{
+  char name[32];                                                               /* name of the shared memory object */
+
+  if (semGet (semgid, 0) == NULL)
+     return -1;
+  sprintf (name, SEMNAME_FMT, (unsigned int) sets[semgid].key);
+  munmap (sets[semgid].set, sets[semgid].size);
+  sets[semgid].set = NULL;
+  if (sets[semgid].key == IPC_PRIVATE)
+     return 0;
+  return shm_unlink (name);
+}
+
+/**
+ *  \brief Signalling start of operations upon initialization of shared data structures.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *  Every process blocked in semConnect is woken up by a single call.
+ *
+ *  \param semgid set identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semSignal (int semgid)
+{
+  FSEM *s;
+
+  if ((s = semGet (semgid, 0)) == NULL)
+     return -1;
+  atomic_store (&s->val, 0);                                                            /* opening the gate, for good */
+  futex (&s->val, FUTEX_WAKE | FLAGS(semgid), INT_MAX, NULL);
+  return 0;
+}
+
+/**
+ *  \brief <em>Down</em> of a semaphore within the set.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semDown (int semgid, unsigned int sindex)
+{
+  FSEM *s;
+  SEM_STATS *st;                                                                            /* counters block, if any */
+  uint64_t t0;
+  bool blocked;
+
+  assert(sindex>0);
+  if ((s = semGet (semgid, sindex)) == NULL)
+     return -1;
+  t0 = ((st = semStatsFor (semgid)) != NULL) ? semStatsNow () : 0;
+  blocked = fsemDown (s, 1, FLAGS(semgid), 0);
+  if (st != NULL)
+     semStatsDown (st, sindex, blocked, t0);
+  return 0;
+}
+
+/**
+ *  \brief <em>Up</em> of a semaphore within the set.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semUp (int semgid, unsigned int sindex)
+{
+  FSEM *s;
+  SEM_STATS *st;                                                                            /* counters block, if any */
+
+  assert(sindex>0);
+  if ((s = semGet (semgid, sindex)) == NULL)
+     return -1;
+  if ((st = semStatsFor (semgid)) != NULL)
+     semStatsUp (st, sindex);
+  fsemUp (s, 1, FLAGS(semgid));
+  return 0;
+}
+
+/**
+ *  \brief Counted <em>down</em> of a semaphore within the set.
+ *
+ *  The value of the semaphore is decremented by <tt>n</tt> in a single operation, blocking until that is possible.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (1 .. 32767)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semDownN (int semgid, unsigned int sindex, unsigned int n)
+{
+  FSEM *s;
+  SEM_STATS *st;                                                                            /* counters block, if any */
+  uint64_t t0;
+  bool blocked;
+
+  assert(sindex>0);
+  if ((n == 0) || (n > 32767))
+     { errno = EINVAL;
+       return -1;
+     }
+  if ((s = semGet (semgid, sindex)) == NULL)
+     return -1;
+  t0 = ((st = semStatsFor (semgid)) != NULL) ? semStatsNow () : 0;
+  blocked = fsemDown (s, n, FLAGS(semgid), 0);
+  if (st != NULL)
+     semStatsDown (st, sindex, blocked, t0);
+  return 0;
+}
+
+/**
+ *  \brief Counted <em>up</em> of a semaphore within the set.
+ *
+ *  The value of the semaphore is incremented by <tt>n</tt> in a single operation.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (1 .. 32767)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semUpN (int semgid, unsigned int sindex, unsigned int n)
+{
+  FSEM *s;
+  SEM_STATS *st;                                                                            /* counters block, if any */
+
+  assert(sindex>0);
+  if ((n == 0) || (n > 32767))
+     { errno = EINVAL;
+       return -1;
+     }
+  if ((s = semGet (semgid, sindex)) == NULL)
+     return -1;
+  if ((st = semStatsFor (semgid)) != NULL)
+     semStatsUp (st, sindex);
+  fsemUp (s, n, FLAGS(semgid));
+  return 0;
+}
+
+/**
+ *  \brief Counted <em>down</em> of a semaphore within the set, with a time limit.
+ *
+ *  As semDownN, but the caller gives up if the value of the semaphore could not be decremented within <tt>ms</tt>
+ *  milliseconds (with no limit, for \c 0). The limit is not kept while user level blocking functions are installed:
+ *  the caller is then blocked until it gets the units.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (1 .. 32767)
+ *  \param ms time limit, in milliseconds
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>; ETIMEDOUT, if the time
+ *          limit expired)
+ */
+
+int semDownTimed (int semgid, unsigned int sindex, unsigned int n, unsigned int ms)
+{
+  FSEM *s;
+  SEM_STATS *st;                                                                            /* counters block, if any */
+  uint64_t t0;
+  int blocked;
+
+  assert(sindex>0);
+  if ((n == 0) || (n > 32767))
+     { errno = EINVAL;
+       return -1;
+     }
+  if ((s = semGet (semgid, sindex)) == NULL)
+     return -1;
+  t0 = ((st = semStatsFor (semgid)) != NULL) ? semStatsNow () : 0;
+  if ((blocked = fsemDown (s, n, FLAGS(semgid), ms)) == -1)
+     { errno = ETIMEDOUT;
+       return -1;
+     }
+  if (st != NULL)
+     semStatsDown (st, sindex, blocked, t0);
+  return 0;
+}
+
+/**
+ *  \brief Operation on several semaphores within the set.
+ *
+ *  The <em>downs</em> are taken in array order, each one only if its semaphore has the units. When one of them is
+ *  short, those already taken are given back, as <em>ups</em>, and the caller waits for that semaphore to have
+ *  enough units before trying them all again; so the call never returns with only some of them done. The
+ *  <em>ups</em> are performed once every <em>down</em> has been taken. Other callers may see, and wake up on, the
+ *  units taken and given back by an attempt that failed.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param ops operations to be performed
+ *  \param nops number of operations (1 .. SEMOPS_MAX)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semMultiOp (int semgid, SEM_OP ops[], unsigned int nops)
+{
+  SEM_STATS *st;                                                                            /* counters block, if any */
+  uint64_t t0;
+  bool blocked = false;
+  uint32_t need;                                                    /* units wanted from the semaphore that was short */
+  unsigned int i, k;
+
+  if ((nops == 0) || (nops > SEMOPS_MAX))
+     { errno = EINVAL;
+       return -1;
+     }
+  for (i = 0; i < nops; i++)
+  { assert(ops[i].sindex>0);
+    if ((ops[i].delta == 0) || (ops[i].delta < -32767) || (ops[i].delta > 32767) ||
+        (semGet (semgid, ops[i].sindex) == NULL))
+       { errno = EINVAL;
+         return -1;
+       }
+    for (k = 0; k < i; k++)
+      if ((ops[k].sindex == ops[i].sindex) && ((ops[k].delta > 0) != (ops[i].delta > 0)))
+         { errno = EINVAL;                                                                  /* a down and an up on it */
+           return -1;
+         }
+  }
+  t0 = ((st = semStatsFor (semgid)) != NULL) ? semStatsNow () : 0;
+  i = 0;
+  while (i < nops)
+    if ((ops[i].delta > 0) || fsemTake (semGet (semgid, ops[i].sindex), (uint32_t) -ops[i].delta))
+       i += 1;
+       else { need = 0;
+              for (k = 0; k <= i; k++)
+                if ((ops[k].sindex == ops[i].sindex) && (ops[k].delta < 0))
+                   need += (uint32_t) -ops[k].delta;
+              for (k = 0; k < i; k++)                                                  /* the downs taken, given back */
+                if (ops[k].delta < 0)
+                   fsemUp (semGet (semgid, ops[k].sindex), (uint32_t) -ops[k].delta, FLAGS(semgid));
+              blocked = true;
+              fsemAwait (semGet (semgid, ops[i].sindex), need, FLAGS(semgid));
+              i = 0;
+            }
+  for (i = 0; i < nops; i++)
+    if (ops[i].delta < 0)
+       { if (st != NULL)
+            semStatsDown (st, ops[i].sindex, blocked, t0);
+       }
+       else { if (st != NULL)
+                 semStatsUp (st, ops[i].sindex);
+              fsemUp (semGet (semgid, ops[i].sindex), (uint32_t) ops[i].delta, FLAGS(semgid));
+            }
+  return 0;
+}
+
+/**
+ *  \brief Reading the value of a semaphore within the set.
+ *
+ *  Meant for diagnostics: both values may have changed by the time the function returns.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param pWaiters pointer to the number of callers blocked on the semaphore
+ *
+ *  \return value of the semaphore, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semValue (int semgid, unsigned int sindex, unsigned int *pWaiters)
+{
+  FSEM *s;
+
+  if ((s = semGet (semgid, sindex)) == NULL)
+     return -1;
+  *pWaiters = atomic_load (&s->nWait);
+  return (int) atomic_load (&s->val);
+}
+
+/**
+ *  \brief Installation of user level blocking functions.
+ *
+ *  They take the place of the futex system calls. It must be done before any process or thread blocks on a
+ *  semaphore, and only callers that share this process address space are woken up from then on.
+ *
+ *  \param wait blocking function
+ *  \param wake wake up function
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semWaitHooks (SEM_WAIT_HOOK wait, SEM_WAKE_HOOK wake)
+{
+  if ((wait == NULL) != (wake == NULL))
+     { errno = EINVAL;
+       return -1;
+     }
+  waitHook = wait;
+  wakeHook = wake;
+  return 0;
+}
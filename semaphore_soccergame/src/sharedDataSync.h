@@ -10,6 +10,7 @@
  *
  *  Both the format of the shared data, which represents the full state of the problem, and the identification of
  *  the different semaphores, which carry out the synchronization among the intervening entities, are provided.
+ *  The groups of fields are laid out in cache lines of their own (see the layout checks below).
  *
  *  \author Nuno Lau - December 2024
  */
@@ -19,44 +20,207 @@
 
 #include "probConst.h"
 #include "probDataStruct.h"
+#include "logging.h"
+#include "semStats.h"
 
 /**
- *  \brief Definition of <em>shared information</em> data type.
+ *  \brief Definition of <em>entity pool</em> data type.
+ *
+ *  In a server run (option -S of the main process), the entity processes are kept alive from one round of matches
+ *  to the next; the counters add up over the rounds (see entityPool.h).
  */
 typedef struct
-        { /** \brief full state of the problem */
-          FULL_STAT fSt;
+        { /** \brief number of rounds of the run (0, if the entities carry out a single life cycle and exit) */
+          int nRounds;
+          /** \brief number of times an entity got ready to start a round */
+          _Atomic int ready;
+          /** \brief number of times an entity finished a round */
+          _Atomic int done;
+        } POOL_SYNC;
 
-          /* semaphores ids */
+/**
+ *  \brief Definition of <em>run metrics</em> data type.
+ *
+ *  Counters of the events of a run, kept by the entities along all its rounds, to be read while it goes on by the
+ *  metrics exporter (soccerMetrics).
+ */
+typedef struct
+        { /** \brief number of matches started by a referee */
+          _Atomic uint64_t matchesStarted;
+          /** \brief number of matches ended by a referee (incremented with release order, so that a reader that
+                     loads it with acquire order, then matchesStarted, never finds more matches ended than started) */
+          _Atomic uint64_t matchesEnded;
+          /** \brief number of teams formed */
+          _Atomic uint64_t teamsFormed;
+          /** \brief number of players that were late */
+          _Atomic uint64_t playersLate;
+          /** \brief number of goalies that were late */
+          _Atomic uint64_t goaliesLate;
+        } RUN_METRICS;
+
+/** \brief the order of entry in the critical region is neither recorded nor replayed */
+#define SCHED_OFF                0
+/** \brief the order of entry in the critical region is recorded */
+#define SCHED_RECORD             1
+/** \brief the order of entry in the critical region is replayed */
+#define SCHED_REPLAY             2
+
+/**
+ *  \brief Definition of <em>schedule</em> data type.
+ *
+ *  The order in which the entities enter the critical region (options -X and -Y of the main process): the log
+ *  column of the entity of each entry, or turn, is kept past the team slots (see SCHED_TURNS and schedule.h).
+ */
+typedef struct
+        { /** \brief SCHED_OFF, SCHED_RECORD or SCHED_REPLAY */
+          int mode;
+          /** \brief number of turns taken (recording), or to be taken (replay) */
+          uint32_t nTurns;
+          /** \brief number of turns the region past the team slots holds */
+          uint32_t maxTurns;
+          /** \brief next turn to be taken (replay) */
+          _Atomic uint32_t next;
+        } SCHED_SYNC;
+
+/**
+ *  \brief Definition of <em>shared information</em> data type.
+ */
+typedef struct
+        { /* semaphores ids */
           /** \brief identification of critical region protection semaphore – val = 1 */
           unsigned int mutex;
-          /** \brief identification of semaphore used by players to wait for forming team teammate - val = 0 */
-          unsigned int playersWaitTeam;
-          /** \brief identification of semaphore used by goalies to wait for forming team teammate - val = 0 */
-          unsigned int goaliesWaitTeam;
-          /** \brief identification of semaphore used by players and goalies to wait for the match to start - val = 0 */
+          /** \brief identification of semaphore used by players and goalies to wait for match 0 to start - val = 0
+                     (see MATCH_SEM) */
           unsigned int playersWaitReferee;
-          /** \brief identification of semaphore used by players and goalies to wait for the match to end - val = 0 */
+          /** \brief identification of semaphore used by players and goalies to wait for match 0 to end - val = 0
+                     (see MATCH_SEM) */
           unsigned int playersWaitEnd;
-          /** \brief identification of semaphore used by referee to wait for teams to be formed – val = 0  */
+          /** \brief identification of semaphore used by referee to wait for the teams of match 0 to be formed – val = 0
+                     (see MATCH_SEM) */
           unsigned int refereeWaitTeams;
-          /** \brief identification of semaphore used by players and goalies to acknowledge team registration – val = 0  */
-          unsigned int playerRegistered;
           /** \brief identification of semaphore used by referee to wait for players and goalies to start – val = 0  */
           unsigned int playing;
+          /** \brief identification of semaphore used by players and goalies of team 1 to wait for the teammate that
+                     forms it - val = 0 (see TEAM_SEM) */
+          unsigned int teamWait;
+          /** \brief identification of semaphore used by players and goalies of team 1 to acknowledge its registration
+                     to the teammate that forms it - val = 0 (see TEAM_SEM) */
+          unsigned int teamRegistered;
+          /** \brief identification of semaphore used by the entities of a server run to wait for a round to be
+                     released - val = 0 */
+          unsigned int poolStart;
+          /** \brief identification of semaphore used by the entities of a server run to wait for every entity to
+                     be ready to start the round - val = 0 */
+          unsigned int poolGo;
+
+          /** \brief ring buffer of state change records, drained by the main process */
+          _Alignas(CACHE_LINE) LOG_RING logRing;
+
+          /** \brief semaphore counters (enabled with option -s of the main process) */
+          _Alignas(CACHE_LINE) SEM_STATS semStats;
+
+          /** \brief entity pool of a server run */
+          _Alignas(CACHE_LINE) POOL_SYNC pool;
+
+          /** \brief order of entry in the critical region */
+          _Alignas(CACHE_LINE) SCHED_SYNC sched;
+
+          /** \brief counters of the events of the run */
+          _Alignas(CACHE_LINE) RUN_METRICS metrics;
+
+          /** \brief full state of the problem (it must be the last field, as its size is set at launch time) */
+          _Alignas(CACHE_LINE) FULL_STAT fSt;
 
         } SHARED_DATA;
 
-/** \brief number of semaphores in the set */
-#define SEM_NU                   8 
+/**
+ *  \brief Definition of <em>team slot</em> data type.
+ *
+ *  There is one per team, in the region that follows the full state (see TEAM_SLOT); each one takes whole cache
+ *  lines, so that teams being formed at the same time do not share them.
+ */
+typedef struct
+        { /** \brief number of members that already joined the team (the one that makes it full forms it) */
+          _Atomic int joined;
+          /** \brief log column of the member in each seat: the players first, then the goalies */
+          int roster[];
+        } TEAM_SLOT;
+
+/** \brief size of a team slot with <tt>nMembers</tt> members (whole cache lines) */
+#define TEAM_SLOT_SIZE(nMembers) ((sizeof (TEAM_SLOT) + (nMembers) * sizeof (int) + CACHE_LINE - 1) / CACHE_LINE * \
+                                  CACHE_LINE)
+
+/** \brief location of the team slots in the shared region with <tt>nCol</tt> intervening entities */
+#define TEAMS_OFFSET(nCol)       (offsetof (SHARED_DATA, fSt) + FULL_STAT_SIZE(nCol))
+
+/** \brief size of the shared region with <tt>nCol</tt> intervening entities and <tt>nTeams</tt> teams of
+           <tt>nMembers</tt> members (whole cache lines) */
+#define SHARED_DATA_SIZE(nCol, nTeams, nMembers) \
+                                 (TEAMS_OFFSET(nCol) + (size_t) (nTeams) * TEAM_SLOT_SIZE(nMembers))
+
+/** \brief slot of team <tt>team</tt> (1, 2, ...) */
+#define TEAM_SLOT(p_sh, team)    ((TEAM_SLOT *) ((char *) (p_sh) + TEAMS_OFFSET(NUM_COLS(&(p_sh)->fSt)) + \
+                                  (size_t) ((team) - 1) * \
+                                  TEAM_SLOT_SIZE((p_sh)->fSt.nTeamPlayers + (p_sh)->fSt.nTeamGoalies)))
+
+/** \brief true if the entities change their own states out of the critical region: the changes go through the ring
+           buffer, whose drainer rebuilds the full state of every log line from them, and the order of entry in the
+           critical region is neither recorded nor replayed (it then orders every change) */
+#define OWN_STATE_FREE(p_sh)     ((p_sh)->logRing.enabled && ((p_sh)->sched.mode == SCHED_OFF))
+
+/** \brief maximum number of turns of a run: four entries per player and goalie, two per referee and five per
+           match (the referee of a match claims it, waits for the teams, starts, plays and ends it) */
+#define SCHED_MAX_TURNS(nPlayers, nGoalies, nReferees, nMatches) \
+                                 (4 * ((size_t) (nPlayers) + (nGoalies)) + 2 * (size_t) (nReferees) + \
+                                  5 * (size_t) (nMatches))
+
+/** \brief turns of the schedule, past the team slots */
+#define SCHED_TURNS(p_sh)        ((uint32_t *) ((char *) (p_sh) + \
+                                  SHARED_DATA_SIZE(NUM_COLS(&(p_sh)->fSt), 2 * (p_sh)->fSt.nMatches, \
+                                                   (p_sh)->fSt.nTeamPlayers + (p_sh)->fSt.nTeamGoalies)))
+
+/* layout checks: the semaphore identifications, read by every entity, must not share a cache line with the data
+   written along the run */
+_Static_assert (offsetof (SHARED_DATA, poolGo) + sizeof (unsigned int) <= CACHE_LINE,
+                "the semaphore identifications exceed a cache line");
+_Static_assert (offsetof (SHARED_DATA, logRing) % CACHE_LINE == 0, "the ring buffer does not start a cache line");
+_Static_assert (offsetof (SHARED_DATA, semStats) % CACHE_LINE == 0, "the semaphore counters do not start a cache line");
+_Static_assert (offsetof (SHARED_DATA, pool) % CACHE_LINE == 0, "the entity pool does not start a cache line");
+_Static_assert (offsetof (SHARED_DATA, sched) % CACHE_LINE == 0, "the schedule does not start a cache line");
+_Static_assert (offsetof (SHARED_DATA, metrics) % CACHE_LINE == 0, "the run metrics do not start a cache line");
+_Static_assert (offsetof (SHARED_DATA, fSt) % CACHE_LINE == 0, "the full state does not start a cache line");
+
+/** \brief number of semaphores of each match (the last four are the ones of its teams, two per team) */
+#define MATCH_SEM_NU             7
+
+/** \brief number of semaphores in the set for <tt>nMatches</tt> matches */
+#define SEM_NU(nMatches)         (4 + MATCH_SEM_NU * (nMatches))
 
 #define MUTEX                    1
-#define PLAYERSWAITTEAM          2
-#define GOALIESWAITTEAM          3
-#define PLAYERSWAITREFEREE       4
-#define PLAYERSWAITEND           5
-#define REFEREEWAITTEAMS         6
-#define PLAYERREGISTERED         7
-#define PLAYING                  8
+#define PLAYING                  2
+#define POOLSTART                3
+#define POOLGO                   4
+#define REFEREEWAITTEAMS         5
+#define PLAYERSWAITREFEREE       6
+#define PLAYERSWAITEND           7
+#define TEAMWAIT                 8
+#define TEAMREGISTERED           10
+
+/** \brief names of the semaphores, by identification (the ones of match 0 stand for those of every match) */
+#define SEM_NAMES                { "", "mutex", "playing", "poolStart", "poolGo", "refereeWaitTeams", \
+                                   "playersWaitReferee", "playersWaitEnd", "teamWait (1st)", "teamWait (2nd)", \
+                                   "teamRegistered (1st)", "teamRegistered (2nd)" }
+
+/** \brief number of semaphore counter slots: one per identification, the per match ones folded onto match 0 */
+#define SEM_STATS_NU             (TEAMREGISTERED + 2)
+
+/** \brief identification of the semaphore of match <tt>m</tt>, given the one of match 0 */
+#define MATCH_SEM(id, m)         ((id) + MATCH_SEM_NU * (unsigned int) (m))
+
+/** \brief match played by team <tt>team</tt> (teams 1 and 2 play match 0, teams 3 and 4 match 1, ...) */
+#define TEAM_MATCH(team)         (((team) - 1) / 2)
+
+/** \brief identification of the semaphore of team <tt>team</tt>, given the one of team 1 */
+#define TEAM_SEM(id, team)       (MATCH_SEM(id, TEAM_MATCH(team)) + (unsigned int) ((team) - 1) % 2)
 
 #endif /* SHAREDDATASYNC_H_ */
@@ -8,18 +8,66 @@
  *      \li connection to a previously created block
  *      \li destruction of a previously created block
  *      \li mapping of the block previously created on the process address space
- *      \li unmapping of the block off the process address space.
+ *      \li unmapping of the block off the process address space
+ *      \li getting the creation key of the run
+ *      \li setting the mapping options.
+ *
+ *  Implementation with System V shared memory; the key of the run is always derived from the working directory
+ *  (unless it is given in the environment), as the prebuilt entity programs expect.
  *
  *  \author António Rui Borges - October 1995
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
 #include <sys/types.h>
+#include <sys/ipc.h>
 #include <sys/shm.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#include "sharedMemory.h"
 
 /** \brief access permission: user r-w */
 #define  MASK           0600
 
+/** \brief number of words of the NUMA node masks */
+#define  NODE_WORDS     16
+
+/** \brief mapping options of this process (see shmemOptions) */
+static unsigned int options = 0;
+
+/** \brief NUMA node the pages are bound to (-1, for none) */
+static int bindNode = -1;
+
+/* internal functions */
+
+static int bindPages (void *add, size_t size, int node)
+{
+    unsigned long mask[NODE_WORDS] = { 0 };
+    unsigned int bits = 8 * sizeof (unsigned long);
+
+    if ((node < 0) || (node >= (int) (NODE_WORDS * bits))) {
+        errno = EINVAL;
+        return -1;
+    }
+    mask[node / bits] = 1UL << (node % bits);
+    return (int) syscall (SYS_mbind, add, size, MPOL_BIND, mask, NODE_WORDS * bits + 1, 0);
+}
+
+static void touchPages (void *add, size_t size)
+{
+    size_t page = (size_t) sysconf (_SC_PAGESIZE);
+    size_t off;
+
+    for (off = 0; off < size; off += page) {
+        (void) ((volatile char *) add)[off];
+    }
+}
+
 /**
  *  \brief Creation of a new block.
  *
@@ -34,7 +82,7 @@
 
 int shmemCreate (int key, unsigned int size)
 {
-  return shmget ((key_t) key, size, MASK | IPC_CREAT | IPC_EXCL);
+  return shmget ((key_t) key, size, MASK | IPC_CREAT | IPC_EXCL | ((options & SHMEM_HUGE) ? SHM_HUGETLB : 0));
 }
 
 /**
@@ -84,10 +132,22 @@ int shmemDestroy (int shmid)
 int shmemAttach (int shmid, void **pAttAdd)
 {
   void *add;                                                                                    /* temporary pointer */
+  struct shmid_ds ds;                                                                          /* status of the block */
 
   add = shmat (shmid, (char *) NULL, 0);
   if (add != (void *) -1)
-     { *pAttAdd = (void *) add;
+     { if ((bindNode != -1) || (options & SHMEM_POPULATE))
+          { if ((shmctl (shmid, IPC_STAT, &ds) == -1) ||
+                ((bindNode != -1) && (bindPages (add, ds.shm_segsz, bindNode) == -1)))
+               { int err = errno;                                          /* reported, not the one of the detachment */
+                 shmdt (add);
+                 errno = err;
+                 return -1;
+               }
+            if (options & SHMEM_POPULATE)
+               touchPages (add, ds.shm_segsz);
+          }
+       *pAttAdd = (void *) add;
        return 0;
      }
      else return 1;
@@ -109,3 +169,49 @@ int shmemDettach (void *attAdd)
 {
   return shmdt (attAdd);
 }
+
+/**
+ *  \brief Getting the creation key of the run.
+ *
+ *  It is the one in the environment variable SHMEM_KEY_ENV, if it is set, or else the one derived from the working
+ *  directory: System V blocks are looked up by key only, so there is no key of its own for each run.
+ *
+ *  \param unique true if the key is requested to start a run
+ *
+ *  \return creation key, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemKey (bool unique)
+{
+  char *env = getenv (SHMEM_KEY_ENV);                                                               /* key of the run */
+
+  (void) unique;
+  if (env != NULL)
+     return (int) strtol (env, NULL, 0);
+  return (int) ftok (".", 'a');
+}
+
+/**
+ *  \brief Setting the mapping options of the blocks created or mapped afterwards by this process.
+ *
+ *  Huge pages are requested at creation (SHM_HUGETLB, so they must have been reserved in
+ *  <tt>/proc/sys/vm/nr_hugepages</tt>); the pages are bound and faulted in when the block is mapped.
+ *
+ *  \param flags mapping options (SHMEM_HUGE, SHMEM_POPULATE)
+ *  \param node NUMA node the pages are bound to (-\c 1, for none)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemOptions (unsigned int flags, int node)
+{
+  if ((flags & ~(SHMEM_HUGE | SHMEM_POPULATE)) || (node < -1))
+     { errno = EINVAL;
+       return -1;
+     }
+  options = flags;
+  bindNode = node;
+  return 0;
+}
@@ -8,7 +8,12 @@
  *      \li connection to a previously created block
  *      \li destruction of a previously created block
  *      \li mapping of the block previously created on the process address space
- *      \li unmapping of the block off the process address space.
+ *      \li unmapping of the block off the process address space
+ *      \li getting the creation key of the run
+ *      \li setting the mapping options.
+ *
+ *  There are two implementations, selected at build time: System V shared memory (sharedMemory.c, the default)
+ *  and POSIX shared memory objects (sharedMemoryPosix.c, with <tt>make SHM=posix</tt>).
  *
  *  \author António Rui Borges - October 1995
  */
@@ -16,6 +21,17 @@
 #ifndef SHAREDMEMORY_H_
 #define SHAREDMEMORY_H_
 
+#include <stdbool.h>
+
+/** \brief mapping option: the block is backed by huge pages */
+#define  SHMEM_HUGE       0x1
+
+/** \brief mapping option: the pages of the block are faulted in when it is mapped */
+#define  SHMEM_POPULATE   0x2
+
+/** \brief environment variable carrying the creation key of a run to the processes it launches */
+#define  SHMEM_KEY_ENV    "SOCCERGAME_KEY"
+
 /**
  *  \brief Creation of a new block.
  *
@@ -84,4 +100,37 @@ extern int shmemAttach (int shmid, void **pAttAdd);
 
 extern int shmemDettach (void *attAdd);
 
+/**
+ *  \brief Getting the creation key of the run.
+ *
+ *  It is the one in the environment variable SHMEM_KEY_ENV, if it is set. Otherwise, if <tt>unique</tt> is true and
+ *  the blocks are named objects (POSIX implementation), a key of its own is taken for the run and exported in
+ *  SHMEM_KEY_ENV for the processes launched afterwards, so that several runs may take place in the same directory;
+ *  if not, the key is derived from the working directory, as <tt>ftok (".", 'a')</tt>.
+ *
+ *  \param unique true if the key is requested to start a run
+ *
+ *  \return creation key, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int shmemKey (bool unique);
+
+/**
+ *  \brief Setting the mapping options of the blocks created or mapped afterwards by this process.
+ *
+ *  The options are meant for large blocks: huge pages (SHMEM_HUGE) and pages faulted in at once (SHMEM_POPULATE),
+ *  both to spare page faults and TLB misses along the run, and the binding of the pages to a NUMA node. They are
+ *  set by the process that creates the block, before creating it; the pages get the node they are first faulted
+ *  in from.
+ *
+ *  \param flags mapping options (SHMEM_HUGE, SHMEM_POPULATE)
+ *  \param node NUMA node the pages are bound to (-\c 1, for none)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int shmemOptions (unsigned int flags, int node);
+
 #endif /* SHAREDMEMORY_H_ */
@@ -0,0 +1,345 @@
+/**
+ *  \file sharedMemoryPosix.c (implementation file)
+ *
+ *  \brief Shared memory management.
+ *
+ *   Operations defined on shared memory:
+ *      \li creation of a new block
+ *      \li connection to a previously created block
+ *      \li destruction of a previously created block
+ *      \li mapping of the block previously created on the process address space
+ *      \li unmapping of the block off the process address space
+ *      \li getting the creation key of the run
+ *      \li setting the mapping options.
+ *
+ *  Implementation with POSIX shared memory: each block is an object named after its creation key (or, for key
+ *  IPC_PRIVATE, an object of its own, unlinked as soon as it is created), mapped with <tt>mmap</tt>. As the
+ *  names are not tied to the working directory, each run takes a key of its own (see shmemKey) and many runs may
+ *  take place at the same time on one host.
+ *
+ *  Selected at build time with <tt>make SHM=posix</tt>; the interface is the one of sharedMemory.h.
+ *
+ *  \author António Rui Borges - October 1995
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/ipc.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#include "sharedMemory.h"
+
+/** \brief access permission: user r-w */
+#define  MASK           0600
+
+/** \brief maximum number of blocks a process may be connected to */
+#define  MAXBLOCKS      8
+
+/** \brief name of the shared memory object of the block with creation key <tt>key</tt> */
+#define  SHMNAME_FMT    "/soccergame.shm.%x"
+
+/** \brief name of the shared memory object of a private block of process <tt>pid</tt> */
+#define  PRIVNAME_FMT   "/soccergame.priv.%d.%d"
+
+/** \brief number of words of the NUMA node masks */
+#define  NODE_WORDS     16
+
+/** \brief blocks this process is connected to (the block identifier is the index) */
+static struct {
+    int fd;
+    size_t size;
+    int key;
+    void *add;
+} blocks[MAXBLOCKS];
+
+/** \brief number of private blocks created by this process */
+static int nPrivate = 0;
+
+/** \brief mapping options of this process (see shmemOptions) */
+static unsigned int options = 0;
+
+/** \brief NUMA node the pages are bound to (-1, for none) */
+static int bindNode = -1;
+
+/* internal functions */
+
+static int blockNew (int key, int fd, size_t size)
+{
+    int shmid;
+
+    for (shmid = 0; shmid < MAXBLOCKS; shmid++) {
+        if (blocks[shmid].size == 0) {
+            break;
+        }
+    }
+    if (shmid == MAXBLOCKS) {
+        close (fd);
+        errno = EMFILE;
+        return -1;
+    }
+    blocks[shmid].fd = fd;
+    blocks[shmid].size = size;
+    blocks[shmid].key = key;
+    blocks[shmid].add = NULL;
+    return shmid;
+}
+
+static bool blockValid (int shmid)
+{
+    if ((shmid < 0) || (shmid >= MAXBLOCKS) || (blocks[shmid].size == 0)) {
+        errno = EINVAL;
+        return false;
+    }
+    return true;
+}
+
+static int bindPages (void *add, size_t size, int node)
+{
+    unsigned long mask[NODE_WORDS] = { 0 };
+    unsigned int bits = 8 * sizeof (unsigned long);
+
+    if ((node < 0) || (node >= (int) (NODE_WORDS * bits))) {
+        errno = EINVAL;
+        return -1;
+    }
+    mask[node / bits] = 1UL << (node % bits);
+    return (int) syscall (SYS_mbind, add, size, MPOL_BIND, mask, NODE_WORDS * bits + 1, 0);
+}
+
+static void touchPages (void *add, size_t size)
+{
+    size_t page = (size_t) sysconf (_SC_PAGESIZE);
+    size_t off;
+
+    for (off = 0; off < size; off += page) {
+        (void) ((volatile char *) add)[off];
+    }
+}
+
+/**
+ *  \brief Creation of a new block.
+ *
+ *  The function fails if there is already a block of shared memory with a creation key equal to <tt>key</tt>.
+ *
+ *  \param key creation key
+ *  \param size block size (in bytes)
+ *
+ *  \return block identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemCreate (int key, unsigned int size)
+{
+  char name[48];                                                                  /* name of the shared memory object */
+  int fd;
+
+  if (size == 0)
+     { errno = EINVAL;
+       return -1;
+     }
+  if (key == IPC_PRIVATE)
+     sprintf (name, PRIVNAME_FMT, (int) getpid (), nPrivate++);
+     else sprintf (name, SHMNAME_FMT, (unsigned int) key);
+  if ((fd = shm_open (name, O_RDWR | O_CREAT | O_EXCL, MASK)) == -1)
+     return -1;
+  if (ftruncate (fd, size) == -1)                                                         /* the block is zero filled */
+     { close (fd);
+       shm_unlink (name);
+       return -1;
+     }
+  if (key == IPC_PRIVATE)                                                      /* it is only reachable through the fd */
+     shm_unlink (name);
+  return blockNew (key, fd, size);
+}
+
+/**
+ *  \brief Connection to a previously created block.
+ *
+ *  The function fails if there is no block with a creation key equal to <tt>key</tt>.
+ *
+ *  \param key creation key
+ *
+ *  \return block identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemConnect (int key)
+{
+  char name[48];                                                                  /* name of the shared memory object */
+  struct stat st;                                                               /* status of the shared memory object */
+  int fd, shmid;
+
+  sprintf (name, SHMNAME_FMT, (unsigned int) key);
+  if ((fd = shm_open (name, O_RDWR, MASK)) == -1)
+     return -1;
+  for (shmid = 0; shmid < MAXBLOCKS; shmid++)                                    /* already connected: the same block */
+    if ((blocks[shmid].size != 0) && (blocks[shmid].fd != -1) && (blocks[shmid].key == key))
+       { close (fd);
+         return shmid;
+       }
+  if (fstat (fd, &st) == -1)
+     { close (fd);
+       return -1;
+     }
+  return blockNew (key, fd, (size_t) st.st_size);
+}
+
+/**
+ *  \brief Destruction of a previously created block.
+ *
+ *  The function fails if there is no block with an identifier equal to <tt>shmid</tt>.
+ *  As with System V blocks, the mappings still in place remain valid until they are undone.
+ *
+ *  \param shmid block identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemDestroy (int shmid)
+{
+  char name[48];                                                                  /* name of the shared memory object */
+
+  if (!blockValid (shmid))
+     return -1;
+  close (blocks[shmid].fd);
+  blocks[shmid].fd = -1;
+  if (blocks[shmid].add == NULL)
+     blocks[shmid].size = 0;
+  if (blocks[shmid].key == IPC_PRIVATE)
+     return 0;
+  sprintf (name, SHMNAME_FMT, (unsigned int) blocks[shmid].key);
+  return shm_unlink (name);
+}
+
+/**
+ *  \brief Mapping of the block previously created on the process address space.
+ *
+ *  The function fails if there is no block with an identifier equal to <tt>shmid</tt>.
+ *
+ *  \param shmid block identifier
+ *  \param pAttAdd pointer to the location where the local address of the attached block is stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemAttach (int shmid, void **pAttAdd)
+{
+  int flags = MAP_SHARED;                                                                            /* mapping flags */
+  void *add;                                                                                     /* temporary pointer */
+
+  if (!blockValid (shmid) || (blocks[shmid].fd == -1))
+     { errno = EINVAL;
+       return -1;
+     }
+  if ((options & SHMEM_POPULATE) && (bindNode == -1))                       /* otherwise faulted in after the binding */
+     flags |= MAP_POPULATE;
+  add = mmap (NULL, blocks[shmid].size, PROT_READ | PROT_WRITE, flags, blocks[shmid].fd, 0);
+  if (add == MAP_FAILED)
+     return -1;
+  if (((options & SHMEM_HUGE) && (madvise (add, blocks[shmid].size, MADV_HUGEPAGE) == -1)) ||
+      ((bindNode != -1) && (bindPages (add, blocks[shmid].size, bindNode) == -1)))
+     { munmap (add, blocks[shmid].size);
+       return -1;
+     }
+  if ((options & SHMEM_POPULATE) && (bindNode != -1))
+     touchPages (add, blocks[shmid].size);
+  blocks[shmid].add = add;
+  *pAttAdd = add;
+  return 0;
+}
+
+/**
+ *  \brief Unmapping of the block off the process address space.
+ *
+ *  The function fails if the pointer does not locate a region of the address space
+ *  where a mapping took previously place.
+ *
+ *  \param attAdd local address of the attached block
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemDettach (void *attAdd)
+{
+  int shmid;
+
+  for (shmid = 0; shmid < MAXBLOCKS; shmid++)
+    if ((blocks[shmid].size != 0) && (blocks[shmid].add == attAdd))
+       break;
+  if ((attAdd == NULL) || (shmid == MAXBLOCKS))
+     { errno = EINVAL;
+       return -1;
+     }
+  if (munmap (attAdd, blocks[shmid].size) == -1)
+     return -1;
+  blocks[shmid].add = NULL;
+  if (blocks[shmid].fd == -1)                                                              /* the block was destroyed */
+     blocks[shmid].size = 0;
+  return 0;
+}
+
+/**
+ *  \brief Getting the creation key of the run.
+ *
+ *  It is the one in the environment variable SHMEM_KEY_ENV, if it is set. Otherwise, a run being started takes
+ *  the process id of the caller, which no other run in progress on the host can have, and exports it in
+ *  SHMEM_KEY_ENV; any other caller gets the key derived from the working directory.
+ *
+ *  \param unique true if the key is requested to start a run
+ *
+ *  \return creation key, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemKey (bool unique)
+{
+  char *env = getenv (SHMEM_KEY_ENV);                                                               /* key of the run */
+  char val[16];                                                                                   /* key, as exported */
+  int key;
+
+  if (env != NULL)
+     return (int) strtol (env, NULL, 0);
+  if (!unique)
+     return (int) ftok (".", 'a');
+  key = (int) getpid ();
+  sprintf (val, "0x%x", (unsigned int) key);
+  if (setenv (SHMEM_KEY_ENV, val, 1) == -1)
+     return -1;
+  return key;
+}
+
+/**
+ *  \brief Setting the mapping options of the blocks created or mapped afterwards by this process.
+ *
+ *  The objects live in a tmpfs file system, on which <tt>MAP_HUGETLB</tt> is not available: huge pages are
+ *  requested with <tt>madvise (MADV_HUGEPAGE)</tt>, so they are transparent huge pages (the <tt>shmem_enabled</tt>
+ *  setting of the kernel must allow them). The pages are bound to the node before being faulted in.
+ *
+ *  \param flags mapping options (SHMEM_HUGE, SHMEM_POPULATE)
+ *  \param node NUMA node the pages are bound to (-\c 1, for none)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemOptions (unsigned int flags, int node)
+{
+  if ((flags & ~(SHMEM_HUGE | SHMEM_POPULATE)) || (node < -1))
+     { errno = EINVAL;
+       return -1;
+     }
+  options = flags;
+  bindNode = node;
+  return 0;
+}
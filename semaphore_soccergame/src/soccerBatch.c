@@ -0,0 +1,477 @@
+/**
+ *  \file soccerBatch.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Batch runner: it carries out many independent simulations, several at a time, and aggregates their results.
+ *
+ *  Each run is a generator process with a creation key of its own (passed in the environment, see shmemKey), a
+ *  binary trace of its own and error files of its own (generator options -b and -e), so that the runs do not
+ *  interfere with each other, whatever the shared memory and semaphore implementations. The invariants of every
+ *  run are checked (generator option -C): a run that breaks them, or one of whose entities fails, fails. The exit
+ *  status and the wall time of every run are collected, and its trace is read to find which entities were late
+ *  and which team of their match they played in.
+ *
+ *  Upon execution, the following parameters are accepted:
+ *    \li -n n: number of runs (default 1000)
+ *    \li -j n: number of runs at a time (default, the number of online processors)
+ *    \li -d dir: directory where the outputs of the runs are written (default batch); it holds runs.tsv, with the
+ *        results and the seed of each run (so that a failed run may be repeated, generator option -x), and the
+ *        trace, the output and the entity error files of each failed run (named after the run number)
+ *    \li -k: the trace, the output and the error files of every run are kept, not only those of the failed runs
+ *    \li -w s: watchdog of the runs (generator option -W): a run that makes no progress for s seconds is aborted,
+ *        and counted as failed, with its state in its output (default WATCHDOG; none, for 0)
+ *    \li generator options, after <tt>--</tt> (e.g. <tt>-- -M 5 -p 60 -g 15 -R 3</tt>).
+ *
+ *  The summary is printed on the standard output: the number of runs and failures, the total wall time and the
+ *  throughput, the run times, and, for each player and goalie, the number of runs in which it was late, played in
+ *  the first team of its match or played in the second one.
+ *
+ *  It is to be run in the directory of the generator and the entity programs.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <glob.h>
+
+#include "probConst.h"
+#include "logging.h"
+#include "sharedMemory.h"
+
+/** \brief name of generator program */
+#define   GENERATOR            "./probSemSharedMemSoccerGame"
+
+/** \brief maximum length of the names of the run output files */
+#define   PATH_LEN             512
+
+/** \brief maximum number of runs at a time */
+#define   MAXJOBS              4096
+
+/** \brief default watchdog of the runs (in s) */
+#define   WATCHDOG             10
+
+/** \brief command line usage */
+#define   USAGE                "Usage: %s [-n runs] [-j jobs] [-d dir] [-k] [-w seconds] [-- generator options]\n"
+
+/** \brief entity seen late in a run */
+#define   SEEN_LATE            0x1
+/** \brief entity seen in the first team of its match in a run */
+#define   SEEN_FIRST           0x2
+/** \brief entity seen in the second team of its match in a run */
+#define   SEEN_SECOND          0x4
+
+/** \brief run in progress in a slot */
+typedef struct {
+    pid_t pid;                                                          /* generator process (0, if the slot is free) */
+    int run;                                                                                            /* run number */
+    struct timespec tStart;                                                                       /* start of the run */
+} SLOT;
+
+/** \brief directory of the run outputs */
+static char *dir = "batch";
+
+/** \brief watchdog of the runs (in s, 0 if none) */
+static int watchdog = WATCHDOG;
+
+/** \brief roster of the runs (taken from the first trace read) */
+static TRACE_HDR roster;
+
+/** \brief number of runs in which each entity was late, played in the first team and played in the second one */
+static unsigned long *nLate, *nFirst, *nSecond;
+
+/** \brief state flags of each entity in the run being read */
+static uint8_t *seen;
+
+/**
+ *  \brief Conversion of a numerical command line parameter.
+ *
+ *  The program is terminated if the parameter is not an integer between <tt>min</tt> and <tt>max</tt>.
+ *
+ *  \param arg parameter
+ *  \param min minimum value
+ *  \param max maximum value
+ *
+ *  \return parameter value
+ */
+static int getCount (char *arg, int min, int max)
+{
+    char *tinp;                                                                     /* numerical parameters test flag */
+    long val = strtol (arg, &tinp, 0);
+
+    if ((*tinp != '\0') || (val < min) || (val > max)) {
+        fprintf (stderr, "Wrong numerical parameter (\"%s\")\n", arg);
+        exit (EXIT_FAILURE);
+    }
+    return (int) val;
+}
+
+/**
+ *  \brief Time elapsed since <tt>t0</tt> (in s).
+ *
+ *  \param t0 start time
+ *
+ *  \return elapsed time
+ */
+static double elapsed (struct timespec *t0)
+{
+    struct timespec t;
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return (t.tv_sec - t0->tv_sec) + 1e-9 * (t.tv_nsec - t0->tv_nsec);
+}
+
+/**
+ *  \brief Name of an output file of run <tt>run</tt>.
+ *
+ *  \param name pointer to the location where the name is stored (at least PATH_LEN bytes)
+ *  \param run run number
+ *  \param ext file extension
+ */
+static void runFile (char *name, int run, const char *ext)
+{
+    snprintf (name, PATH_LEN, "%s/%06d.%s", dir, run, ext);
+}
+
+/**
+ *  \brief Start of run <tt>run</tt> in a slot.
+ *
+ *  The generator is run with the creation key <tt>key</tt>, its output going to the output file of the run and the
+ *  error files of its entities being named after the run.
+ *
+ *  \param slot slot of the run
+ *  \param run run number
+ *  \param key creation key of the run
+ *  \param genArgs generator options
+ *  \param nGenArgs number of generator options
+ */
+static void startRun (SLOT *slot, int run, int key, char *genArgs[], int nGenArgs)
+{
+    char trace[PATH_LEN], out[PATH_LEN], errPrefix[PATH_LEN], keyStr[16], wdStr[16];
+    char **args;
+    int fd, a, n = 0;
+
+    runFile (trace, run, "trace");
+    runFile (out, run, "out");
+    runFile (errPrefix, run, "");
+    snprintf (keyStr, sizeof (keyStr), "0x%x", (unsigned int) key);
+    snprintf (wdStr, sizeof (wdStr), "%d", watchdog);
+
+    clock_gettime (CLOCK_MONOTONIC, &slot->tStart);
+    slot->run = run;
+    if ((slot->pid = fork ()) < 0) {
+        perror ("error on the fork operation");
+        exit (EXIT_FAILURE);
+    }
+    if (slot->pid != 0) {
+        return;
+    }
+
+    if ((args = malloc ((nGenArgs + 9) * sizeof (char *))) == NULL) {
+        perror ("error on allocating the generator parameters");
+        exit (EXIT_FAILURE);
+    }
+    args[n++] = GENERATOR;
+    args[n++] = "-b";
+    args[n++] = "-C";
+    args[n++] = "-e";
+    args[n++] = errPrefix;
+    if (watchdog > 0) {
+        args[n++] = "-W";
+        args[n++] = wdStr;
+    }
+    for (a = 0; a < nGenArgs; a++) {
+        args[n++] = genArgs[a];
+    }
+    args[n++] = trace;
+    args[n] = NULL;
+
+    if ((fd = open (out, O_WRONLY | O_CREAT | O_TRUNC, 0600)) == -1) {
+        perror ("error on opening the run output file");
+        exit (EXIT_FAILURE);
+    }
+    dup2 (fd, STDOUT_FILENO);
+    dup2 (fd, STDERR_FILENO);
+    close (fd);
+    if (setenv (SHMEM_KEY_ENV, keyStr, 1) == -1) {
+        perror ("error on setting the creation key of the run");
+        exit (EXIT_FAILURE);
+    }
+    execv (GENERATOR, args);
+    perror ("error on the generation of the process");
+    exit (EXIT_FAILURE);
+}
+
+/**
+ *  \brief Reading the seed of run <tt>run</tt> from its trace.
+ *
+ *  \param run run number
+ *
+ *  \return seed of the run (0, if the trace is missing or of another version)
+ */
+static uint64_t readSeed (int run)
+{
+    char name[PATH_LEN];
+    FILE *fic;
+    TRACE_HDR hdr;
+
+    runFile (name, run, "trace");
+    if ((fic = fopen (name, "r")) == NULL) {
+        return 0;
+    }
+    if ((fread (&hdr, sizeof (hdr), 1, fic) != 1) || (hdr.magic != TRACE_MAGIC) || (hdr.version != TRACE_VERSION)) {
+        hdr.seed = 0;
+    }
+    fclose (fic);
+    return hdr.seed;
+}
+
+/**
+ *  \brief Reading the trace of run <tt>run</tt>.
+ *
+ *  The per entity counters are updated; those of the late players and goalies of the run are returned.
+ *
+ *  \param run run number
+ *  \param pLatePL pointer to the location where the number of late players is stored
+ *  \param pLateGL pointer to the location where the number of late goalies is stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, if the trace is missing, truncated or of another roster
+ */
+static int readTrace (int run, unsigned int *pLatePL, unsigned int *pLateGL)
+{
+    char name[PATH_LEN];
+    FILE *fic;
+    TRACE_HDR hdr;
+    TRACE_REC rec;
+    unsigned int nCol, c;
+
+    runFile (name, run, "trace");
+    if ((fic = fopen (name, "r")) == NULL) {
+        return -1;
+    }
+    if ((fread (&hdr, sizeof (hdr), 1, fic) != 1) || (hdr.magic != TRACE_MAGIC) || (hdr.version != TRACE_VERSION)) {
+        fclose (fic);
+        return -1;
+    }
+    nCol = hdr.nPlayers + hdr.nGoalies + hdr.nReferees;
+    if (seen == NULL) {                                                                                /* first trace */
+        roster = hdr;
+        if (((seen = malloc (nCol)) == NULL) || ((nLate = calloc (nCol, sizeof (unsigned long))) == NULL) ||
+            ((nFirst = calloc (nCol, sizeof (unsigned long))) == NULL) ||
+            ((nSecond = calloc (nCol, sizeof (unsigned long))) == NULL)) {
+            perror ("error on allocating the entity counters");
+            exit (EXIT_FAILURE);
+        }
+    }
+    else if ((hdr.nPlayers != roster.nPlayers) || (hdr.nGoalies != roster.nGoalies) ||
+             (hdr.nReferees != roster.nReferees)) {
+        fclose (fic);
+        return -1;
+    }
+    if (fread (seen, 1, nCol, fic) != nCol) {                                       /* the initial states are skipped */
+        fclose (fic);
+        return -1;
+    }
+    memset (seen, 0, nCol);
+    while (fread (&rec, sizeof (rec), 1, fic) == 1) {
+        if ((c = TRACE_COL(&rec)) >= nCol) {
+            fclose (fic);
+            return -1;
+        }
+        if (c >= hdr.nPlayers + hdr.nGoalies) {                                                     /* referee states */
+            continue;
+        }
+        switch (TRACE_STATE(&rec)) {
+            case LATE:            seen[c] |= SEEN_LATE;
+                                  break;
+            case WAITING_START_1: seen[c] |= SEEN_FIRST;
+                                  break;
+            case WAITING_START_2: seen[c] |= SEEN_SECOND;
+                                  break;
+        }
+    }
+    fclose (fic);
+
+    *pLatePL = *pLateGL = 0;
+    for (c = 0; c < hdr.nPlayers + hdr.nGoalies; c++) {
+        if (seen[c] & SEEN_LATE) {
+            nLate[c]++;
+            if (c < hdr.nPlayers) {
+                (*pLatePL)++;
+            }
+            else (*pLateGL)++;
+        }
+        if (seen[c] & SEEN_FIRST) {
+            nFirst[c]++;
+        }
+        if (seen[c] & SEEN_SECOND) {
+            nSecond[c]++;
+        }
+    }
+    return 0;
+}
+
+/**
+ *  \brief End of the run in a slot.
+ *
+ *  Its results are written to the runs table; the trace, the output and the error files are removed, unless the run
+ *  failed or they are to be kept.
+ *
+ *  \param slot slot of the run
+ *  \param s slot number
+ *  \param status exit status of the generator
+ *  \param tab runs table
+ *  \param keep true if the trace, the output and the error files are to be kept
+ *  \param t time of the run
+ *
+ *  \return true if the run failed
+ */
+static bool endRun (SLOT *slot, int s, int status, FILE *tab, bool keep, double t)
+{
+    char name[PATH_LEN];
+    glob_t errFiles;
+    size_t f;
+    unsigned int latePL = 0, lateGL = 0;
+    int code = WIFEXITED (status) ? WEXITSTATUS (status) : 128 + WTERMSIG (status);
+    bool failed = (code != 0) || (readTrace (slot->run, &latePL, &lateGL) == -1);
+
+    fprintf (tab, "%d\t%d\t%d\t%s\t%.6f\t%u\t%u\t%llu\n", slot->run, s, code, failed ? "fail" : "ok", t, latePL, lateGL,
+             (unsigned long long) readSeed (slot->run));
+    if (failed) {
+        fprintf (stderr, "run %d failed (exit status %d): see %s/%06d.out and the error files %s/%06d.error_*\n",
+                 slot->run, code, dir, slot->run, dir, slot->run);
+    }
+    else if (!keep) {
+        runFile (name, slot->run, "trace");
+        unlink (name);
+        runFile (name, slot->run, "out");
+        unlink (name);
+        runFile (name, slot->run, "error_*");
+        if (glob (name, 0, NULL, &errFiles) == 0) {
+            for (f = 0; f < errFiles.gl_pathc; f++) {
+                unlink (errFiles.gl_pathv[f]);
+            }
+            globfree (&errFiles);
+        }
+    }
+    slot->pid = 0;
+    return failed;
+}
+
+/**
+ *  \brief Main program.
+ *
+ *  Its role is to carry out the runs, keeping <tt>jobs</tt> of them in progress, and to print their summary.
+ */
+int main (int argc, char *argv[])
+{
+    int nRuns = 1000,                                                                               /* number of runs */
+        nJobs = (int) sysconf (_SC_NPROCESSORS_ONLN);                                     /* number of runs at a time */
+    bool keep = false;                                                               /* keep the outputs of every run */
+    SLOT *slots;                                                                                  /* runs in progress */
+    FILE *tab;                                                                                          /* runs table */
+    char name[PATH_LEN];
+    int opt, status, s, next = 0, running = 0, nFailed = 0, baseKey;
+    unsigned int c;
+    pid_t pid;
+    double t, tSum = 0.0, tMin = 0.0, tMax = 0.0;
+    struct timespec tStart;
+
+    while ((opt = getopt (argc, argv, "n:j:d:kw:")) != -1) {
+        switch (opt) {
+            case 'n': nRuns = getCount (optarg, 1, 100000000);
+                      break;
+            case 'j': nJobs = getCount (optarg, 1, MAXJOBS);
+                      break;
+            case 'd': dir = optarg;
+                      break;
+            case 'k': keep = true;
+                      break;
+            case 'w': watchdog = getCount (optarg, 0, 1000000);
+                      break;
+            default:  fprintf (stderr, USAGE, argv[0]);
+                      return EXIT_FAILURE;
+        }
+    }
+    if (nJobs < 1) {
+        nJobs = 1;
+    }
+    if (nJobs > nRuns) {
+        nJobs = nRuns;
+    }
+    if ((mkdir (dir, 0700) == -1) && (errno != EEXIST)) {
+        perror ("error on creating the output directory");
+        return EXIT_FAILURE;
+    }
+    snprintf (name, sizeof (name), "%s/runs.tsv", dir);
+    if ((tab = fopen (name, "w")) == NULL) {
+        perror ("error on creating the runs table");
+        return EXIT_FAILURE;
+    }
+    fprintf (tab, "run\tslot\texit\tresult\tseconds\tlate_players\tlate_goalies\tseed\n");
+    if ((slots = calloc (nJobs, sizeof (SLOT))) == NULL) {
+        perror ("error on allocating the slots");
+        return EXIT_FAILURE;
+    }
+
+    /* the keys of the slots are apart from those of ftok (upper byte 0x40) and of other batches (process id) */
+    baseKey = (int) (0x40000000u | (((unsigned int) getpid () & 0x3ffffu) << 12));
+
+    clock_gettime (CLOCK_MONOTONIC, &tStart);
+    while ((next < nRuns) || (running > 0)) {
+        for (s = 0; (s < nJobs) && (next < nRuns); s++) {
+            if (slots[s].pid == 0) {
+                startRun (&slots[s], next++, baseKey | s, argv + optind, argc - optind);
+                running++;
+            }
+        }
+        if ((pid = wait (&status)) == -1) {
+            perror ("error on waiting for a run");
+            return EXIT_FAILURE;
+        }
+        for (s = 0; (s < nJobs) && (slots[s].pid != pid); s++)
+            ;
+        if (s == nJobs) {
+            continue;
+        }
+        t = elapsed (&slots[s].tStart);
+        tSum += t;
+        tMin = ((tMin == 0.0) || (t < tMin)) ? t : tMin;
+        tMax = (t > tMax) ? t : tMax;
+        running--;
+        if (endRun (&slots[s], s, status, tab, keep, t)) {
+            nFailed++;
+        }
+    }
+    t = elapsed (&tStart);
+    fclose (tab);
+
+    printf ("%d runs, %d at a time: %d failed, %.3f s, %.1f runs/s\n", nRuns, nJobs, nFailed, t, nRuns / t);
+    printf ("run time: avg %.6f s, min %.6f s, max %.6f s (sum %.3f s, %.2f runs in progress on average)\n",
+            tSum / nRuns, tMin, tMax, tSum, tSum / t);
+    if (seen != NULL) {
+        printf ("%-8s %10s %10s %10s\n", "entity", "late", "first", "second");
+        for (c = 0; c < roster.nPlayers + roster.nGoalies; c++) {
+            if (c < roster.nPlayers) {
+                snprintf (name, sizeof (name), "P%02u", c);
+            }
+            else snprintf (name, sizeof (name), "G%02u", c - roster.nPlayers);
+            printf ("%-8s %10lu %10lu %10lu\n", name, nLate[c], nFirst[c], nSecond[c]);
+        }
+    }
+    printf ("results of each run in %s/runs.tsv\n", dir);
+
+    return (nFailed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,821 @@
+/**
+ *  \file soccerBench.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Benchmark harness: end-to-end latencies of single match runs and cost of the synchronization primitives.
+ *
+ *  The end-to-end part runs the generator (as <tt>probSemSharedMemSoccerGame -b ... trace</tt>) a number of times
+ *  and takes, from the binary trace of each run and from the time the generator is started and terminates:
+ *    \li startup: from starting the generator to the first state change of an entity
+ *    \li formation: from the first state change to both teams formed (last participant waiting for the start)
+ *    \li start: from the referee starting the game to every participant unblocked (playing)
+ *    \li teardown: from the referee ending the game to the termination of the generator.
+ *
+ *  The microbenchmarks, with the semaphore implementation the program is linked with, measure:
+ *    \li a <em>up</em> followed by a <em>down</em> of the same semaphore, never blocking
+ *    \li a round trip between two processes, each blocking until the other one makes an <em>up</em>
+ *    \li mapping a shared memory block onto the process address space and unmapping it.
+ *
+ *  The scaling sweep runs the generator over a grid of configurations: number of matches, players per team, number
+ *  of (concurrent) referees and engine (entity processes, threads or fibers), with one goalie per team and just the
+ *  players and goalies the matches need. Each point is run a number of times, the k-th one with seed k (so that the
+ *  delays of the entities are the same from sweep to sweep), and gets, from the binary traces and from the resource
+ *  usage of the generator and of its entity processes:
+ *    \li throughput: matches ended per second, from the first state change to the end of the last match
+ *    \li formation: 99th percentile, over the participants, of the time from joining a team to waiting for the start
+ *    \li peak RSS: largest resident set size of the generator or of any of its entity processes
+ *    \li context switches per match, voluntary and involuntary, standing for the blocking system calls.
+ *
+ *  A sweep is checked against a stored one (the baseline) by comparing the points common to both: a throughput lower,
+ *  or any other measure larger, than the baseline one by more than a tolerance is a regression.
+ *
+ *  Upon execution, the following parameters are accepted:
+ *    \li -n runs: number of generator runs (default 100), or of runs of each point of the sweep
+ *    \li -k iterations: number of iterations of each microbenchmark (default 100000)
+ *    \li -e: the end-to-end part only
+ *    \li -m: the microbenchmarks only
+ *    \li -w: the scaling sweep only
+ *    \li -M list, -P list, -R list: comma separated numbers of matches (default 1,4,16), players per team (default
+ *        4,16) and referees (default 1,4) of the sweep
+ *    \li -E list: engines of the sweep, among proc, thread and fiber (default proc,thread, and fiber with the futex
+ *        semaphores); the fibers with other semaphores and the points with more entities than an engine can run on
+ *        a single host are left out
+ *    \li -c baseline: the sweep read from the standard input is checked against the baseline file
+ *    \li -t percent: tolerance of the check (default 25)
+ *    \li any parameters after <tt>--</tt> are passed on to the generator (it always plays a single match, but in the
+ *        sweep).
+ *
+ *  The results are written to the standard output, one line per measure, with tab separated fields: name,
+ *  semaphore implementation, unit, number of samples, minimum, median, 99th percentile and maximum. Those of the
+ *  sweep, one line per point: point, semaphore implementation, number of complete runs, median throughput (matches/s),
+ *  formation latency (us), largest peak RSS (KiB) and median context switches per match. The check writes one line
+ *  per regression and exits with a failure status if there is any.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/ipc.h>
+
+#include "probConst.h"
+#include "logging.h"
+#include "semaphore.h"
+#include "sharedMemory.h"
+
+/** \brief semaphore implementation the program is linked with */
+#ifndef SEM_BACKEND
+#define   SEM_BACKEND          "sysv"
+#endif
+
+/** \brief name of generator program */
+#define   GENERATOR            "./probSemSharedMemSoccerGame"
+
+/** \brief name of the trace file of the generator runs */
+#define   TRACE_FILE           "bench.trace"
+
+/** \brief number of operations timed together in the non blocking microbenchmark */
+#define   BATCH                64
+
+/** \brief maximum number of parameters passed on to the generator */
+#define   MAXARGS              32
+
+/** \brief maximum number of values of a list of the sweep */
+#define   MAXLIST              16
+
+/** \brief maximum number of points of a sweep that is checked */
+#define   MAXPOINTS            1024
+
+/** \brief command line usage */
+#define   USAGE                "Usage: %s [-n runs] [-k iterations] [-e|-m|-w] [-M matches] [-P team players]" \
+                               " [-R referees] [-E engines] [-c baseline] [-t percent] [-- generator parameters]\n"
+
+/** \brief default engines of the sweep (the fibers need the futex semaphores) */
+#define   SWEEP_ENGINES        ((strcmp (SEM_BACKEND, "futex") == 0) ? "proc,thread,fiber" : "proc,thread")
+
+/**
+ *  \brief Definition of <em>sample set</em> data type.
+ */
+typedef struct {
+    /** \brief name of the measure */
+    char *name;
+    /** \brief unit of the samples */
+    char *unit;
+    /** \brief number of samples */
+    unsigned int n;
+    /** \brief samples */
+    double *val;
+} SAMPLES;
+
+/**
+ *  \brief Definition of <em>engine</em> data type.
+ */
+typedef struct {
+    /** \brief name, in the sweep lists and results */
+    char *name;
+    /** \brief generator parameter selecting it (NULL, for the entity processes) */
+    char *opt;
+    /** \brief largest number of entities of a point */
+    unsigned int maxEntities;
+    /** \brief the engine needs the futex semaphores */
+    bool futex;
+} ENGINE;
+
+/**
+ *  \brief Definition of <em>point of a sweep</em> data type.
+ */
+typedef struct {
+    /** \brief point (engine, matches, players per team and referees) */
+    char name[64];
+    /** \brief semaphore implementation */
+    char backend[16];
+    /** \brief number of complete runs */
+    unsigned int runs;
+    /** \brief measures: throughput, formation latency, peak RSS and context switches per match */
+    double val[4];
+} POINT;
+
+/** \brief engines of the sweep: the fibers are run by as many kernel threads as there are processors */
+static const ENGINE engines[] = {
+    { "proc",   NULL, 4096,     false },
+    { "thread", "-T", 32768,    false },
+    { "fiber",  "-F", 1u << 20, true }
+};
+
+/** \brief generator parameters of a point: players, goalies, players per team, referees and matches */
+static char *pointOpts[] = { "-p", "-g", "-P", "-R", "-M" };
+
+/** \brief names of the measures of a point */
+static char *measures[] = { "matches_s", "formation_p99_us", "maxrss_kb", "ctxsw_match" };
+
+/* internal functions */
+
+static uint64_t now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+static void samplesInit (SAMPLES *s, char *name, char *unit, unsigned int max)
+{
+    s->name = name;
+    s->unit = unit;
+    s->n = 0;
+    if ((s->val = malloc (max * sizeof (double))) == NULL) {
+        perror ("error on allocating the samples");
+        exit (EXIT_FAILURE);
+    }
+}
+
+static int cmpDouble (const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+/* sample of a sorted sample set at a given fraction of its distribution */
+static double quantile (SAMPLES *s, double q)
+{
+    return (s->n == 0) ? 0.0 : s->val[(size_t) ((s->n - 1) * q)];
+}
+
+/**
+ *  \brief Output of the distribution of a sample set, as a line of tab separated fields.
+ *
+ *  \param s sample set
+ */
+static void report (SAMPLES *s)
+{
+    if (s->n == 0) {
+        return;
+    }
+    qsort (s->val, s->n, sizeof (double), cmpDouble);
+    printf ("%s\t%s\t%s\t%u\t%.3f\t%.3f\t%.3f\t%.3f\n", s->name, SEM_BACKEND, s->unit, s->n, s->val[0],
+            quantile (s, 0.5), quantile (s, 0.99), s->val[s->n - 1]);
+    free (s->val);
+}
+
+/**
+ *  \brief Run of the generator, to its termination.
+ *
+ *  \param argv generator parameters
+ *  \param ru storage for the resource usage of the generator and of its entity processes
+ *
+ *  \return true if the generator terminated successfully
+ */
+static bool generate (char *argv[], struct rusage *ru)
+{
+    int pid, status;
+
+    fflush (stdout);
+    if ((pid = fork ()) < 0) {
+        perror ("error on the fork operation");
+        exit (EXIT_FAILURE);
+    }
+    if (pid == 0) {
+        freopen ("/dev/null", "w", stdout);
+        freopen ("/dev/null", "w", stderr);
+        execv (GENERATOR, argv);
+        _exit (EXIT_FAILURE);
+    }
+    return (wait4 (pid, &status, 0, ru) != -1) && WIFEXITED (status) && (WEXITSTATUS (status) == EXIT_SUCCESS);
+}
+
+/**
+ *  \brief Opening of the trace of a generator run.
+ *
+ *  \param hdr storage for the trace header
+ *  \param st storage for the address of the initial states, one per column (to be freed)
+ *
+ *  \return the trace file, positioned at its first record, or NULL if it is not a complete trace
+ */
+static FILE *traceOpen (TRACE_HDR *hdr, char **st)
+{
+    FILE *fic;
+    unsigned int nCol;
+
+    if ((fic = fopen (TRACE_FILE, "r")) == NULL) {
+        return NULL;
+    }
+    if ((fread (hdr, sizeof (*hdr), 1, fic) != 1) || (hdr->magic != TRACE_MAGIC) || (hdr->version != TRACE_VERSION)) {
+        fclose (fic);
+        return NULL;
+    }
+    nCol = hdr->nPlayers + hdr->nGoalies + hdr->nReferees;
+    if ((*st = malloc (nCol)) == NULL) {
+        perror ("error on allocating the trace buffers");
+        exit (EXIT_FAILURE);
+    }
+    if (fread (*st, 1, nCol, fic) != nCol) {
+        free (*st);
+        fclose (fic);
+        return NULL;
+    }
+    return fic;
+}
+
+/**
+ *  \brief One run of the generator.
+ *
+ *  \param argv generator parameters
+ *  \param startup storage for the startup latency
+ *  \param formation storage for the formation latency
+ *  \param start storage for the start latency
+ *  \param teardown storage for the teardown latency
+ *
+ *  \return true if the run produced a complete trace
+ */
+static bool runOnce (char *argv[], SAMPLES *startup, SAMPLES *formation, SAMPLES *start, SAMPLES *teardown)
+{
+    uint64_t tFork, tExit;                                                          /* starting and termination times */
+    struct rusage ru;
+    FILE *fic;
+    TRACE_HDR hdr;
+    TRACE_REC rec;
+    char *st;                                                                                /* state of every column */
+    uint64_t *tWait, *tPlay;                                         /* times of waiting for the start and of playing */
+    uint64_t tFirst = 0, tStart = 0, tEnd = 0, tFormed = 0, tUnblocked = 0;
+    bool first = true;
+    unsigned int c, nCol;
+
+    tFork = now ();
+    if (!generate (argv, &ru)) {
+        return false;
+    }
+    tExit = now ();
+
+    if ((fic = traceOpen (&hdr, &st)) == NULL) {
+        return false;
+    }
+    nCol = hdr.nPlayers + hdr.nGoalies + hdr.nReferees;
+    if (((tWait = calloc (nCol, sizeof (uint64_t))) == NULL) || ((tPlay = calloc (nCol, sizeof (uint64_t))) == NULL)) {
+        perror ("error on allocating the trace buffers");
+        exit (EXIT_FAILURE);
+    }
+    while (fread (&rec, sizeof (rec), 1, fic) == 1) {
+        if ((c = TRACE_COL(&rec)) >= nCol) {
+            break;
+        }
+        st[c] = TRACE_STATE(&rec);
+        if (first) {
+            tFirst = rec.tstamp;
+            first = false;
+        }
+        if (c >= hdr.nPlayers + hdr.nGoalies) {                                                            /* referee */
+            if (st[c] == STARTING_GAME) {
+                tStart = rec.tstamp;
+            }
+            else if (st[c] == ENDING_GAME) {
+                tEnd = rec.tstamp;
+            }
+        }
+        else if ((st[c] == WAITING_START_1) || (st[c] == WAITING_START_2)) {
+            tWait[c] = rec.tstamp;
+        }
+        else if ((st[c] == PLAYING_1) || (st[c] == PLAYING_2)) {
+            tPlay[c] = rec.tstamp;
+        }
+    }
+    fclose (fic);
+
+    /* the participants are the players and goalies that played */
+    for (c = 0; c < hdr.nPlayers + hdr.nGoalies; c++) {
+        if (tPlay[c] != 0) {
+            tFormed = (tWait[c] > tFormed) ? tWait[c] : tFormed;
+            tUnblocked = (tPlay[c] > tUnblocked) ? tPlay[c] : tUnblocked;
+        }
+    }
+    free (st);
+    free (tWait);
+    free (tPlay);
+    if (first || (tStart == 0) || (tEnd == 0)) {
+        return false;
+    }
+
+    startup->val[startup->n++] = (hdr.t0 + 1000ull * tFirst - tFork) / 1e3;
+    formation->val[formation->n++] = (double) (tFormed - tFirst);
+    start->val[start->n++] = (double) (tUnblocked - tStart);
+    teardown->val[teardown->n++] = (tExit - hdr.t0 - 1000ull * tEnd) / 1e3;
+    return true;
+}
+
+/**
+ *  \brief End-to-end benchmark: single match runs of the generator.
+ *
+ *  \param nRuns number of runs
+ *  \param nArgs number of parameters to pass on to the generator
+ *  \param args parameters to pass on to the generator
+ */
+static void benchRuns (unsigned int nRuns, int nArgs, char *args[])
+{
+    char *argv[MAXARGS + 4];
+    SAMPLES startup, formation, start, teardown;
+    unsigned int r, failed = 0;
+    int a, n = 0;
+
+    argv[n++] = GENERATOR;
+    argv[n++] = "-b";
+    for (a = 0; (a < nArgs) && (a < MAXARGS); a++) {
+        argv[n++] = args[a];
+    }
+    argv[n++] = TRACE_FILE;
+    argv[n] = NULL;
+
+    samplesInit (&startup, "startup", "us", nRuns);
+    samplesInit (&formation, "formation", "us", nRuns);
+    samplesInit (&start, "start", "us", nRuns);
+    samplesInit (&teardown, "teardown", "us", nRuns);
+    for (r = 0; r < nRuns; r++) {
+        if (!runOnce (argv, &startup, &formation, &start, &teardown)) {
+            failed++;
+        }
+    }
+    unlink (TRACE_FILE);
+    if (failed > 0) {
+        fprintf (stderr, "%u of %u generator runs failed\n", failed, nRuns);
+    }
+    report (&startup);
+    report (&formation);
+    report (&start);
+    report (&teardown);
+}
+
+/**
+ *  \brief Microbenchmarks of the semaphores and of the shared memory.
+ *
+ *  \param nIter number of iterations of each one
+ */
+static void benchPrimitives (unsigned int nIter)
+{
+    SAMPLES upDown, pingPong, attach;
+    int key, semgid, shmid, pid;
+    uint64_t t;
+    unsigned int i, b;
+    void *add;
+
+    /* the set is shared with a child process, so it must not be private (not even with futexes) */
+    if ((key = ftok (".", 'b')) == -1) {
+        perror ("error on generating the key");
+        exit (EXIT_FAILURE);
+    }
+    if ((semgid = semCreate (key, 3)) == -1) {
+        perror ("error on creating the semaphore set");
+        exit (EXIT_FAILURE);
+    }
+
+    /* up and down of the same semaphore, timed in batches */
+    samplesInit (&upDown, "sem_updown", "ns", nIter / BATCH + 1);
+    for (i = 0; i < nIter / BATCH; i++) {
+        t = now ();
+        for (b = 0; b < BATCH; b++) {
+            if ((semUp (semgid, 1) == -1) || (semDown (semgid, 1) == -1)) {
+                perror ("error on the up and down operations");
+                exit (EXIT_FAILURE);
+            }
+        }
+        upDown.val[upDown.n++] = (double) (now () - t) / BATCH;
+    }
+    report (&upDown);
+
+    /* round trips between two processes (the child inherits the connection to the set) */
+    samplesInit (&pingPong, "sem_pingpong", "ns", nIter);
+    fflush (stdout);
+    if ((pid = fork ()) < 0) {
+        perror ("error on the fork operation");
+        exit (EXIT_FAILURE);
+    }
+    if (pid == 0) {
+        for (i = 0; i < nIter; i++) {
+            if ((semDown (semgid, 2) == -1) || (semUp (semgid, 3) == -1)) {
+                _exit (EXIT_FAILURE);
+            }
+        }
+        _exit (EXIT_SUCCESS);
+    }
+    for (i = 0; i < nIter; i++) {
+        t = now ();
+        if ((semUp (semgid, 2) == -1) || (semDown (semgid, 3) == -1)) {
+            perror ("error on the round trip operations");
+            exit (EXIT_FAILURE);
+        }
+        pingPong.val[pingPong.n++] = (double) (now () - t);
+    }
+    waitpid (pid, NULL, 0);
+    report (&pingPong);
+    semDestroy (semgid);
+
+    /* mapping and unmapping of a shared memory block */
+    if ((shmid = shmemCreate (IPC_PRIVATE, 4096)) == -1) {
+        perror ("error on creating the shared memory region");
+        exit (EXIT_FAILURE);
+    }
+    samplesInit (&attach, "shmem_attach", "ns", nIter);
+    for (i = 0; i < nIter; i++) {
+        t = now ();
+        if ((shmemAttach (shmid, &add) == -1) || (shmemDettach (add) == -1)) {
+            perror ("error on mapping the shared region");
+            exit (EXIT_FAILURE);
+        }
+        attach.val[attach.n++] = (double) (now () - t);
+    }
+    report (&attach);
+    shmemDestroy (shmid);
+}
+
+/**
+ *  \brief One run of a point of the sweep.
+ *
+ *  \param argv generator parameters
+ *  \param throughput storage for the throughput
+ *  \param formation storage for the formation latencies of the participants
+ *  \param ctxsw storage for the context switches per match
+ *  \param maxrss storage for the largest peak RSS so far
+ *
+ *  \return true if the run produced a complete trace
+ */
+static bool sweepOnce (char *argv[], SAMPLES *throughput, SAMPLES *formation, SAMPLES *ctxsw, double *maxrss)
+{
+    struct rusage ru;
+    FILE *fic;
+    TRACE_HDR hdr;
+    TRACE_REC rec;
+    char *st;                                                                                /* state of every column */
+    uint64_t *tJoin;                                                             /* times of joining a team (or none) */
+    uint64_t tFirst = 0, tEnd = 0;
+    bool first = true;
+    unsigned int c, nCol, nMembers, nEnded = 0;
+
+    if (!generate (argv, &ru) || ((fic = traceOpen (&hdr, &st)) == NULL)) {
+        return false;
+    }
+    nCol = hdr.nPlayers + hdr.nGoalies + hdr.nReferees;
+    nMembers = hdr.nPlayers + hdr.nGoalies;
+    if ((tJoin = malloc (nMembers * sizeof (uint64_t))) == NULL) {
+        perror ("error on allocating the trace buffers");
+        exit (EXIT_FAILURE);
+    }
+    memset (tJoin, 0xff, nMembers * sizeof (uint64_t));
+    while (fread (&rec, sizeof (rec), 1, fic) == 1) {
+        if ((c = TRACE_COL(&rec)) >= nCol) {
+            break;
+        }
+        st[c] = TRACE_STATE(&rec);
+        if (first) {
+            tFirst = rec.tstamp;
+            first = false;
+        }
+        if (c >= nMembers) {                                                                               /* referee */
+            if (st[c] == ENDING_GAME) {
+                tEnd = rec.tstamp;
+                nEnded++;
+            }
+        }
+        else if (((st[c] == WAITING_TEAM) || (st[c] == FORMING_TEAM)) && (tJoin[c] == UINT64_MAX)) {
+            tJoin[c] = rec.tstamp;
+        }
+        else if (((st[c] == WAITING_START_1) || (st[c] == WAITING_START_2)) && (tJoin[c] != UINT64_MAX)) {
+            formation->val[formation->n++] = (double) (rec.tstamp - tJoin[c]);
+        }
+    }
+    fclose (fic);
+    free (st);
+    free (tJoin);
+    if ((nEnded == 0) || (tEnd <= tFirst)) {
+        return false;
+    }
+
+    throughput->val[throughput->n++] = nEnded * 1e6 / (tEnd - tFirst);
+    ctxsw->val[ctxsw->n++] = (double) (ru.ru_nvcsw + ru.ru_nivcsw) / nEnded;
+    *maxrss = (ru.ru_maxrss > *maxrss) ? ru.ru_maxrss : *maxrss;
+    return true;
+}
+
+/**
+ *  \brief Parsing of a comma separated list of positive numbers.
+ *
+ *  \param arg list
+ *  \param val storage for the numbers (MAXLIST at most)
+ *
+ *  \return the number of numbers, or 0 if the list is not valid
+ */
+static unsigned int parseList (char *arg, unsigned int val[])
+{
+    unsigned int n = 0;
+    char *end;
+    long v;
+
+    do {
+        v = strtol (arg, &end, 10);
+        if ((end == arg) || (v <= 0) || (v > INT32_MAX) || (n == MAXLIST) || ((*end != ',') && (*end != '\0'))) {
+            return 0;
+        }
+        val[n++] = (unsigned int) v;
+        arg = end + 1;
+    } while (*end == ',');
+    return n;
+}
+
+/**
+ *  \brief Scaling sweep: runs of the generator over a grid of configurations.
+ *
+ *  \param nRuns number of runs of each point
+ *  \param engineList comma separated engine names
+ *  \param matches numbers of matches
+ *  \param nM number of numbers of matches
+ *  \param teamPlayers numbers of players per team
+ *  \param nP number of numbers of players per team
+ *  \param referees numbers of referees
+ *  \param nR number of numbers of referees
+ *  \param nArgs number of additional parameters to pass on to the generator
+ *  \param args additional parameters to pass on to the generator
+ *
+ *  \return true if every engine named is known
+ */
+static bool benchSweep (unsigned int nRuns, char *engineList, unsigned int matches[], unsigned int nM,
+                        unsigned int teamPlayers[], unsigned int nP, unsigned int referees[], unsigned int nR,
+                        int nArgs, char *args[])
+{
+    char *argv[MAXARGS + 20];
+    char nums[5][16], workers[16], seed[16], *list, *name, *save;
+    const ENGINE *eng;
+    SAMPLES throughput, formation, ctxsw;
+    unsigned int e, m, p, r, k, nEntities;
+    double maxrss;
+    int a, n;
+
+    snprintf (workers, sizeof (workers), "%ld", sysconf (_SC_NPROCESSORS_ONLN));
+    if ((list = strdup (engineList)) == NULL) {
+        perror ("error on allocating the engine list");
+        exit (EXIT_FAILURE);
+    }
+    for (name = strtok_r (list, ",", &save); name != NULL; name = strtok_r (NULL, ",", &save)) {
+        for (e = 0; (e < sizeof (engines) / sizeof (engines[0])) && (strcmp (name, engines[e].name) != 0); e++);
+        if (e == sizeof (engines) / sizeof (engines[0])) {
+            free (list);
+            return false;
+        }
+        eng = &engines[e];
+        if (eng->futex && (strcmp (SEM_BACKEND, "futex") != 0)) {
+            fprintf (stderr, "%s left out: futex semaphores only\n", eng->name);
+            continue;
+        }
+        for (m = 0; m < nM; m++) {
+            for (p = 0; p < nP; p++) {
+                for (r = 0; r < nR; r++) {
+                    nEntities = 2 * matches[m] * (teamPlayers[p] + 1) + referees[r];
+                    if (nEntities > eng->maxEntities) {
+                        fprintf (stderr, "%s/M%u/P%u/R%u left out: %u entities\n", eng->name, matches[m],
+                                 teamPlayers[p], referees[r], nEntities);
+                        continue;
+                    }
+                    n = 0;
+                    argv[n++] = GENERATOR;
+                    argv[n++] = "-b";
+                    if (eng->opt != NULL) {
+                        argv[n++] = eng->opt;
+                        if (strcmp (eng->opt, "-F") == 0) {
+                            argv[n++] = workers;
+                        }
+                    }
+                    snprintf (nums[0], sizeof (nums[0]), "%u", 2 * matches[m] * teamPlayers[p]);
+                    snprintf (nums[1], sizeof (nums[1]), "%u", 2 * matches[m]);
+                    snprintf (nums[2], sizeof (nums[2]), "%u", teamPlayers[p]);
+                    snprintf (nums[3], sizeof (nums[3]), "%u", referees[r]);
+                    snprintf (nums[4], sizeof (nums[4]), "%u", matches[m]);
+                    for (k = 0; k < 5; k++) {
+                        argv[n++] = pointOpts[k];
+                        argv[n++] = nums[k];
+                    }
+                    argv[n++] = "-G";
+                    argv[n++] = "1";
+                    argv[n++] = "-x";
+                    argv[n++] = seed;
+                    for (a = 0; (a < nArgs) && (a < MAXARGS); a++) {
+                        argv[n++] = args[a];
+                    }
+                    argv[n++] = TRACE_FILE;
+                    argv[n] = NULL;
+
+                    samplesInit (&throughput, "throughput", "matches/s", nRuns);
+                    samplesInit (&formation, "formation", "us", nRuns * (nEntities - referees[r]));
+                    samplesInit (&ctxsw, "ctxsw", "1/match", nRuns);
+                    maxrss = 0.0;
+                    for (k = 0; k < nRuns; k++) {
+                        snprintf (seed, sizeof (seed), "%u", k + 1);
+                        sweepOnce (argv, &throughput, &formation, &ctxsw, &maxrss);
+                    }
+                    qsort (throughput.val, throughput.n, sizeof (double), cmpDouble);
+                    qsort (formation.val, formation.n, sizeof (double), cmpDouble);
+                    qsort (ctxsw.val, ctxsw.n, sizeof (double), cmpDouble);
+                    printf ("%s/M%u/P%u/R%u\t%s\t%u\t%.3f\t%.3f\t%.0f\t%.3f\n", eng->name, matches[m], teamPlayers[p],
+                            referees[r], SEM_BACKEND, throughput.n, quantile (&throughput, 0.5),
+                            quantile (&formation, 0.99), maxrss, quantile (&ctxsw, 0.5));
+                    free (throughput.val);
+                    free (formation.val);
+                    free (ctxsw.val);
+                }
+            }
+        }
+    }
+    unlink (TRACE_FILE);
+    free (list);
+    return true;
+}
+
+/**
+ *  \brief Reading of the points of a sweep.
+ *
+ *  \param fic file the sweep is read from
+ *  \param pt storage for the points (MAXPOINTS at most)
+ *
+ *  \return the number of points
+ */
+static unsigned int readSweep (FILE *fic, POINT pt[])
+{
+    char line[256];
+    unsigned int n = 0;
+
+    while ((n < MAXPOINTS) && (fgets (line, sizeof (line), fic) != NULL)) {
+        if ((line[0] != '#') &&
+            (sscanf (line, "%63s %15s %u %lf %lf %lf %lf", pt[n].name, pt[n].backend, &pt[n].runs, &pt[n].val[0],
+                     &pt[n].val[1], &pt[n].val[2], &pt[n].val[3]) == 7)) {
+            n++;
+        }
+    }
+    return n;
+}
+
+/**
+ *  \brief Check of the sweep read from the standard input against a baseline.
+ *
+ *  \param baseline baseline file name
+ *  \param tol tolerance, as a fraction of the baseline measures
+ *
+ *  \return the number of regressions, or -1 if the baseline cannot be read
+ */
+static int checkSweep (char *baseline, double tol)
+{
+    static POINT base[MAXPOINTS], cur[MAXPOINTS];
+    FILE *fic;
+    unsigned int nBase, nCur, b, c, k, nChecked = 0;
+    int nReg = 0;
+    bool worse;
+
+    if ((fic = fopen (baseline, "r")) == NULL) {
+        return -1;
+    }
+    nBase = readSweep (fic, base);
+    fclose (fic);
+    nCur = readSweep (stdin, cur);
+
+    for (c = 0; c < nCur; c++) {
+        for (b = 0; (b < nBase) && ((strcmp (cur[c].name, base[b].name) != 0) ||
+                                    (strcmp (cur[c].backend, base[b].backend) != 0)); b++);
+        if ((b == nBase) || (base[b].runs == 0)) {
+            continue;                                                                   /* nothing to compare it with */
+        }
+        nChecked++;
+        if (cur[c].runs == 0) {
+            printf ("%s\t%s\tno complete run\n", cur[c].name, cur[c].backend);
+            nReg++;
+            continue;
+        }
+        for (k = 0; k < 4; k++) {
+            worse = (k == 0) ? (cur[c].val[k] < base[b].val[k] * (1.0 - tol)) :
+                               (cur[c].val[k] > base[b].val[k] * (1.0 + tol));
+            if (worse) {
+                printf ("%s\t%s\t%s\t%.3f\tbaseline %.3f\n", cur[c].name, cur[c].backend, measures[k], cur[c].val[k],
+                        base[b].val[k]);
+                nReg++;
+            }
+        }
+    }
+    fprintf (stderr, "%d regressions in %u points checked (tolerance %.0f%%)\n", nReg, nChecked, tol * 100);
+    return nReg;
+}
+
+/**
+ *  \brief Main program.
+ *
+ *  Its role is to run the benchmarks that were asked for and to write their results.
+ */
+int main (int argc, char *argv[])
+{
+    unsigned int nRuns = 100, nIter = 100000;
+    bool runs = true, primitives = true, sweep = false;
+    unsigned int matches[MAXLIST] = { 1, 4, 16 }, teamPlayers[MAXLIST] = { 4, 16 }, referees[MAXLIST] = { 1, 4 };
+    unsigned int nM = 3, nP = 2, nR = 2;
+    char *engineList = SWEEP_ENGINES, *baseline = NULL;
+    double tol = 0.25;
+    int opt, nReg;
+
+    while ((opt = getopt (argc, argv, "n:k:emwM:P:R:E:c:t:")) != -1) {
+        switch (opt) {
+            case 'n': nRuns = (unsigned int) atoi (optarg);
+                      break;
+            case 'k': nIter = (unsigned int) atoi (optarg);
+                      break;
+            case 'e': primitives = false;
+                      break;
+            case 'm': runs = false;
+                      break;
+            case 'w': sweep = true;
+                      break;
+            case 'M': nM = parseList (optarg, matches);
+                      break;
+            case 'P': nP = parseList (optarg, teamPlayers);
+                      break;
+            case 'R': nR = parseList (optarg, referees);
+                      break;
+            case 'E': engineList = optarg;
+                      break;
+            case 'c': baseline = optarg;
+                      break;
+            case 't': tol = atof (optarg) / 100;
+                      break;
+            default:  fprintf (stderr, USAGE, argv[0]);
+                      return EXIT_FAILURE;
+        }
+    }
+    if ((nRuns == 0) || (nIter < BATCH) || (nM == 0) || (nP == 0) || (nR == 0) || (tol < 0)) {
+        fprintf (stderr, USAGE, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (baseline != NULL) {
+        if ((nReg = checkSweep (baseline, tol)) == -1) {
+            perror ("error on reading the baseline");
+            return EXIT_FAILURE;
+        }
+        return (nReg == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (sweep) {
+        printf ("# point\tbackend\truns\t%s\t%s\t%s\t%s\n", measures[0], measures[1], measures[2], measures[3]);
+        if (!benchSweep (nRuns, engineList, matches, nM, teamPlayers, nP, referees, nR, argc - optind, argv + optind)) {
+            fprintf (stderr, "The engines are proc, thread and fiber\n");
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    printf ("# name\tbackend\tunit\tn\tmin\tp50\tp99\tmax\n");
+    if (runs) {
+        benchRuns (nRuns, argc - optind, argv + optind);
+    }
+    if (primitives) {
+        benchPrimitives (nIter);
+    }
+    return EXIT_SUCCESS;
+}
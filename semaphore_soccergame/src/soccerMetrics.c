@@ -0,0 +1,453 @@
+/**
+ *  \file soccerMetrics.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Metrics exporter of a run in progress: it attaches to the shared region of the run started in the same directory
+ *  and exports its counters in the Prometheus text format (version 0.0.4): matches started and ended, teams formed,
+ *  late players and goalies, bytes written to the log, state changes, the number of entities in each state and,
+ *  if the run was started with option -s, the operations on each semaphore with the histograms of their wait and
+ *  (for the locks) hold times.
+ *  The counters are cumulative over the rounds of a server run. The full state is read through its sequence lock:
+ *  nothing is written to the shared region.
+ *
+ *  Upon execution, the following parameters are accepted:
+ *    \li -i n: export every n ms, until the run is over (by default, export once)
+ *    \li -k key: creation key of the run (by default, the one of shmemKey): with POSIX shared memory, each run
+ *        has a key of its own, which is the process id of its generator
+ *    \li -o file: the metrics are written to a file, replaced at once on every export (for a textfile collector),
+ *        instead of to the standard output
+ *    \li -l port: the metrics are served over HTTP on a TCP port (any request is answered with them), until the
+ *        run is over; if -o is also given, the file is written as well, every -i ms.
+ *
+ *  Only multi-process runs may be exported, as the in-process engines keep their data private.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "sharedDataSync.h"
+#include "sharedMemory.h"
+#include "statSeqlock.h"
+
+/** \brief command line usage */
+#define   USAGE                "Usage: %s [-i interval] [-k key] [-o file] [-l port]\n"
+
+/** \brief period of the checking for the end of the run, while serving (in ms) */
+#define   SERVE_PERIOD         1000
+
+/** \brief largest request read from a client; the rest is ignored */
+#define   REQUEST_MAX          4096
+
+/** \brief time a client is given to send its request (in s) */
+#define   REQUEST_TIMEOUT      1
+
+/**
+ *  \brief Exporting a metric with a single value and no labels.
+ *
+ *  \param fic output stream
+ *  \param name name of the metric
+ *  \param type type of the metric (counter or gauge)
+ *  \param help description of the metric
+ *  \param value present value
+ */
+static void metric (FILE *fic, const char *name, const char *type, const char *help, uint64_t value)
+{
+    fprintf (fic, "# HELP %s %s\n# TYPE %s %s\n%s %llu\n", name, help, name, type, name, (unsigned long long) value);
+}
+
+/**
+ *  \brief Exporting the number of entities of one kind in each state.
+ *
+ *  \param fic output stream
+ *  \param kind name of the kind of entity
+ *  \param st state of the entities of that kind
+ *  \param n number of entities of that kind
+ */
+static void printStates (FILE *fic, const char *kind, uint8_t st[], int n)
+{
+    unsigned int count[256] = { 0 };
+    int i;
+
+    for (i = 0; i < n; i++) {
+        count[st[i]]++;
+    }
+    for (i = 0; i < 256; i++) {
+        if (count[i] != 0) {
+            fprintf (fic, "soccergame_entities{kind=\"%s\",state=\"%c\"} %u\n", kind, (char) i, count[i]);
+        }
+    }
+}
+
+/**
+ *  \brief Exporting one series of a histogram of times.
+ *
+ *  Bucket k of the counters holds the times in [2^k, 2^(k+1)) ns, and the last one also the longer ones; the
+ *  buckets are exported cumulative, with their upper bounds in seconds.
+ *
+ *  \param fic output stream
+ *  \param name name of the histogram
+ *  \param sem name of the semaphore
+ *  \param hist histogram
+ *  \param sumNs total of the times (in ns)
+ */
+static void printHist (FILE *fic, const char *name, const char *sem, _Atomic uint64_t hist[], uint64_t sumNs)
+{
+    uint64_t count = 0;
+    int k;
+
+    for (k = 0; k < SEMSTATS_HIST; k++) {
+        count += atomic_load_explicit (&hist[k], memory_order_relaxed);
+        if (k < SEMSTATS_HIST - 1) {
+            fprintf (fic, "%s_bucket{sem=\"%s\",le=\"%g\"} %llu\n", name, sem, (double) (2ull << k) * 1e-9,
+                     (unsigned long long) count);
+        }
+    }
+    fprintf (fic, "%s_bucket{sem=\"%s\",le=\"+Inf\"} %llu\n", name, sem, (unsigned long long) count);
+    fprintf (fic, "%s_sum{sem=\"%s\"} %.9f\n", name, sem, (double) sumNs * 1e-9);
+    fprintf (fic, "%s_count{sem=\"%s\"} %llu\n", name, sem, (unsigned long long) count);
+}
+
+/**
+ *  \brief Exporting the semaphore counters, one series per semaphore identification.
+ *
+ *  \param fic output stream
+ *  \param st pointer to the counters block
+ */
+static void printSemStats (FILE *fic, SEM_STATS *st)
+{
+    const char *semNames[] = SEM_NAMES;
+    const char *ops[] = { "downs", "ups", "contended" };
+    const char *help[] = { "Down operations on a semaphore.", "Up operations on a semaphore.",
+                           "Down operations on a semaphore that had to block." };
+    SEM_COUNTERS *c;
+    unsigned int s, o;
+
+    for (o = 0; o < 3; o++) {
+        fprintf (fic, "# HELP soccergame_sem_%s_total %s\n# TYPE soccergame_sem_%s_total counter\n", ops[o], help[o],
+                 ops[o]);
+        for (s = 1; s < st->nSlots; s++) {
+            c = &st->slot[s];
+            fprintf (fic, "soccergame_sem_%s_total{sem=\"%s\"} %llu\n", ops[o], semNames[s], (unsigned long long)
+                     atomic_load_explicit ((o == 0) ? &c->downs : (o == 1) ? &c->ups : &c->contended,
+                                           memory_order_relaxed));
+        }
+    }
+    fprintf (fic, "# HELP soccergame_sem_wait_seconds Time spent in the down operations on a semaphore.\n"
+                  "# TYPE soccergame_sem_wait_seconds histogram\n");
+    for (s = 1; s < st->nSlots; s++) {
+        c = &st->slot[s];
+        printHist (fic, "soccergame_sem_wait_seconds", semNames[s], c->waitHist,
+                   atomic_load_explicit (&c->waitNs, memory_order_relaxed));
+    }
+    fprintf (fic, "# HELP soccergame_sem_hold_seconds Time a semaphore used as a lock was held.\n"
+                  "# TYPE soccergame_sem_hold_seconds histogram\n");
+    for (s = 1; s < st->nSlots; s++) {
+        if (st->lockMask & (1u << s)) {
+            c = &st->slot[s];
+            printHist (fic, "soccergame_sem_hold_seconds", semNames[s], c->holdHist,
+                       atomic_load_explicit (&c->holdNs, memory_order_relaxed));
+        }
+    }
+}
+
+/**
+ *  \brief Exporting the present metrics of the run.
+ *
+ *  The full state is read through its sequence lock, so the run is never slowed down by taking the mutex.
+ *
+ *  \param fic output stream
+ *  \param sh pointer to the shared region
+ *  \param fSt pointer to the location where the snapshot of the full state is stored
+ */
+static void printMetrics (FILE *fic, SHARED_DATA *sh, FULL_STAT *fSt)
+{
+    uint64_t started, ended;
+
+    ended = atomic_load_explicit (&sh->metrics.matchesEnded, memory_order_acquire);   /* first, not to exceed started */
+    started = atomic_load_explicit (&sh->metrics.matchesStarted, memory_order_relaxed);
+    statSnapshot (&sh->fSt, fSt);
+    metric (fic, "soccergame_matches_started_total", "counter", "Matches started by a referee.", started);
+    metric (fic, "soccergame_matches_ended_total", "counter", "Matches ended by a referee.", ended);
+    metric (fic, "soccergame_teams_formed_total", "counter", "Teams formed.",
+            atomic_load_explicit (&sh->metrics.teamsFormed, memory_order_relaxed));
+    fprintf (fic, "# HELP soccergame_late_total Players and goalies that were late.\n"
+                  "# TYPE soccergame_late_total counter\n"
+                  "soccergame_late_total{role=\"player\"} %llu\nsoccergame_late_total{role=\"goalie\"} %llu\n",
+             (unsigned long long) atomic_load_explicit (&sh->metrics.playersLate, memory_order_relaxed),
+             (unsigned long long) atomic_load_explicit (&sh->metrics.goaliesLate, memory_order_relaxed));
+    metric (fic, "soccergame_log_bytes_total", "counter", "Bytes written to the logging file.",
+            atomic_load_explicit (&sh->logRing.written, memory_order_relaxed));
+    metric (fic, "soccergame_state_changes_total", "counter", "Changes of the full state.", fSt->seq / 2);
+
+    metric (fic, "soccergame_players", "gauge", "Total number of players.", (uint64_t) fSt->nPlayers);
+    metric (fic, "soccergame_goalies", "gauge", "Total number of goalies.", (uint64_t) fSt->nGoalies);
+    metric (fic, "soccergame_referees", "gauge", "Number of referees.", (uint64_t) fSt->nReferees);
+    metric (fic, "soccergame_matches", "gauge", "Number of matches (of each round).", (uint64_t) fSt->nMatches);
+    metric (fic, "soccergame_players_free", "gauge", "Players in a team not formed yet.",
+            (uint64_t) fSt->playersFree);
+    metric (fic, "soccergame_goalies_free", "gauge", "Goalies in a team not formed yet.",
+            (uint64_t) fSt->goaliesFree);
+    fprintf (fic, "# HELP soccergame_entities Entities of each kind in each state.\n"
+                  "# TYPE soccergame_entities gauge\n");
+    printStates (fic, "player", &PLAYER_STAT(fSt, 0), fSt->nPlayers);
+    printStates (fic, "goalie", &GOALIE_STAT(fSt, 0), fSt->nGoalies);
+    printStates (fic, "referee", &REFEREE_STAT(fSt, 0), fSt->nReferees);
+
+    if (sh->semStats.enabled) {
+        printSemStats (fic, &sh->semStats);
+    }
+}
+
+/**
+ *  \brief Writing the present metrics of the run to a file.
+ *
+ *  They are written to a temporary file first, which then replaces the file, so that a reader never gets a partial
+ *  export.
+ *
+ *  \param name name of the file
+ *  \param sh pointer to the shared region
+ *  \param fSt pointer to the location where the snapshot of the full state is stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+static int dumpMetrics (const char *name, SHARED_DATA *sh, FULL_STAT *fSt)
+{
+    char tmp[4096];                                                                     /* name of the temporary file */
+    FILE *fic;
+
+    if (snprintf (tmp, sizeof (tmp), "%s.tmp", name) >= (int) sizeof (tmp)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    if ((fic = fopen (tmp, "w")) == NULL) {
+        return -1;
+    }
+    printMetrics (fic, sh, fSt);
+    if (fclose (fic) == EOF) {
+        unlink (tmp);
+        return -1;
+    }
+    return rename (tmp, name);
+}
+
+/**
+ *  \brief Answering a client with the present metrics of the run.
+ *
+ *  The request is read (and ignored) and the metrics are sent as an HTTP/1.0 response, after which the connection
+ *  is closed.
+ *
+ *  \param fd socket connected to the client
+ *  \param sh pointer to the shared region
+ *  \param fSt pointer to the location where the snapshot of the full state is stored
+ */
+static void answer (int fd, SHARED_DATA *sh, FULL_STAT *fSt)
+{
+    struct timeval tmo = { REQUEST_TIMEOUT, 0 };
+    char req[REQUEST_MAX + 1];
+    size_t len = 0, bodyLen, off;
+    ssize_t n;
+    char *body = NULL, *reply;
+    FILE *fic;
+
+    setsockopt (fd, SOL_SOCKET, SO_RCVTIMEO, &tmo, sizeof (tmo));
+    while ((len < REQUEST_MAX) && ((n = recv (fd, req + len, REQUEST_MAX - len, 0)) > 0)) {     /* up to a blank line */
+        len += (size_t) n;
+        req[len] = '\0';
+        if (strstr (req, "\r\n\r\n") != NULL) {
+            break;
+        }
+    }
+
+    if ((fic = open_memstream (&body, &bodyLen)) == NULL) {
+        perror ("error on building the metrics");
+        return;
+    }
+    printMetrics (fic, sh, fSt);
+    fclose (fic);
+    if (asprintf (&reply, "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\n"
+                          "Connection: close\r\n\r\n%s", bodyLen, body) == -1) {
+        perror ("error on building the metrics");
+        free (body);
+        return;
+    }
+    len = strlen (reply);
+    for (off = 0; off < len; off += (size_t) n) {
+        if ((n = send (fd, reply + off, len - off, MSG_NOSIGNAL)) == -1) {
+            if (errno == EINTR) {
+                n = 0;
+                continue;
+            }
+            break;                                                                            /* the client went away */
+        }
+    }
+    free (reply);
+    free (body);
+}
+
+/**
+ *  \brief Present time.
+ *
+ *  \return CLOCK_MONOTONIC time (in ms)
+ */
+static uint64_t nowMs (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000ull + (uint64_t) ts.tv_nsec / 1000000ull;
+}
+
+/**
+ *  \brief Serving the metrics of the run over HTTP, until it is over.
+ *
+ *  \param port TCP port
+ *  \param key creation key of the run
+ *  \param outFile name of the file the metrics are also written to, every interval ms (NULL, if none)
+ *  \param interval writing interval of the file (in ms)
+ *  \param sh pointer to the shared region
+ *  \param fSt pointer to the location where the snapshot of the full state is stored
+ */
+static void serve (int port, int key, const char *outFile, int interval, SHARED_DATA *sh, FULL_STAT *fSt)
+{
+    struct sockaddr_in addr;
+    struct pollfd pfd;
+    int fd, client, one = 1;
+    uint64_t nextDump = 0;
+
+    if ((fd = socket (AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0)) == -1) {
+        perror ("error on creating the server socket");
+        exit (EXIT_FAILURE);
+    }
+    setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof (one));
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl (INADDR_ANY);
+    addr.sin_port = htons ((uint16_t) port);
+    if ((bind (fd, (struct sockaddr *) &addr, sizeof (addr)) == -1) || (listen (fd, SOMAXCONN) == -1)) {
+        perror ("error on binding the server socket");
+        exit (EXIT_FAILURE);
+    }
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    while (shmemConnect (key) != -1) {                                                       /* until the run is over */
+        if ((outFile != NULL) && (nowMs () >= nextDump)) {
+            if (dumpMetrics (outFile, sh, fSt) == -1) {
+                perror ("error on writing the metrics file");
+                exit (EXIT_FAILURE);
+            }
+            nextDump = nowMs () + (uint64_t) interval;
+        }
+        if (poll (&pfd, 1, ((outFile != NULL) && (interval < SERVE_PERIOD)) ? interval : SERVE_PERIOD) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror ("error on waiting for a client");
+            exit (EXIT_FAILURE);
+        }
+        if ((pfd.revents & POLLIN) && ((client = accept4 (fd, NULL, NULL, SOCK_CLOEXEC)) != -1)) {
+            answer (client, sh, fSt);
+            close (client);
+        }
+    }
+    close (fd);
+}
+
+/**
+ *  \brief Main program.
+ *
+ *  Its role is to attach to the shared region of a run in progress and to export its metrics.
+ */
+int main (int argc, char *argv[])
+{
+    int key = -1, shmid, opt;
+    int interval = 0;                                                                   /* exporting interval (in ms) */
+    int port = 0;                                                                      /* TCP port of the server (-l) */
+    char *outFile = NULL;                                                            /* name of the metrics file (-o) */
+    SHARED_DATA *sh;
+    FULL_STAT *fSt;                                                                     /* snapshot of the full state */
+
+    while ((opt = getopt (argc, argv, "i:k:o:l:")) != -1) {
+        switch (opt) {
+            case 'i': interval = atoi (optarg);
+                      break;
+            case 'k': key = (int) strtol (optarg, NULL, 0);
+                      break;
+            case 'o': outFile = optarg;
+                      break;
+            case 'l': port = atoi (optarg);
+                      if ((port <= 0) || (port > 65535)) {
+                          fprintf (stderr, "%s: invalid port\n", argv[0]);
+                          return EXIT_FAILURE;
+                      }
+                      break;
+            default:  fprintf (stderr, USAGE, argv[0]);
+                      return EXIT_FAILURE;
+        }
+    }
+    if ((port > 0) && (outFile != NULL) && (interval <= 0)) {
+        interval = SERVE_PERIOD;
+    }
+
+    if ((key == -1) && ((key = shmemKey (false)) == -1)) {
+        perror ("error on generating the key");
+        return EXIT_FAILURE;
+    }
+    if ((shmid = shmemConnect (key)) == -1) {
+        perror ("error on connecting to the shared memory region (is a run in progress?)");
+        return EXIT_FAILURE;
+    }
+    if (shmemAttach (shmid, (void **) &sh) == -1) {
+        perror ("error on mapping the shared region on the process address space");
+        return EXIT_FAILURE;
+    }
+
+    if ((fSt = aligned_alloc (CACHE_LINE, FULL_STAT_SIZE(NUM_COLS(&sh->fSt)))) == NULL) {
+        perror ("error on allocating the snapshot");
+        return EXIT_FAILURE;
+    }
+
+    if (port > 0) {
+        serve (port, key, outFile, interval, sh, fSt);
+    }
+    else {
+        do {
+            if (outFile == NULL) {
+                printMetrics (stdout, sh, fSt);
+                fflush (stdout);
+            }
+            else if (dumpMetrics (outFile, sh, fSt) == -1) {
+                perror ("error on writing the metrics file");
+                return EXIT_FAILURE;
+            }
+            if (interval <= 0) {
+                break;
+            }
+            usleep (1000 * interval);
+        } while (shmemConnect (key) != -1);                                                        /* the run is over */
+    }
+
+    free (fSt);
+    shmemDettach (sh);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,62 @@
+/**
+ *  \file statSeqlock.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Sequence lock on the full state of the problem.
+ *
+ *  Defined operations:
+ *     \li marking the start and the end of a change of the full state (writers, inside the critical region)
+ *     \li changing the state of one entity (its own writer, anywhere)
+ *     \li taking a consistent snapshot of the full state (observers, anywhere).
+ *
+ *  The fences pair the plain accesses to the full state with the sequence number: a writer makes it odd before
+ *  its first store, an observer checks it is unchanged (and even) after its last load. The sequence number is only
+ *  changed by atomic additions, as the entities changing their own state do it out of the critical region.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#include <string.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+#include "probDataStruct.h"
+#include "statSeqlock.h"
+
+void statWriteBegin (FULL_STAT *p_fSt)
+{
+    atomic_fetch_add_explicit (&p_fSt->seq, 1, memory_order_relaxed);
+    atomic_thread_fence (memory_order_release);
+}
+
+void statWriteEnd (FULL_STAT *p_fSt)
+{
+    atomic_fetch_add_explicit (&p_fSt->seq, 1, memory_order_release);
+}
+
+void statWriteOwn (FULL_STAT *p_fSt, unsigned int col, char state)
+{
+    atomic_store_explicit ((_Atomic uint8_t *) &p_fSt->st[col], (uint8_t) state, memory_order_relaxed);
+    atomic_fetch_add_explicit (&p_fSt->seq, 2, memory_order_release);
+}
+
+unsigned int statSnapshot (FULL_STAT *p_fSt, FULL_STAT *snap)
+{
+    unsigned int s0, s1;                                                                     /* sequence numbers read */
+    unsigned int retries = 0;                                                                     /* copies discarded */
+
+    while (true) {
+        while ((s0 = atomic_load_explicit (&p_fSt->seq, memory_order_acquire)) & 1) {
+            sched_yield ();                                                                     /* change in progress */
+        }
+        memcpy (snap, p_fSt, FULL_STAT_SIZE(NUM_COLS(p_fSt)));
+        atomic_thread_fence (memory_order_acquire);
+        s1 = atomic_load_explicit (&p_fSt->seq, memory_order_relaxed);
+        if (s0 == s1) {
+            break;
+        }
+        retries++;
+    }
+    return retries;
+}
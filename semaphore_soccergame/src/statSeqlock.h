@@ -0,0 +1,69 @@
+/**
+ *  \file statSeqlock.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Sequence lock on the full state of the problem.
+ *
+ *  The entities change the full state inside the critical region, so there is a single writer of the shared
+ *  counters at a time; they also mark the region with the sequence number of the full state, which observers
+ *  (monitors, the inspector) read to take consistent snapshots without ever taking the mutex or writing to shared
+ *  memory. A change that only concerns the state of the entity making it may also be done out of the critical
+ *  region, with a single store: the sequence number moves on by two, so it keeps its parity and every copy that
+ *  overlaps the store is discarded.
+ *  Defined operations:
+ *     \li marking the start and the end of a change of the full state (writers, inside the critical region)
+ *     \li changing the state of one entity (its own writer, anywhere)
+ *     \li taking a consistent snapshot of the full state (observers, anywhere).
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#ifndef STATSEQLOCK_H_
+#define STATSEQLOCK_H_
+
+#include "probDataStruct.h"
+
+/**
+ *  \brief Marking the start of a change of the full state.
+ *
+ *  To be called right after entering the critical region: the sequence number becomes odd.
+ *
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ */
+extern void statWriteBegin (FULL_STAT *p_fSt);
+
+/**
+ *  \brief Marking the end of a change of the full state.
+ *
+ *  To be called right before leaving the critical region: the sequence number becomes even again.
+ *
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ */
+extern void statWriteEnd (FULL_STAT *p_fSt);
+
+/**
+ *  \brief Changing the state of one entity out of the critical region.
+ *
+ *  Only the entity itself may change its state this way, and only when no other writer depends on it.
+ *
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *  \param col log column of the entity
+ *  \param state new state
+ */
+extern void statWriteOwn (FULL_STAT *p_fSt, unsigned int col, char state);
+
+/**
+ *  \brief Taking a consistent snapshot of the full state.
+ *
+ *  The full state is copied until no change was in progress neither before nor after the copy.
+ *
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *  \param snap pointer to the location where the snapshot is stored (<tt>FULL_STAT_SIZE(NUM_COLS(p_fSt))</tt>
+ *         bytes)
+ *
+ *  \return number of copies that had to be discarded
+ */
+extern unsigned int statSnapshot (FULL_STAT *p_fSt, FULL_STAT *snap);
+
+#endif /* STATSEQLOCK_H_ */
@@ -0,0 +1,368 @@
+/**
+ *  \file stateCheck.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Online checker of the invariants of a run, fed with the state changes as they are drained from the ring buffer
+ *  (option -C of the main process) or read from a binary trace (option -k of traceDecode).
+ *
+ *  Defined operations:
+ *     \li initialization, from the configuration and the initial state of a run
+ *     \li checking a state change
+ *     \li checking the end of a run (or of a round of a server run).
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "stateCheck.h"
+
+/** \brief configuration of the run */
+static int nPlayers, nGoalies, nReferees, nTeamPlayers, nTeamGoalies, nMatches;
+
+/** \brief true if the teams are formed in the critical region (the seats follow the order of the state changes) */
+static bool seated;
+
+/** \brief present state of every log column */
+static char *st = NULL;
+
+/** \brief true for the log columns whose arrival was already recorded */
+static bool *arrived = NULL;
+
+/** \brief team of every player and goalie (0, if late or not known) */
+static int *team = NULL;
+
+/** \brief number of players, goalies and members (both) that joined each team, and whether it was formed */
+static int *teamPlayers = NULL, *teamGoalies = NULL, *teamMembers = NULL;
+static bool *teamFormed = NULL;
+
+/** \brief number of team members of each match that started playing */
+static int *matchPlaying = NULL;
+
+/** \brief number of players and goalies that joined a team or were late, of teams formed, of matches with their two
+           teams formed, of team members waiting for the start or playing, of matches started and ended, and of
+           matches whose members started playing */
+static int playersJoined, goaliesJoined, playersLate, goaliesLate, formed, paired, waiting, playing, started, ended,
+           begun;
+
+/** \brief number of state changes checked so far, by this process */
+static uint64_t changes = 0;
+
+/** \brief last state changes, for the report of a violation */
+static struct {
+    uint64_t seq;
+    unsigned int col;
+    char from, to;
+} recent[CHECK_TRACE];
+
+/* internal functions */
+
+/* name of a log column, as in the header of the log */
+static void colName (unsigned int col, char name[])
+{
+    if (col < (unsigned int) nPlayers) {
+        sprintf (name, "P%02u", col);
+    }
+    else if (col < (unsigned int) (nPlayers + nGoalies)) {
+        sprintf (name, "G%02u", col - (unsigned int) nPlayers);
+    }
+    else sprintf (name, "R%02u", col - (unsigned int) (nPlayers + nGoalies) + 1);
+}
+
+/* report of a violation, with the last state changes */
+static bool violation (const char *what)
+{
+    char name[16];                                                                          /* name of a log column */
+    uint64_t n = (changes < CHECK_TRACE) ? changes : CHECK_TRACE, i;
+
+    fprintf (stderr, "invariant violated after state change #%llu: %s\n", (unsigned long long) changes, what);
+    for (i = changes - n; i < changes; i++) {
+        colName (recent[i % CHECK_TRACE].col, name);
+        fprintf (stderr, "    #%llu %s %c -> %c\n", (unsigned long long) recent[i % CHECK_TRACE].seq + 1, name,
+                 recent[i % CHECK_TRACE].from, recent[i % CHECK_TRACE].to);
+    }
+    return false;
+}
+
+/* allocation of an array of the checker (released and allocated again on each initialization) */
+static void *checkAlloc (void *old, size_t n, size_t size)
+{
+    void *add;
+
+    free (old);
+    if ((add = calloc ((n > 0) ? n : 1, size)) == NULL) {
+        perror ("error on allocating the state checker");
+        exit (EXIT_FAILURE);
+    }
+    return add;
+}
+
+/* a player or goalie joins a team, or is late */
+static bool checkJoin (unsigned int col, char state, bool player)
+{
+    int size = nTeamPlayers + nTeamGoalies;
+    int perTeam = player ? nTeamPlayers : nTeamGoalies;
+    int seat = player ? playersJoined : goaliesJoined;
+    int t;
+
+    if (state == LATE) {
+        if (player) {
+            playersLate++;
+        }
+        else goaliesLate++;
+        if (seated && (seat < perTeam * 2 * nMatches)) {
+            return violation (player ? "a player is late with a seat left in a team"
+                                     : "a goalie is late with a seat left in a team");
+        }
+        return true;
+    }
+
+    if (player) {
+        playersJoined++;
+    }
+    else goaliesJoined++;
+    if (seat >= perTeam * 2 * nMatches) {
+        return violation (player ? "more players joined a team than there are seats"
+                                 : "more goalies joined a team than there are seats");
+    }
+    if (state == FORMING_TEAM) {
+        if (++formed > 2 * nMatches) {
+            return violation ("more than two teams formed per match");
+        }
+    }
+    if (!seated) {
+        paired = formed / 2;
+        return true;
+    }
+
+    t = team[col] = 1 + seat / perTeam;
+    teamMembers[t]++;
+    if ((player ? ++teamPlayers[t] : ++teamGoalies[t]) > perTeam) {
+        return violation (player ? "a team got more players than its size" : "a team got more goalies than its size");
+    }
+    if ((state == WAITING_TEAM) && (teamMembers[t] == size)) {
+        return violation ("the member that made its team full did not form it");
+    }
+    if (state == FORMING_TEAM) {
+        if (teamMembers[t] < size) {
+            return violation ("a team was formed before it was full");
+        }
+        teamFormed[t] = true;
+        if (teamFormed[(t % 2 == 1) ? t + 1 : t - 1]) {                                /* the other team of its match */
+            paired++;
+        }
+    }
+    return true;
+}
+
+/* a player or goalie changes state */
+static bool checkMember (unsigned int col, char from, char state, bool player)
+{
+    int size = nTeamPlayers + nTeamGoalies;
+    bool legal;
+
+    switch (state) {
+        case ARRIVING:
+            legal = (from == ARRIVING) && !arrived[col];
+            arrived[col] = true;
+            break;
+        case WAITING_TEAM:
+        case FORMING_TEAM:
+        case LATE:
+            legal = (from == ARRIVING) && arrived[col];
+            break;
+        case WAITING_START_1:
+        case WAITING_START_2:
+            legal = (from == WAITING_TEAM) || (from == FORMING_TEAM);
+            break;
+        case PLAYING_1:
+            legal = (from == WAITING_START_1);
+            break;
+        case PLAYING_2:
+            legal = (from == WAITING_START_2);
+            break;
+        default:
+            return violation (player ? "unknown state of a player" : "unknown state of a goalie");
+    }
+    if (!legal) {
+        return violation (player ? "illegal state change of a player" : "illegal state change of a goalie");
+    }
+
+    switch (state) {
+        case WAITING_TEAM:
+        case FORMING_TEAM:
+        case LATE:
+            return checkJoin (col, state, player);
+        case WAITING_START_1:
+        case WAITING_START_2:
+            if (++waiting > formed * size) {
+                return violation ("more team members waiting for the start than there are in the teams formed");
+            }
+            if (seated && !teamFormed[team[col]]) {
+                return violation ("a team member waits for the start before its team is formed");
+            }
+            if (seated && ((state == WAITING_START_1) != (team[col] % 2 == 1))) {
+                return violation ("a team member waits for the start as a member of the other team of the match");
+            }
+            return true;
+        case PLAYING_1:
+        case PLAYING_2:
+            if (++playing > started * 2 * size) {
+                return violation ("more team members playing than there are in the matches started");
+            }
+            if (seated) {
+                int m = (team[col] - 1) / 2;                                                   /* match of its team */
+
+                if (!teamFormed[2 * m + 1] || !teamFormed[2 * m + 2]) {
+                    return violation ("a team member plays before the two teams of its match are formed");
+                }
+                if ((matchPlaying[m]++ == 0) && (++begun > started)) {
+                    return violation ("the members of more matches play than there are matches started");
+                }
+                if (matchPlaying[m] > 2 * size) {
+                    return violation ("more team members play a match than there are in its two teams");
+                }
+            }
+            return true;
+    }
+    return true;
+}
+
+/* a referee changes state */
+static bool checkReferee (unsigned int col, char from, char state)
+{
+    bool legal;
+
+    switch (state) {
+        case ARRIVINGR:
+            legal = (from == ARRIVINGR) && !arrived[col];
+            arrived[col] = true;
+            break;
+        case WAITING_TEAMS:
+            legal = ((from == ARRIVINGR) && arrived[col]) || (from == ENDING_GAME);
+            break;
+        case STARTING_GAME:
+            legal = ((from == ARRIVINGR) && arrived[col]) || (from == WAITING_TEAMS) || (from == ENDING_GAME);
+            break;
+        case REFEREEING:
+            legal = (from == STARTING_GAME);
+            break;
+        case ENDING_GAME:
+            legal = (from == REFEREEING);
+            break;
+        default:
+            return violation ("unknown state of a referee");
+    }
+    if (!legal) {
+        return violation ("illegal state change of a referee");
+    }
+
+    if (state == STARTING_GAME) {
+        if (++started > nMatches) {
+            return violation ("more matches started than there are");
+        }
+        if (started > paired) {
+            return violation ("more matches started than matches with their two teams formed");
+        }
+    }
+    else if (state == ENDING_GAME) {
+        ended++;
+    }
+    return true;
+}
+
+/* external functions */
+
+void checkInit (FULL_STAT *p_fSt)
+{
+    unsigned int nCol = NUM_COLS(p_fSt);
+
+    nPlayers = p_fSt->nPlayers;
+    nGoalies = p_fSt->nGoalies;
+    nReferees = p_fSt->nReferees;
+    nTeamPlayers = p_fSt->nTeamPlayers;
+    nTeamGoalies = p_fSt->nTeamGoalies;
+    nMatches = p_fSt->nMatches;
+    seated = !p_fSt->lockFree;
+
+    st = checkAlloc (st, nCol, sizeof (char));
+    memcpy (st, p_fSt->st, nCol);
+    arrived = checkAlloc (arrived, nCol, sizeof (bool));
+    team = checkAlloc (team, nCol, sizeof (int));
+    teamPlayers = checkAlloc (teamPlayers, (size_t) (2 * nMatches + 1), sizeof (int));
+    teamGoalies = checkAlloc (teamGoalies, (size_t) (2 * nMatches + 1), sizeof (int));
+    teamMembers = checkAlloc (teamMembers, (size_t) (2 * nMatches + 1), sizeof (int));
+    teamFormed = checkAlloc (teamFormed, (size_t) (2 * nMatches + 1), sizeof (bool));
+    matchPlaying = checkAlloc (matchPlaying, (size_t) nMatches, sizeof (int));
+    playersJoined = goaliesJoined = playersLate = goaliesLate = 0;
+    formed = paired = waiting = playing = started = ended = begun = 0;
+}
+
+bool checkChange (unsigned int col, char state)
+{
+    char from;
+
+    if (col >= (unsigned int) (nPlayers + nGoalies + nReferees)) {
+        return violation ("state change of an unknown log column");
+    }
+    from = st[col];
+    st[col] = state;
+    recent[changes % CHECK_TRACE].seq = changes;
+    recent[changes % CHECK_TRACE].col = col;
+    recent[changes % CHECK_TRACE].from = from;
+    recent[changes % CHECK_TRACE].to = state;
+    changes++;
+
+    if (col < (unsigned int) nPlayers) {
+        return checkMember (col, from, state, true);
+    }
+    if (col < (unsigned int) (nPlayers + nGoalies)) {
+        return checkMember (col, from, state, false);
+    }
+    return checkReferee (col, from, state);
+}
+
+bool checkEnd (void)
+{
+    int size = nTeamPlayers + nTeamGoalies;
+    int c, t;
+
+    for (c = 0; c < nPlayers + nGoalies; c++) {
+        if ((st[c] != LATE) && (st[c] != PLAYING_1) && (st[c] != PLAYING_2)) {
+            return violation ("a player or goalie did not end playing or late");
+        }
+    }
+    for (c = nPlayers + nGoalies; c < nPlayers + nGoalies + nReferees; c++) {
+        if ((st[c] != ENDING_GAME) && (st[c] != ARRIVINGR)) {
+            return violation ("a referee did not end a match or leave with none");
+        }
+    }
+    if ((formed != 2 * nMatches) || (started != nMatches) || (ended != nMatches)) {
+        return violation ("not all the matches were played");
+    }
+    if ((playersJoined != nTeamPlayers * 2 * nMatches) || (goaliesJoined != nTeamGoalies * 2 * nMatches) ||
+        (playersJoined + playersLate != nPlayers) || (goaliesJoined + goaliesLate != nGoalies) ||
+        (playing != size * 2 * nMatches)) {
+        return violation ("the teams were not made by all the players and goalies on time");
+    }
+    if (seated) {
+        for (t = 1; t <= 2 * nMatches; t++) {
+            if (!teamFormed[t] || (teamPlayers[t] != nTeamPlayers) || (teamGoalies[t] != nTeamGoalies)) {
+                return violation ("a team was not formed with its players and goalies");
+            }
+        }
+        for (t = 0; t < nMatches; t++) {
+            if (matchPlaying[t] != 2 * size) {
+                return violation ("a match was not played by the members of its two teams");
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,70 @@
+/**
+ *  \file stateCheck.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Online checker of the invariants of a run, fed with the state changes as they are drained from the ring buffer
+ *  (option -C of the main process) or read from a binary trace (option -k of traceDecode).
+ *
+ *  Defined operations:
+ *     \li initialization, from the configuration and the initial state of a run
+ *     \li checking a state change
+ *     \li checking the end of a run (or of a round of a server run).
+ *
+ *  The invariants are kept incrementally, in constant time per state change:
+ *     \li the state changes of each entity are legal: ARRIVING, then WAITING_TEAM, FORMING_TEAM or LATE, then
+ *         WAITING_START_x and PLAYING_x, of the same team x; for the referees, ARRIVINGR, then WAITING_TEAMS,
+ *         STARTING_GAME, REFEREEING and ENDING_GAME, once per match refereed
+ *     \li no more than two teams per match are formed, and each team by the member that makes it full
+ *     \li no more matches are started than there are, nor than matches with their two teams formed (as the trace
+ *         does not tell which match a referee claimed, a start is not tied to a match)
+ *     \li at the end, every match was played: each team had its players and goalies, the others were late.
+ *
+ *  With the teams formed in the critical region, the k-th player (goalie) to join is known to take a seat of team
+ *  1 + k / players (goalies) per team, and the composition of each team, and the matches of the formed teams, are
+ *  checked as well; the lock-free matcher takes the seats out of the order of the state changes, so only the totals
+ *  are checked then (the matches with their two teams formed are taken as the pairs of teams formed).
+ *
+ *  A violation is reported on stderr, with the last state changes.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#ifndef STATECHECK_H_
+#define STATECHECK_H_
+
+#include <stdbool.h>
+
+#include "probDataStruct.h"
+
+/** \brief number of state changes reported with a violation */
+#define  CHECK_TRACE      16
+
+/**
+ *  \brief Initialization of the checker.
+ *
+ *  The configuration of the run (number of entities, team sizes, number of matches, matcher) and the present state
+ *  of the entities are taken; the counters of a previous run (or round) are cleared.
+ *
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ */
+extern void checkInit (FULL_STAT *p_fSt);
+
+/**
+ *  \brief Checking a state change.
+ *
+ *  \param col log column of the entity whose state changed
+ *  \param state new state of the entity
+ *
+ *  \return true if the invariants hold; false, if not (the violation was reported)
+ */
+extern bool checkChange (unsigned int col, char state);
+
+/**
+ *  \brief Checking the end of a run, or of a round of a server run.
+ *
+ *  \return true if the invariants hold; false, if not (the violation was reported)
+ */
+extern bool checkEnd (void);
+
+#endif /* STATECHECK_H_ */
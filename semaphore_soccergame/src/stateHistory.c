@@ -0,0 +1,201 @@
+/**
+ *  \file stateHistory.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  State history of a run: a file of fixed-size records, one per full state of the problem, written by the
+ *  drainer of the ring buffer (option -H of the main process).
+ *
+ *  Defined operations:
+ *     \li creation of the file (writer)
+ *     \li appending a full state (writer)
+ *     \li closing the file (writer)
+ *     \li mapping the file on the address space of an analysis tool (reader)
+ *     \li searching a record by sequence number (reader)
+ *     \li unmapping the file (reader).
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "probDataStruct.h"
+#include "stateHistory.h"
+
+/** \brief descriptor of the history file being written (-1, if none) */
+static int histFd = -1;
+
+/** \brief mapping of the history file being written */
+static HIST_HDR *hist = NULL;
+
+/** \brief size of the history file being written (and of its mapping) */
+static size_t histSize = 0;
+
+/* internal functions */
+
+/* growing the file being written by a chunk, and its mapping with it */
+static int histGrow (void)
+{
+    size_t chunk = HIST_CHUNK / hist->recSize * hist->recSize;
+    size_t size = histSize + ((chunk > 0) ? chunk : hist->recSize);
+    void *add;
+
+    if (ftruncate (histFd, (off_t) size) == -1) {
+        return -1;
+    }
+    if ((add = mremap (hist, histSize, size, MREMAP_MAYMOVE)) == MAP_FAILED) {
+        return -1;
+    }
+    hist = (HIST_HDR *) add;
+    histSize = size;
+    return 0;
+}
+
+/* external functions */
+
+int histCreate (char name[], FULL_STAT *p_fSt, uint64_t t0)
+{
+    size_t recSize = HIST_REC_SIZE(NUM_COLS(p_fSt));
+    size_t size = sizeof (HIST_HDR) + HIST_CHUNK / recSize * recSize;
+    void *add;
+
+    if ((histFd = open (name, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666)) == -1) {
+        return -1;
+    }
+    if ((ftruncate (histFd, (off_t) size) == -1) ||
+        ((add = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, histFd, 0)) == MAP_FAILED)) {
+        close (histFd);
+        histFd = -1;
+        return -1;
+    }
+    hist = (HIST_HDR *) add;
+    histSize = size;
+
+    memset (hist, 0, sizeof (HIST_HDR));
+    hist->magic = HIST_MAGIC;
+    hist->version = HIST_VERSION;
+    hist->nPlayers = p_fSt->nPlayers;
+    hist->nGoalies = p_fSt->nGoalies;
+    hist->nReferees = p_fSt->nReferees;
+    hist->recSize = (uint32_t) recSize;
+    hist->t0 = t0;
+    hist->nRecs = 0;
+    return 0;
+}
+
+int histAppend (FULL_STAT *p_fSt, uint64_t seq, uint64_t tstamp)
+{
+    HIST_REC *rec;
+
+    if (sizeof (HIST_HDR) + (hist->nRecs + 1) * hist->recSize > histSize) {
+        if (histGrow () == -1) {
+            return -1;
+        }
+    }
+    rec = HIST_RECORD(hist, hist->nRecs);
+    rec->seq = seq;
+    rec->tstamp = (tstamp > hist->t0) ? (tstamp - hist->t0) / 1000 : 0;
+    rec->playersFree = atomic_load_explicit (&p_fSt->playersFree, memory_order_relaxed);
+    rec->goaliesFree = atomic_load_explicit (&p_fSt->goaliesFree, memory_order_relaxed);
+    rec->teamId = atomic_load_explicit (&p_fSt->teamId, memory_order_relaxed);
+    rec->reserved = 0;
+    memcpy (rec->st, p_fSt->st, NUM_COLS(p_fSt));
+    hist->nRecs++;                                                          /* the record is complete: publishing it */
+    return 0;
+}
+
+int histClose (void)
+{
+    size_t size;
+
+    if (histFd == -1) {
+        return 0;
+    }
+    size = sizeof (HIST_HDR) + hist->nRecs * hist->recSize;
+    if ((munmap (hist, histSize) == -1) || (ftruncate (histFd, (off_t) size) == -1) ||
+        ((fsync (histFd) == -1) && (errno != EINVAL))) {
+        close (histFd);
+        histFd = -1;
+        return -1;
+    }
+    hist = NULL;
+    histSize = 0;
+    if (close (histFd) == -1) {
+        histFd = -1;
+        return -1;
+    }
+    histFd = -1;
+    return 0;
+}
+
+HIST_HDR *histMap (char name[], size_t *pSize)
+{
+    struct stat st;                                                                            /* status of the file */
+    HIST_HDR *hdr;
+    void *add;
+    int fd;
+
+    if ((fd = open (name, O_RDONLY)) == -1) {
+        return NULL;
+    }
+    if (fstat (fd, &st) == -1) {
+        close (fd);
+        return NULL;
+    }
+    if ((size_t) st.st_size < sizeof (HIST_HDR)) {
+        close (fd);
+        errno = EINVAL;
+        return NULL;
+    }
+    add = mmap (NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close (fd);                                                                       /* the mapping stays in place */
+    if (add == MAP_FAILED) {
+        return NULL;
+    }
+    hdr = (HIST_HDR *) add;
+    if ((hdr->magic != HIST_MAGIC) || (hdr->version != HIST_VERSION) ||
+        (hdr->recSize < HIST_REC_SIZE(hdr->nPlayers + hdr->nGoalies + hdr->nReferees))) {
+        munmap (add, (size_t) st.st_size);
+        errno = EINVAL;
+        return NULL;
+    }
+    *pSize = (size_t) st.st_size;
+    return hdr;
+}
+
+uint64_t histCount (HIST_HDR *hdr, size_t size)
+{
+    uint64_t held = (size - sizeof (HIST_HDR)) / hdr->recSize;
+
+    return (hdr->nRecs < held) ? hdr->nRecs : held;
+}
+
+uint64_t histFind (HIST_HDR *hdr, size_t size, uint64_t seq)
+{
+    uint64_t lo = 0, hi = histCount (hdr, size), mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (HIST_RECORD(hdr, mid)->seq < seq) {
+            lo = mid + 1;
+        }
+        else hi = mid;
+    }
+    return lo;
+}
+
+int histUnmap (HIST_HDR *hdr, size_t size)
+{
+    return munmap (hdr, size);
+}
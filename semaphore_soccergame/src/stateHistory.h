@@ -0,0 +1,180 @@
+/**
+ *  \file stateHistory.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  State history of a run: a file of fixed-size records, one per full state of the problem, written by the
+ *  drainer of the ring buffer (option -H of the main process).
+ *
+ *  Defined operations:
+ *     \li creation of the file (writer)
+ *     \li appending a full state (writer)
+ *     \li closing the file (writer)
+ *     \li mapping the file on the address space of an analysis tool (reader)
+ *     \li searching a record by sequence number (reader)
+ *     \li unmapping the file (reader).
+ *
+ *  The file is memory mapped by both sides: the writer grows it in large chunks, so that appending a record takes no
+ *  system call, and a reader gets each record in place, with no parsing.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#ifndef STATEHISTORY_H_
+#define STATEHISTORY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "probDataStruct.h"
+
+/** \brief state history magic number ("SGHS") */
+#define  HIST_MAGIC       0x53484753u
+/** \brief state history format version */
+#define  HIST_VERSION     2
+
+/** \brief size by which the file is grown (in bytes, rounded down to whole records) */
+#define  HIST_CHUNK       (4 * 1024 * 1024)
+
+/**
+ *  \brief Definition of <em>state history header</em> data type.
+ *
+ *  It takes a cache line at the start of the file, followed by the records.
+ */
+typedef struct {
+    /** \brief magic number, HIST_MAGIC */
+    uint32_t magic;
+    /** \brief format version, HIST_VERSION */
+    uint32_t version;
+    /** \brief total number of players */
+    uint32_t nPlayers;
+    /** \brief total number of goalies */
+    uint32_t nGoalies;
+    /** \brief total number of referees */
+    uint32_t nReferees;
+    /** \brief size of each record (in bytes, see HIST_REC_SIZE) */
+    uint32_t recSize;
+    /** \brief time of history creation (CLOCK_MONOTONIC, in ns) */
+    uint64_t t0;
+    /** \brief number of records written so far (updated after each record, so that a run in progress may be read) */
+    uint64_t nRecs;
+    /** \brief reserved, 0 */
+    uint8_t reserved[CACHE_LINE - 40];
+} HIST_HDR;
+
+/**
+ *  \brief Definition of <em>state history record</em> data type.
+ */
+typedef struct {
+    /** \brief number of state changes up to this state (0 for the initial state; the start of a round of a server
+               run repeats the number of the last change), which orders the records */
+    uint64_t seq;
+    /** \brief time of the change since history creation (in us; it took 32 bits up to version 1, wrapping around
+               after 71 minutes) */
+    uint64_t tstamp;
+    /** \brief number of players that arrived and are free (no team) */
+    int32_t playersFree;
+    /** \brief number of goalies that arrived and are free (no team) */
+    int32_t goaliesFree;
+    /** \brief id of team that will be formed next */
+    int32_t teamId;
+    /** \brief reserved, 0 */
+    uint32_t reserved;
+    /** \brief state of every log column, as in the full state of the problem */
+    uint8_t st[];
+} HIST_REC;
+
+/** \brief size of a record with <tt>nCol</tt> log columns (in bytes, a multiple of 8) */
+#define  HIST_REC_SIZE(nCol)     ((sizeof (HIST_REC) + (size_t) (nCol) + 7) / 8 * 8)
+
+/** \brief record <tt>i</tt> of the history mapped at <tt>p_hdr</tt> */
+#define  HIST_RECORD(p_hdr, i)   ((HIST_REC *) ((char *) (p_hdr) + sizeof (HIST_HDR) + (size_t) (i) * (p_hdr)->recSize))
+
+_Static_assert (sizeof (HIST_HDR) == CACHE_LINE, "the state history header does not take a cache line");
+_Static_assert (sizeof (HIST_REC) % 8 == 0, "the state history record header is not a multiple of 8 bytes");
+
+/**
+ *  \brief Creation of the state history file.
+ *
+ *  The first chunk of the file is allocated and mapped; no record is written.
+ *
+ *  \param name name of the file
+ *  \param p_fSt pointer to the full state of the problem (only its configuration is used)
+ *  \param t0 time of history creation (CLOCK_MONOTONIC, in ns)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+extern int histCreate (char name[], FULL_STAT *p_fSt, uint64_t t0);
+
+/**
+ *  \brief Appending a full state to the state history.
+ *
+ *  The record is copied into the mapping, and only when the file is full is it grown (by HIST_CHUNK bytes).
+ *
+ *  \param p_fSt pointer to the full state of the problem
+ *  \param seq sequence number of the record
+ *  \param tstamp time of the change (CLOCK_MONOTONIC, in ns)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+extern int histAppend (FULL_STAT *p_fSt, uint64_t seq, uint64_t tstamp);
+
+/**
+ *  \brief Closing the state history file.
+ *
+ *  The file is cut down to the records written, synchronized with the storage device and closed.
+ *  Nothing is done if there is no history.
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+extern int histClose (void);
+
+/**
+ *  \brief Mapping a state history file on the address space of the caller (read only).
+ *
+ *  \param name name of the file
+ *  \param pSize pointer to the location where the size of the mapping is stored
+ *
+ *  \return pointer to the header, followed by the records, upon success
+ *  \return \c NULL, when an error occurs (the actual situation is reported in <tt>errno</tt>; EINVAL, if the file
+ *          is not a state history of this version)
+ */
+extern HIST_HDR *histMap (char name[], size_t *pSize);
+
+/**
+ *  \brief Number of records of a mapped state history.
+ *
+ *  \param hdr pointer to the header
+ *  \param size size of the mapping
+ *
+ *  \return number of records written and held by the mapping
+ */
+extern uint64_t histCount (HIST_HDR *hdr, size_t size);
+
+/**
+ *  \brief Searching a mapped state history by sequence number (binary search).
+ *
+ *  \param hdr pointer to the header
+ *  \param size size of the mapping
+ *  \param seq sequence number
+ *
+ *  \return index of the first record with a sequence number not lower than <tt>seq</tt> (the number of records,
+ *          if there is none)
+ */
+extern uint64_t histFind (HIST_HDR *hdr, size_t size, uint64_t seq);
+
+/**
+ *  \brief Unmapping a state history file off the address space of the caller.
+ *
+ *  \param hdr pointer to the header
+ *  \param size size of the mapping
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+extern int histUnmap (HIST_HDR *hdr, size_t size);
+
+#endif /* STATEHISTORY_H_ */
@@ -0,0 +1,369 @@
+/**
+ *  \file traceDecode.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  Decoder of the binary trace written by the generator process with option -b, and of the state history written
+ *  with option -H.
+ *
+ *  Upon execution, the following parameters are accepted:
+ *    \li -d: show only the fields that changed from the previous line (same output as filter_log.awk)
+ *    \li -t: prefix each state line with the time of the change since the start of the trace (in us)
+ *    \li -s n: state history only, start at the first record with sequence number n (found by binary search)
+ *    \li -c: state history only, append the free players, the free goalies and the next team id to each state line
+ *    \li -k P,G,M[,L]: binary trace only, check the invariants of the run instead of decoding it, for P players and G
+ *        goalies per team and M matches (L, if the teams were formed by the lock-free matcher); not for the trace
+ *        of a server run, whose rounds are not told apart
+ *    \li name of the trace (or state history) file.
+ *
+ *  Without -d, the output has the same layout as the text log. A state history is mapped on the address space
+ *  and its records are read in place. With -k, nothing is written to the standard output, a violation is reported
+ *  on stderr (see stateCheck.h) and the exit status tells if the invariants hold.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "probConst.h"
+#include "logging.h"
+#include "stateHistory.h"
+#include "stateCheck.h"
+
+/** \brief show only changed fields */
+static bool diffMode = false;
+
+/** \brief prefix lines with timestamps */
+static bool timeMode = false;
+
+/** \brief append the counters of the state history records */
+static bool countMode = false;
+
+/** \brief number of log columns */
+static unsigned int nCol;
+
+/** \brief maximum length of an output line */
+static size_t lineLen;
+
+/** \brief width of each field in the filtered output */
+static int *fieldSize;
+
+/** \brief fields of the previous filtered line */
+static char (*prev)[8];
+
+/** \brief fields of the line being filtered */
+static char **fields;
+
+/** \brief work copy of the line being filtered */
+static char *copy;
+
+/** \brief line being built */
+static char *line;
+
+/**
+ *  \brief Output of one line.
+ *
+ *  In diff mode, lines with one field per log column are filtered as filter_log.awk does; the other lines are
+ *  printed unchanged.
+ *
+ *  \param line line to be printed (terminated by a newline)
+ */
+static void emit (char *line)
+{
+    char *tok;
+    unsigned int nf = 0, i;
+
+    if (!diffMode) {
+        fputs (line, stdout);
+        return;
+    }
+
+    strcpy (copy, line);
+    for (tok = strtok (copy, " \n"); tok != NULL; tok = strtok (NULL, " \n")) {
+        if (nf++ < nCol) {
+            fields[nf - 1] = tok;
+        }
+    }
+    if (nf != nCol) {
+        fputs (line, stdout);
+        return;
+    }
+    for (i = 0; i < nCol; i++) {
+        if (strcmp (fields[i], prev[i]) == 0) {
+            printf ("%*s ", fieldSize[i], ".");
+        }
+        else printf ("%*s ", fieldSize[i], fields[i]);
+        strncpy (prev[i], fields[i], sizeof (prev[i]) - 1);
+    }
+    printf ("\n");
+}
+
+/**
+ *  \brief Output of the state of all entities, with the layout of saveState.
+ *
+ *  \param hdr trace header
+ *  \param st state of every log column
+ *  \param tstamp time of the change (in us)
+ *  \param rec state history record (NULL, for a trace)
+ */
+static void printState (TRACE_HDR *hdr, char *st, uint64_t tstamp, HIST_REC *rec)
+{
+    int len = 0;
+    unsigned int c;
+
+    if (timeMode) {
+        printf ("%10llu ", (unsigned long long) tstamp);
+    }
+    for (c = 0; c < nCol; c++) {
+        if ((c == hdr->nPlayers) || (c == hdr->nPlayers + hdr->nGoalies)) {
+            len += sprintf (line + len, " ");
+        }
+        len += sprintf (line + len, "%4c", st[c]);
+    }
+    if (countMode && (rec != NULL)) {
+        len += sprintf (line + len, "  %5d %5d %5d", rec->playersFree, rec->goaliesFree, rec->teamId);
+    }
+    sprintf (line + len, "\n");
+    emit (line);
+}
+
+/**
+ *  \brief Output of the title and of the column header, with the layout of createLog.
+ *
+ *  \param hdr trace header
+ */
+static void printHeader (TRACE_HDR *hdr)
+{
+    int len = 0;
+    unsigned int p, g, r;
+
+    sprintf (line, "%21cSoccerGame - Description of the internal state\n", ' ');
+    emit (line);
+    emit ("\n");
+
+    for (p = 0; p < hdr->nPlayers; p++) {
+        len += sprintf (line + len, " %s%02d", "P", p);
+    }
+    len += sprintf (line + len, " ");
+    for (g = 0; g < hdr->nGoalies; g++) {
+        len += sprintf (line + len, " %s%02d", "G", g);
+    }
+    len += sprintf (line + len, " ");
+    for (r = 0; r < hdr->nReferees; r++) {
+        len += sprintf (line + len, " %s%02d", "R", r + 1);
+    }
+    len += sprintf (line + len, " ");
+    if (countMode) {
+        len += sprintf (line + len, " %5s %5s %5s", "PFree", "GFree", "Team");
+    }
+    sprintf (line + len, "\n");
+
+    if (timeMode) {
+        printf ("%10s ", "us");
+    }
+    emit (line);
+}
+
+/**
+ *  \brief Allocation of the line buffers, once the number of log columns is known.
+ *
+ *  \param hdr trace header
+ */
+static void allocBuffers (TRACE_HDR *hdr)
+{
+    unsigned int c;
+
+    nCol = hdr->nPlayers + hdr->nGoalies + hdr->nReferees;
+    lineLen = 16 * (size_t) nCol + 128;                         /* column names have up to 7 digits, plus separators */
+    if (((fieldSize = malloc (nCol * sizeof (int))) == NULL) || ((prev = calloc (nCol, sizeof (*prev))) == NULL) ||
+        ((fields = malloc (nCol * sizeof (char *))) == NULL) || ((copy = malloc (lineLen)) == NULL) ||
+        ((line = malloc (lineLen)) == NULL)) {
+        perror ("error on allocating the decoder buffers");
+        exit (EXIT_FAILURE);
+    }
+
+    /* field widths of filter_log.awk: one extra space before the first goalie and the referee */
+    for (c = 0; c < nCol; c++) {
+        fieldSize[c] = ((c == hdr->nPlayers) || (c == hdr->nPlayers + hdr->nGoalies)) ? 5 : 4;
+    }
+}
+
+/**
+ *  \brief Output of a state history, from the first record with a sequence number not lower than
+ *  <tt>firstSeq</tt>.
+ *
+ *  \param name name of the state history file
+ *  \param firstSeq sequence number of the first record
+ *
+ *  \return exit status
+ */
+static int decodeHistory (char *name, uint64_t firstSeq)
+{
+    HIST_HDR *hist;                                                                           /* mapped state history */
+    HIST_REC *rec;                                                                            /* state history record */
+    TRACE_HDR hdr;                                                                           /* layout of the columns */
+    size_t size;
+    uint64_t i, n;
+
+    if ((hist = histMap (name, &size)) == NULL) {
+        perror ("error on mapping the state history file");
+        return EXIT_FAILURE;
+    }
+    hdr.nPlayers = hist->nPlayers;
+    hdr.nGoalies = hist->nGoalies;
+    hdr.nReferees = hist->nReferees;
+    allocBuffers (&hdr);
+
+    printHeader (&hdr);
+    n = histCount (hist, size);
+    for (i = histFind (hist, size, firstSeq); i < n; i++) {
+        rec = HIST_RECORD(hist, i);
+        printState (&hdr, (char *) rec->st, rec->tstamp, rec);
+    }
+
+    histUnmap (hist, size);
+    return EXIT_SUCCESS;
+}
+
+/**
+ *  \brief Checking the invariants of a run from its binary trace.
+ *
+ *  \param fic trace file, past the header
+ *  \param hdr pointer to the trace header
+ *  \param spec configuration of the run (option -k)
+ *
+ *  \return EXIT_SUCCESS if the invariants hold; EXIT_FAILURE, if not
+ */
+static int checkTrace (FILE *fic, TRACE_HDR *hdr, char *spec)
+{
+    FULL_STAT *fSt;                                                                  /* initial full state of the run */
+    TRACE_REC rec;                                                                                    /* trace record */
+    int nTeamPlayers, nTeamGoalies, nMatches, n = 0;
+
+    if ((sscanf (spec, "%d,%d,%d%n", &nTeamPlayers, &nTeamGoalies, &nMatches, &n) != 3) || (nTeamPlayers < 1) ||
+        (nTeamGoalies < 1) || (nMatches < 1) || ((strcmp (spec + n, "") != 0) && (strcmp (spec + n, ",L") != 0))) {
+        fprintf (stderr, "Invalid run configuration %s (players and goalies per team, matches[,L])\n", spec);
+        return EXIT_FAILURE;
+    }
+    if ((fSt = aligned_alloc (CACHE_LINE, FULL_STAT_SIZE(nCol))) == NULL) {
+        perror ("error on allocating the decoder buffers");
+        return EXIT_FAILURE;
+    }
+    memset (fSt, 0, FULL_STAT_SIZE(nCol));
+    fSt->nPlayers = (int) hdr->nPlayers;
+    fSt->nGoalies = (int) hdr->nGoalies;
+    fSt->nReferees = (int) hdr->nReferees;
+    fSt->nTeamPlayers = nTeamPlayers;
+    fSt->nTeamGoalies = nTeamGoalies;
+    fSt->nMatches = nMatches;
+    fSt->lockFree = (spec[n] != '\0');
+    if (fread (fSt->st, 1, nCol, fic) != nCol) {
+        fprintf (stderr, "Truncated trace header\n");
+        return EXIT_FAILURE;
+    }
+
+    checkInit (fSt);
+    while (fread (&rec, sizeof (rec), 1, fic) == 1) {
+        if (!checkChange (TRACE_COL(&rec), TRACE_STATE(&rec))) {
+            return EXIT_FAILURE;
+        }
+    }
+    free (fSt);
+    return checkEnd () ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ *  \brief Main program.
+ *
+ *  Its role is to rebuild the log of a run from its binary trace (or from its state history).
+ */
+int main (int argc, char *argv[])
+{
+    FILE *fic;                                                                                      /* trace file */
+    TRACE_HDR hdr;                                                                                 /* trace header */
+    TRACE_REC rec;                                                                                    /* trace record */
+    char *st;                                                                          /* state of every log column */
+    uint64_t firstSeq = 0;                                              /* first sequence number of the state history */
+    char *spec = NULL;                                             /* configuration of the run to be checked (if any) */
+    int opt;
+
+    while ((opt = getopt (argc, argv, "dts:ck:")) != -1) {
+        switch (opt) {
+            case 'd': diffMode = true;
+                      break;
+            case 't': timeMode = true;
+                      break;
+            case 's': firstSeq = strtoull (optarg, NULL, 0);
+                      break;
+            case 'c': countMode = true;
+                      break;
+            case 'k': spec = optarg;
+                      break;
+            default:  fprintf (stderr, "Usage: %s [-d] [-t] [-s seq] [-c] [-k P,G,M[,L]] tracefile\n", argv[0]);
+                      return EXIT_FAILURE;
+        }
+    }
+    if ((optind != argc - 1) || (diffMode && countMode)) {
+        fprintf (stderr, "Usage: %s [-d] [-t] [-s seq] [-c] [-k P,G,M[,L]] tracefile\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if ((fic = fopen (argv[optind], "r")) == NULL) {
+        perror ("error on opening trace file");
+        return EXIT_FAILURE;
+    }
+    if (fread (&hdr, sizeof (hdr), 1, fic) != 1) {
+        hdr.magic = 0;
+    }
+    if ((hdr.magic == HIST_MAGIC) && (spec != NULL)) {
+        fprintf (stderr, "Option -k only applies to a binary trace\n");
+        return EXIT_FAILURE;
+    }
+    if (hdr.magic == HIST_MAGIC) {
+        fclose (fic);
+        return decodeHistory (argv[optind], firstSeq);
+    }
+    if ((firstSeq != 0) || countMode) {
+        fprintf (stderr, "Options -s and -c only apply to a state history\n");
+        return EXIT_FAILURE;
+    }
+    if (hdr.magic != TRACE_MAGIC) {
+        fprintf (stderr, "%s is not a SoccerGame trace\n", argv[optind]);
+        return EXIT_FAILURE;
+    }
+    if (hdr.version != TRACE_VERSION) {
+        fprintf (stderr, "Unsupported trace version %u\n", hdr.version);
+        return EXIT_FAILURE;
+    }
+    if (spec != NULL) {
+        nCol = hdr.nPlayers + hdr.nGoalies + hdr.nReferees;
+        return checkTrace (fic, &hdr, spec);
+    }
+    allocBuffers (&hdr);
+    if ((st = malloc (nCol)) == NULL) {
+        perror ("error on allocating the decoder buffers");
+        return EXIT_FAILURE;
+    }
+    if (fread (st, 1, nCol, fic) != nCol) {
+        fprintf (stderr, "Truncated trace header\n");
+        return EXIT_FAILURE;
+    }
+
+    printHeader (&hdr);
+    printState (&hdr, st, 0, NULL);
+    while (fread (&rec, sizeof (rec), 1, fic) == 1) {
+        if (TRACE_COL(&rec) >= nCol) {
+            fprintf (stderr, "Invalid trace record (column %u)\n", TRACE_COL(&rec));
+            return EXIT_FAILURE;
+        }
+        st[TRACE_COL(&rec)] = TRACE_STATE(&rec);
+        printState (&hdr, st, rec.tstamp, NULL);
+    }
+
+    fclose (fic);
+    return EXIT_SUCCESS;
+}